@@ -0,0 +1,108 @@
+#ifndef BUFFERALLOCATOR_H
+#define BUFFERALLOCATOR_H
+
+#include <cstddef>
+#include <map>
+using std::map;
+#include <vector>
+using std::vector;
+
+/**
+  Vertex and index storage carved out of a few large GL buffers, so that
+  a scene's worth of Drawables costs the driver a handful of buffer
+  objects rather than several each, and deleting a Drawable gives its
+  storage back.
+
+  Each buffer (a block) keeps its free space as ranges ordered by offset.
+  An allocation takes the first free range that fits, lowest block first;
+  a freed range is merged with the free ranges either side of it.  A
+  request larger than the block size gets a block of its own.  A block
+  that empties is deleted, except that one empty block is kept so that
+  recreating a scene doesn't churn buffer objects.
+
+  The blocks are GL_STATIC_DRAW and hold vertex and index data alike:
+  bind a range's buffer to whichever target and add its offset to the
+  attribute or index pointer.  Use from the GL thread only.
+  */
+class BufferAllocator
+{
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 4 * 1024 * 1024;
+    static const size_t ALIGNMENT = 16;     // Of every range's offset
+
+    struct Range
+    {
+        unsigned int buffer;    // GL buffer object, 0 for an empty range
+        size_t offset;          // In bytes
+        size_t size;            // Bytes requested, rounded up to ALIGNMENT
+    };
+
+    struct Stats
+    {
+        unsigned int buffers;       // GL buffer objects
+        unsigned int allocations;   // Live ranges
+        size_t reservedBytes;       // Storage of all the buffers
+        size_t usedBytes;           // Live ranges, alignment padding included
+        unsigned int freeRanges;
+        size_t largestFreeRange;
+        // 1 - largestFreeRange / free bytes: 0 while the free space is
+        // one range, nearing 1 as it splinters into small ones
+        float fragmentation;
+    };
+
+private:
+    struct Block
+    {
+        unsigned int buffer;
+        size_t size;
+        size_t used;
+        map<size_t, size_t> freeRanges;     // Offset to size
+    };
+
+    vector<Block> blocks;
+    size_t blockSize;
+    unsigned int allocations;
+
+    // Not copyable
+    BufferAllocator( const BufferAllocator & );
+    BufferAllocator & operator=( const BufferAllocator & );
+
+    void addBlock( size_t size );
+    bool allocateFrom( Block & block, size_t size, Range & range );
+
+public:
+    explicit BufferAllocator( size_t blockSize = DEFAULT_BLOCK_SIZE );
+
+    /**
+      Deletes the buffers, invalidating any ranges still allocated.
+      */
+    ~BufferAllocator();
+
+    /**
+      Reserves bytes of storage, with undefined contents.  Zero bytes give
+      an empty range.
+      */
+    Range allocate( size_t bytes );
+
+    /**
+      allocate() followed by an upload of data into the range.  Leaves the
+      GL_ARRAY_BUFFER and GL_ELEMENT_ARRAY_BUFFER bindings alone.
+      */
+    Range store( const void * data, size_t bytes );
+
+    /**
+      Returns a range to its block.  Empty ranges are ignored.
+      */
+    void free( const Range & range );
+
+    Stats stats() const;
+    size_t getBlockSize() const { return blockSize; }
+
+    /**
+      The allocator the Drawables use.  Created on first use and never
+      deleted; its buffers go with the GL context.
+      */
+    static BufferAllocator & shared();
+};
+
+#endif // BUFFERALLOCATOR_H
@@ -0,0 +1,89 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <cstddef>
+#include <cfloat>
+#include <vector>
+using std::vector;
+#include <glm/glm.hpp>
+using glm::vec3;
+
+/**
+  Bounding volume hierarchy over an indexed triangle list, for CPU ray
+  queries such as picking and line of sight.
+
+  The tree is built top down with the surface area heuristic over binned
+  triangle centroids, then collapsed from two to four children per node.
+  Nodes are stored flat in depth first order, 128 bytes each with the four
+  child boxes laid out component by component, so that one node is two
+  cache lines and a ray is tested against all four boxes at once with SSE
+  (scalar fallback elsewhere).  The triangles are copied in leaf order in
+  a form ready for the intersection test.
+  */
+class BVH
+{
+public:
+    struct Hit
+    {
+        float t;                // Distance along the ray, in units of the direction length
+        unsigned int triangle;  // Index of the triangle in the source index list
+        float u, v;             // Barycentric coordinates of the hit on that triangle
+    };
+
+    struct Node
+    {
+        float minX[4], minY[4], minZ[4];
+        float maxX[4], maxY[4], maxZ[4];
+        int child[4];           // Node index, or first triangle for a leaf, -1 if unused
+        unsigned int count[4];  // Triangles in a leaf child, 0 for an inner node
+    };
+
+    struct Stats
+    {
+        unsigned int nodes;
+        unsigned int leaves;
+        unsigned int maxDepth;
+        float sahCost;          // Expected intersection tests per ray, relative to the root
+    };
+
+private:
+    struct Triangle
+    {
+        vec3 v0, edge1, edge2;
+        unsigned int index;
+    };
+
+    vector<Node> nodes;
+    vector<Triangle> triangles;
+
+    template <bool anyHit>
+    bool traverse( const vec3 & origin, const vec3 & direction, float tMax, Hit & hit ) const;
+
+public:
+    BVH();
+
+    /**
+      Builds the tree.  Positions are the first three floats of each vertex.
+      */
+    void build( const float * verts, size_t stride, size_t nVerts,
+                const unsigned int * indices, size_t nIndices );
+
+    /**
+      Closest hit along origin + t * direction, 0 <= t < tMax.  Triangles
+      are hit from either side.
+      */
+    bool intersect( const vec3 & origin, const vec3 & direction, Hit & hit,
+                    float tMax = FLT_MAX ) const;
+
+    /**
+      True if anything lies along origin + t * direction, 0 <= t < tMax.
+      Stops at the first hit found, so it is cheaper than intersect.
+      */
+    bool occluded( const vec3 & origin, const vec3 & direction, float tMax = FLT_MAX ) const;
+
+    Stats stats() const;
+    bool empty() const { return triangles.empty(); }
+    size_t memoryBytes() const;
+};
+
+#endif // BVH_H
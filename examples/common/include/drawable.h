@@ -1,12 +1,182 @@
 #ifndef DRAWABLE_H
 #define DRAWABLE_H
 
+#include "bufferallocator.h"
+
+#include <glm/glm.hpp>
+using glm::mat4;
+
+class InstanceBuffer;
+
 class Drawable
 {
 public:
+    /**
+      How the vertex attributes are stored in buffer objects: one tightly
+      packed buffer per attribute, or a single buffer holding each vertex's
+      attributes back to back.
+      */
+    enum VertexLayout { SPLIT_BUFFERS, INTERLEAVED };
+
+    /**
+      Storage formats for the vertex attributes.  COMPRESS_ATTRIBUTES packs
+      normals and tangents as GL_INT_2_10_10_10_REV and texture coordinates
+      as half floats.  COMPRESS_ALL also stores positions as 16 bit values
+      relative to the bounding box; the scale and offset to undo that are
+      returned by getPositionTransform(), which must then be folded into
+      the model matrix.
+      */
+    enum VertexCompression { NO_COMPRESSION, COMPRESS_ATTRIBUTES, COMPRESS_ALL };
+
     Drawable();
 
+    /**
+      Gives the vertex and index storage back to BufferAllocator::shared()
+      and deletes the vertex array.
+      */
+    virtual ~Drawable();
+
     virtual void render() const = 0;
+
+    /**
+      Draws count copies in one call, each taking its model matrix and
+      material index from the next entry of the attached InstanceBuffer.
+      */
+    virtual void renderInstanced( int count ) const = 0;
+
+    /**
+      Points the instance attributes (see InstanceBuffer) of this
+      drawable's vertex array at instances.  Stays attached until another
+      buffer is; render() ignores it.
+      */
+    void attachInstances( const InstanceBuffer & instances );
+
+    /**
+      Maps the stored positions to model space.  Identity unless positions
+      were quantized.  The scale is uniform, so the normal matrix can still
+      be taken from the model-view matrix as long as the shader normalizes.
+      */
+    const mat4 & getPositionTransform() const { return positionTransform; }
+
+    // Size of the vertex buffer data, in bytes
+    unsigned int getVertexBytes() const { return vertexBytes; }
+
+    // Size of the index buffer data, in bytes (0 for non-indexed drawables)
+    unsigned int getIndexBytes() const { return indexBytes; }
+
+    // What an attribute holds, which decides how it may be compressed
+    enum AttributeUsage { GENERIC, POSITION, DIRECTION, TEXCOORD };
+
+    // One attribute stream for storeVertexAttributes
+    struct VertexAttribute
+    {
+        unsigned int location;  // Shader attribute index
+        int size;               // Floats per vertex
+        const float * data;
+        int dataStride;         // Floats between vertices in data, 0 if packed
+        AttributeUsage usage;   // Unit vectors (DIRECTION) may have w = +-1
+    };
+
+    /**
+      Vertex attributes already converted to the formats they are stored
+      in (see encodeVertexAttributes), so that storing them takes only
+      buffer copies.  A buffer that needed no conversion points at the
+      source data, which must then outlive this.
+      */
+    struct EncodedVertices
+    {
+        struct Buffer
+        {
+            const void * source;            // NULL when converted
+            vector<unsigned char> converted;
+            unsigned int bytes;
+        };
+
+        // One glVertexAttribPointer call
+        struct Pointer
+        {
+            unsigned int location;
+            int size;
+            unsigned int type;
+            bool normalized;
+            int stride;             // In bytes
+            unsigned int buffer;    // Index into buffers
+            unsigned int offset;    // Bytes into that buffer
+        };
+
+        vector<Buffer> buffers;
+        vector<Pointer> pointers;
+        mat4 positionTransform;
+        unsigned int vertexBytes;
+    };
+
+    /**
+      Indices narrowed to the type they are stored as (see
+      encodeIndices).  They point at the source when they stay 32 bit.
+      */
+    struct EncodedIndices
+    {
+        unsigned int type;
+        const void * source;            // NULL when narrowed
+        vector<unsigned short> converted;
+        unsigned int bytes;
+    };
+
+private:
+    vector<BufferAllocator::Range> ranges;
+
+    // Not copyable
+    Drawable( const Drawable & );
+    Drawable & operator=( const Drawable & );
+
+protected:
+    mat4 positionTransform;
+    unsigned int vertexBytes;
+    unsigned int indexBytes;
+    unsigned int vaoHandle;
+    unsigned int indexHandle;   // Buffer holding the index data
+    size_t indexOffset;         // Of the index data in indexHandle, in bytes
+
+    /**
+      Frees the buffer storage and the vertex array, for drawables that
+      upload more than once.
+      */
+    void releaseStorage();
+
+    /**
+      Stores nVerts vertices in the given layout and format in ranges of
+      the shared buffers (one per attribute when split), and sets up the
+      attribute pointers of the currently bound VAO.  Sets
+      positionTransform and vertexBytes.
+      */
+    void storeVertexAttributes( const VertexAttribute * attributes, int nAttributes,
+                                int nVerts, VertexLayout layout,
+                                VertexCompression compression = NO_COMPRESSION );
+
+    /**
+      The CPU half of the above, which can run on any thread: converts
+      the attributes to their stored formats and works out the layout.
+      */
+    static void encodeVertexAttributes( const VertexAttribute * attributes, int nAttributes,
+                                        int nVerts, VertexLayout layout,
+                                        VertexCompression compression,
+                                        EncodedVertices & encoded );
+
+    // The GL half: copies encoded vertices into the shared buffers
+    void storeVertexAttributes( const EncodedVertices & encoded );
+
+    /**
+      Copies count indices into the shared buffers, as 16 bit values when
+      nVerts is small enough (see GLUtils::bufferElementData), and makes
+      them the currently bound VAO's element buffer.  Sets indexBytes,
+      indexHandle and indexOffset, and returns the type to draw with.
+      */
+    unsigned int storeIndices( const unsigned int * el, int count, unsigned int nVerts );
+
+    // Split the same way as storeVertexAttributes
+    static void encodeIndices( const unsigned int * el, int count, unsigned int nVerts,
+                               EncodedIndices & encoded );
+    unsigned int storeIndices( const EncodedIndices & encoded );
 };
 
 #endif // DRAWABLE_H
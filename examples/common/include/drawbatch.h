@@ -0,0 +1,103 @@
+#ifndef DRAWBATCH_H
+#define DRAWBATCH_H
+
+#include "meshdata.h"
+
+#include <vector>
+using std::vector;
+#include <glm/glm.hpp>
+using glm::mat4;
+
+/**
+  Many meshes sharing one vertex buffer and one index buffer, so that a
+  whole frame of them goes to GL as a single glMultiDrawElementsIndirect
+  (OpenGL 4.3).  Meshes are added once with add(); each frame, draw()
+  queues a mesh with its model matrix and material index and render()
+  submits everything queued.
+
+  Vertices are interleaved position, normal and texture coordinate at
+  attributes 0, 1 and 2, like the other Drawables; meshes without normals
+  get (0, 1, 0), the plane's.  Each queued draw's DrawData goes to a
+  shader storage buffer at binding DRAW_DATA_BINDING.  The draw's index
+  into it reaches the vertex shader at attribute DRAW_ID_LOCATION, a per
+  instance attribute counting 0, 1, 2, ... picked by the base instance of
+  the draw's command (gl_DrawID needs OpenGL 4.6).  See
+  drawbench/batch.vs.
+  */
+class DrawBatch
+{
+public:
+    static const unsigned int DRAW_ID_LOCATION = 9;
+    static const unsigned int DRAW_DATA_BINDING = 0;
+
+    // std430 layout: 80 bytes
+    struct DrawData
+    {
+        mat4 model;
+        unsigned int material;  // Index into the shader's material array
+        unsigned int pad[3];
+    };
+
+private:
+    struct Mesh
+    {
+        unsigned int firstIndex;
+        unsigned int indexCount;
+        int baseVertex;
+    };
+
+    // The layout glMultiDrawElementsIndirect reads
+    struct DrawCommand
+    {
+        unsigned int count;
+        unsigned int instanceCount;
+        unsigned int firstIndex;
+        int baseVertex;
+        unsigned int baseInstance;
+    };
+
+    vector<float> vertices;
+    vector<unsigned int> indices;
+    vector<Mesh> meshes;
+    vector<DrawCommand> commands;
+    vector<DrawData> drawData;
+
+    unsigned int vaoHandle;
+    unsigned int vertexHandle, indexHandle;
+    unsigned int commandHandle, drawDataHandle, drawIdHandle;
+    unsigned int drawIdCount;
+    bool geometryChanged;
+
+    // Not copyable
+    DrawBatch( const DrawBatch & );
+    DrawBatch & operator=( const DrawBatch & );
+
+    void uploadGeometry();
+
+public:
+    DrawBatch();
+    ~DrawBatch();
+
+    /**
+      Appends a mesh to the shared buffers (uploaded by the next render)
+      and returns its number for draw().  Strips are unrolled to a list.
+      */
+    int add( const MeshData & data );
+
+    /**
+      Queues one draw of mesh for the next render().
+      */
+    void draw( int mesh, const mat4 & model, unsigned int material );
+
+    /**
+      Submits the queued draws in one call and empties the queue.  The
+      program must already be in use.
+      */
+    void render();
+
+    int meshCount() const { return (int)meshes.size(); }
+    int queuedDraws() const { return (int)commands.size(); }
+    size_t geometryBytes() const;
+};
+
+#endif // DRAWBATCH_H
@@ -0,0 +1,128 @@
+#ifndef FLOAT4_H
+#define FLOAT4_H
+
+#include <cmath>
+#include <algorithm>
+
+/**
+  Four floats worked on at once, for structure of arrays loops that handle
+  four vertices (or faces) per step.  SSE2 when the compiler targets it,
+  plain loops otherwise; both give the same results.  The comparisons
+  return a mask for select4.
+  */
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define FLOAT4_SSE2
+#include <emmintrin.h>
+#endif
+
+#ifdef FLOAT4_SSE2
+struct Float4
+{
+    __m128 m;
+    Float4() { }
+    Float4( __m128 v ) : m(v) { }
+};
+
+inline Float4 load4( const float * p ) { return _mm_loadu_ps(p); }
+inline Float4 splat4( float f ) { return _mm_set1_ps(f); }
+inline Float4 set4( float a, float b, float c, float d ) { return _mm_setr_ps(a, b, c, d); }
+inline void store4( float * p, Float4 a ) { _mm_storeu_ps(p, a.m); }
+inline Float4 sqrt4( Float4 a ) { return _mm_sqrt_ps(a.m); }
+
+inline Float4 operator+( Float4 a, Float4 b ) { return _mm_add_ps(a.m, b.m); }
+inline Float4 operator-( Float4 a, Float4 b ) { return _mm_sub_ps(a.m, b.m); }
+inline Float4 operator*( Float4 a, Float4 b ) { return _mm_mul_ps(a.m, b.m); }
+inline Float4 operator/( Float4 a, Float4 b ) { return _mm_div_ps(a.m, b.m); }
+
+inline Float4 equal4( Float4 a, Float4 b ) { return _mm_cmpeq_ps(a.m, b.m); }
+inline Float4 less4( Float4 a, Float4 b ) { return _mm_cmplt_ps(a.m, b.m); }
+
+// a where mask is set, else b
+inline Float4 select4( Float4 mask, Float4 a, Float4 b )
+{
+    return _mm_or_ps(_mm_and_ps(mask.m, a.m), _mm_andnot_ps(mask.m, b.m));
+}
+
+// The two floats at each of a to d, transposed into one Float4 per
+// component.  Reads only those floats.
+inline void transpose2( const float * a, const float * b, const float * c, const float * d,
+                        Float4 & x, Float4 & y )
+{
+    __m128 ab = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)a), (const __m64 *)b);
+    __m128 cd = _mm_loadh_pi(_mm_loadl_pi(_mm_setzero_ps(), (const __m64 *)c), (const __m64 *)d);
+    x = _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(2, 0, 2, 0));
+    y = _mm_shuffle_ps(ab, cd, _MM_SHUFFLE(3, 1, 3, 1));
+}
+
+// The same for three floats
+inline void transpose3( const float * a, const float * b, const float * c, const float * d,
+                        Float4 & x, Float4 & y, Float4 & z )
+{
+    transpose2(a, b, c, d, x, y);
+    __m128 zab = _mm_unpacklo_ps(_mm_load_ss(a + 2), _mm_load_ss(b + 2));
+    __m128 zcd = _mm_unpacklo_ps(_mm_load_ss(c + 2), _mm_load_ss(d + 2));
+    z = _mm_movelh_ps(zab, zcd);
+}
+
+// Swaps rows and columns of the 4x4 matrix whose rows are a to d
+inline void transpose4( Float4 & a, Float4 & b, Float4 & c, Float4 & d )
+{
+    _MM_TRANSPOSE4_PS(a.m, b.m, c.m, d.m);
+}
+#else
+struct Float4
+{
+    float f[4];
+};
+
+inline Float4 load4( const float * p ) { Float4 r = { { p[0], p[1], p[2], p[3] } }; return r; }
+inline Float4 splat4( float f ) { Float4 r = { { f, f, f, f } }; return r; }
+inline Float4 set4( float a, float b, float c, float d ) { Float4 r = { { a, b, c, d } }; return r; }
+inline void store4( float * p, Float4 a ) { for( int i = 0; i < 4; i++ ) p[i] = a.f[i]; }
+inline Float4 sqrt4( Float4 a ) { for( int i = 0; i < 4; i++ ) a.f[i] = sqrt(a.f[i]); return a; }
+
+inline Float4 operator+( Float4 a, Float4 b ) { for( int i = 0; i < 4; i++ ) a.f[i] += b.f[i]; return a; }
+inline Float4 operator-( Float4 a, Float4 b ) { for( int i = 0; i < 4; i++ ) a.f[i] -= b.f[i]; return a; }
+inline Float4 operator*( Float4 a, Float4 b ) { for( int i = 0; i < 4; i++ ) a.f[i] *= b.f[i]; return a; }
+inline Float4 operator/( Float4 a, Float4 b ) { for( int i = 0; i < 4; i++ ) a.f[i] /= b.f[i]; return a; }
+
+// Masks are 1 or 0 per lane
+inline Float4 equal4( Float4 a, Float4 b ) { for( int i = 0; i < 4; i++ ) a.f[i] = a.f[i] == b.f[i] ? 1.0f : 0.0f; return a; }
+inline Float4 less4( Float4 a, Float4 b ) { for( int i = 0; i < 4; i++ ) a.f[i] = a.f[i] < b.f[i] ? 1.0f : 0.0f; return a; }
+
+// a where mask is set, else b
+inline Float4 select4( Float4 mask, Float4 a, Float4 b )
+{
+    for( int i = 0; i < 4; i++ ) if( mask.f[i] == 0.0f ) a.f[i] = b.f[i];
+    return a;
+}
+
+// The two floats at each of a to d, transposed into one Float4 per
+// component.  Reads only those floats.
+inline void transpose2( const float * a, const float * b, const float * c, const float * d,
+                        Float4 & x, Float4 & y )
+{
+    x = set4(a[0], b[0], c[0], d[0]);
+    y = set4(a[1], b[1], c[1], d[1]);
+}
+
+// The same for three floats
+inline void transpose3( const float * a, const float * b, const float * c, const float * d,
+                        Float4 & x, Float4 & y, Float4 & z )
+{
+    transpose2(a, b, c, d, x, y);
+    z = set4(a[2], b[2], c[2], d[2]);
+}
+
+// Swaps rows and columns of the 4x4 matrix whose rows are a to d
+inline void transpose4( Float4 & a, Float4 & b, Float4 & c, Float4 & d )
+{
+    Float4 * rows[4] = { &a, &b, &c, &d };
+    for( int i = 0; i < 4; i++ ) {
+        for( int j = i + 1; j < 4; j++ ) std::swap(rows[i]->f[j], rows[j]->f[i]);
+    }
+}
+#endif
+
+#endif // FLOAT4_H
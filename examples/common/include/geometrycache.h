@@ -0,0 +1,119 @@
+#ifndef GEOMETRYCACHE_H
+#define GEOMETRYCACHE_H
+
+#include "drawable.h"
+#include "meshdata.h"
+#include "vbomesh.h"
+
+#include <cstddef>
+#include <map>
+using std::map;
+#include <string>
+using std::string;
+
+class VBOTeapot;
+class VBOPlane;
+class VBOTorus;
+class VBOCube;
+
+/**
+  GPU geometry shared between scenes, so that asking for a shape that has
+  already been built returns the existing Drawable instead of generating
+  and uploading it again.  Shapes are keyed on their generator and every
+  constructor argument, meshes on the OBJ path and the load options that
+  change what ends up in the buffers.
+
+  Each get call takes a reference, given back with release().  Released
+  geometry stays cached for the next scene that asks for it until the
+  vertex and index data of the whole cache exceeds the budget; then the
+  least recently used unreferenced entries are deleted.  Referenced
+  geometry is never evicted, so the budget is overrun while the scenes
+  hold more than it allows.  Use from the GL thread only; the cache must
+  outlive the references handed out.
+  */
+class GeometryCache
+{
+public:
+    struct Stats
+    {
+        unsigned int entries;
+        unsigned int referenced;    // Entries held by at least one reference
+        size_t bytes;               // Vertex and index data of all the entries
+        unsigned int hits;
+        unsigned int misses;
+        unsigned int evictions;
+    };
+
+private:
+    struct Entry
+    {
+        Drawable * drawable;
+        unsigned int refCount;
+        size_t bytes;
+        unsigned long long lastUse;
+    };
+
+    typedef map<string, Entry> EntryMap;
+    EntryMap entries;
+    map<const Drawable *, EntryMap::iterator> owners;
+    size_t budget;
+    unsigned long long useClock;
+    Stats counts;
+
+    // Not copyable
+    GeometryCache( const GeometryCache & );
+    GeometryCache & operator=( const GeometryCache & );
+
+    Drawable * acquire( const string & key );
+    Drawable * insert( const string & key, Drawable * drawable );
+    void evict();
+
+public:
+    explicit GeometryCache( size_t budgetBytes = 256 * 1024 * 1024 );
+
+    /**
+      Deletes every entry, including those still referenced.
+      */
+    ~GeometryCache();
+
+    VBOTeapot * teapot( int grid, const mat4 & lidTransform, bool optimizeVertexCache = false,
+                        Drawable::VertexLayout layout = Drawable::SPLIT_BUFFERS,
+                        Drawable::VertexCompression compression = Drawable::NO_COMPRESSION,
+                        bool weldSeams = false,
+                        MeshData::Primitive primitive = MeshData::TRIANGLES,
+                        bool matchTexCoords = true );
+    VBOPlane * plane( float xsize, float zsize, int xdivs, int zdivs,
+                      Drawable::VertexLayout layout = Drawable::SPLIT_BUFFERS,
+                      Drawable::VertexCompression compression = Drawable::NO_COMPRESSION,
+                      MeshData::Primitive primitive = MeshData::TRIANGLES );
+    VBOTorus * torus( float outerRadius, float innerRadius, int sides, int rings,
+                      bool optimizeVertexCache = false,
+                      Drawable::VertexLayout layout = Drawable::SPLIT_BUFFERS,
+                      Drawable::VertexCompression compression = Drawable::NO_COMPRESSION,
+                      MeshData::Primitive primitive = MeshData::TRIANGLES );
+    VBOCube * cube( Drawable::VertexLayout layout = Drawable::SPLIT_BUFFERS,
+                    Drawable::VertexCompression compression = Drawable::NO_COMPRESSION );
+
+    /**
+      Loads through VBOMesh::loadVertexData, so the options' binary cache
+      and thread count apply on a miss.  Returns NULL if the OBJ file
+      can't be opened.
+      */
+    VBOMesh * mesh( const char * fileName, const VBOMesh::Options & options );
+
+    /**
+      Gives back a reference taken by one of the calls above.
+      */
+    void release( const Drawable * drawable );
+
+    /**
+      Deletes every unreferenced entry.
+      */
+    void purge();
+
+    void setBudget( size_t budgetBytes );
+    size_t getBudget() const { return budget; }
+    Stats stats() const;
+};
+
+#endif // GEOMETRYCACHE_H
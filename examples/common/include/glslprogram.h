@@ -4,8 +4,11 @@
 #include <GL/glew.h>
 #include <string>
 using std::string;
+#include <vector>
+using std::vector;
 
 #include <glm/glm.hpp>
+using glm::vec2;
 using glm::vec3;
 using glm::vec4;
 using glm::mat4;
@@ -18,14 +21,70 @@ namespace GLSLShader {
     };
 };
 
+/**
+  An active uniform of one GLSLProgram, looked up by name once with
+  GLSLProgram::getUniformHandle so that setUniform needs no lookup at
+  all.  Default constructed, or for a name the program doesn't use, it is
+  invalid and setUniform ignores it, as it ignores unknown names.  Only
+  meaningful to the program that made it.
+  */
+class UniformHandle
+{
+private:
+    friend class GLSLProgram;
+    int index;      // Into the program's uniform table
+
+public:
+    UniformHandle() : index(-1) { }
+    bool isValid() const { return index >= 0; }
+};
+
 class GLSLProgram
 {
+public:
+    /**
+      setUniform calls with an active uniform since the last
+      resetUniformStats(): those that reached GL, and those skipped
+      because the uniform already held the value.
+      */
+    struct UniformStats
+    {
+        unsigned int uploads;
+        unsigned int skipped;
+    };
+
 private:
+    struct Uniform
+    {
+        string name;
+        unsigned int hash;
+        int location;       // -1 for members of uniform blocks
+        int value;          // Into values, shared by an array and its element 0
+    };
+
+    // The last value set, as the bits passed to glUniform*
+    struct UniformValue
+    {
+        GLenum type;        // GL_NONE until first set
+        float data[16];
+    };
+
     int  handle;
     bool linked;
     string logString;
 
-    int  getUniformLocation(const char * name );
+    // The active uniforms, found at link time, and an open addressing
+    // hash table of indices into them (-1 for an empty slot).  Arrays are
+    // entered under every element's name as well as the bare array name.
+    vector<Uniform> uniforms;
+    vector<int> uniformSlots;
+    vector<UniformValue> values;
+    UniformStats uniformStats;
+
+    void loadUniforms();
+    void addUniform( const string & name, int location, int value = -1 );
+    int  findUniform( const char * name ) const;
+    bool changed( UniformHandle u, GLenum type, const void * value, size_t bytes );
     bool fileExists( const string & fileName );
 
 public:
@@ -45,6 +104,7 @@ public:
     void   bindFragDataLocation( GLuint location, const char * name );
 
     void   setUniform( const char *name, float x, float y, float z);
+    void   setUniform( const char *name, const vec2 & v);
     void   setUniform( const char *name, const vec3 & v);
     void   setUniform( const char *name, const vec4 & v);
     void   setUniform( const char *name, const mat4 & m);
@@ -53,6 +113,34 @@ public:
     void   setUniform( const char *name, int val );
     void   setUniform( const char *name, bool val );
 
+    // Valid once linked; names are as in the shader, e.g. "Material.Kd"
+    // or "Weight[2]"
+    UniformHandle getUniformHandle( const char * name ) const;
+
+    void   setUniform( UniformHandle u, float x, float y, float z);
+    void   setUniform( UniformHandle u, const vec2 & v);
+    void   setUniform( UniformHandle u, const vec3 & v);
+    void   setUniform( UniformHandle u, const vec4 & v);
+    void   setUniform( UniformHandle u, const mat4 & m);
+    void   setUniform( UniformHandle u, const mat3 & m);
+    void   setUniform( UniformHandle u, float val );
+    void   setUniform( UniformHandle u, int val );
+    void   setUniform( UniformHandle u, bool val );
+
+    /**
+      setUniform only calls glUniform when the value differs from the one
+      last set through this object, so re-sending unchanged material or
+      light values each frame costs a comparison.  Code that writes the
+      program's uniforms directly with glUniform must call
+      forgetUniformValues() afterwards, making the next setUniform of each
+      uniform upload again.
+      */
+    void   forgetUniformValues();
+
+    // Call once a frame to count per frame
+    UniformStats getUniformStats() const { return uniformStats; }
+    void   resetUniformStats();
+
     void   printActiveUniforms();
     void   printActiveAttribs();
 };
@@ -2,6 +2,7 @@
 #define GLUTILS_H
 
 #include <gl/glew.h>			// OpenGL Extension "autoloader"
+#include <vector>
 
 class GLUtils
 {
@@ -11,6 +12,18 @@ public:
     static int checkForOpenGLError(const char *, int);
     static void dumpGLInfo(bool dumpExtensions = false);
 
+    // Uploads count indices into the bound GL_ELEMENT_ARRAY_BUFFER, packed
+    // as 16 bit values when nVerts is small enough for every index to fit.
+    // Returns the type (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT) to draw with.
+    static GLenum bufferElementData(const GLuint * el, GLsizei count, GLuint nVerts,
+                                    GLenum usage = GL_STATIC_DRAW);
+    // The packing bufferElementData uses: GL_UNSIGNED_SHORT with the indices
+    // narrowed into shortEl when nVerts allows, else GL_UNSIGNED_INT and
+    // shortEl left empty.  Upload shortEl when it isn't empty, el otherwise.
+    static GLenum packElements(const GLuint * el, GLsizei count, GLuint nVerts,
+                               std::vector<GLushort> & shortEl);
+    static GLsizei indexTypeSize(GLenum type);
+
     /////////////////////////////////////////////////////////////////////////////////////
     // Load a .TGA file
     static GLbyte *ReadTGABits(const char *szFileName, GLint *iWidth, GLint *iHeight, GLint *iComponents, GLenum *eFormat);
@@ -0,0 +1,57 @@
+#ifndef INSTANCEBUFFER_H
+#define INSTANCEBUFFER_H
+
+#include <cstddef>
+#include <glm/glm.hpp>
+using glm::mat4;
+
+/**
+  Per instance data for Drawable::renderInstanced, in one GL buffer: a
+  model matrix and a material index for every instance.  Attached to a
+  drawable's vertex array it feeds attributes 4 to 7 (the columns of the
+  model matrix) and 8 (the material index, an integer attribute), each
+  advancing once per instance.  The instanced shader variants (e.g.
+  edge/edgeinstanced.vs) build the model-view, normal and MVP matrices
+  from it, so the model matrices must not scale unevenly.
+  */
+class InstanceBuffer
+{
+public:
+    static const unsigned int MODEL_LOCATION = 4;
+    static const unsigned int MATERIAL_LOCATION = 8;
+
+    struct Instance
+    {
+        mat4 model;
+        unsigned int material;  // Index into the shader's material array
+    };
+
+private:
+    unsigned int handle;
+    int count;
+    int capacity;
+
+    // Not copyable
+    InstanceBuffer( const InstanceBuffer & );
+    InstanceBuffer & operator=( const InstanceBuffer & );
+
+public:
+    InstanceBuffer();
+    ~InstanceBuffer();
+
+    /**
+      Replaces the contents with count instances.  The storage is
+      respecified when it has to grow and overwritten otherwise.
+      */
+    void update( const Instance * instances, int count );
+
+    /**
+      Sets up the instance attributes of the currently bound vertex array.
+      */
+    void bindAttributes() const;
+
+    int size() const { return count; }
+    unsigned int getHandle() const { return handle; }
+};
+
+#endif // INSTANCEBUFFER_H
@@ -0,0 +1,40 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+/**
+  Read-only view of an entire file mapped into the address space.
+  The bytes are not null terminated, so always scan up to data() + size().
+  An empty file opens successfully with a NULL data pointer.
+  */
+class MappedFile
+{
+private:
+    const char * bytes;
+    size_t length;
+    bool opened;
+#ifdef WIN32
+    void * fileHandle;
+    void * mapHandle;
+#else
+    int fd;
+#endif
+
+    // Not copyable
+    MappedFile( const MappedFile & );
+    MappedFile & operator=( const MappedFile & );
+
+public:
+    MappedFile();
+    ~MappedFile();
+
+    bool open( const char * fileName );
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char * data() const { return bytes; }
+    size_t size() const { return length; }
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,116 @@
+#ifndef MESHCACHE_H
+#define MESHCACHE_H
+
+#include "mappedfile.h"
+
+#include <vector>
+using std::vector;
+#include <string>
+using std::string;
+#include <glm/glm.hpp>
+using glm::vec3;
+
+/**
+  Final, ready to upload vertex and index data for a mesh.  The data is
+  either built in memory (assign) or memory mapped from a binary cache
+  file written by an earlier run (open).  Either way the pointers can be
+  handed straight to glBufferData.
+
+  Cache file layout: a MeshCache::Header, followed by nVerts * stride
+  floats of interleaved vertex data, followed by nIndices 32-bit indices.
+  The indices hold one or more levels of detail back to back, all
+  referencing the same vertices; level 0 is the full mesh.
+  */
+class MeshCache
+{
+public:
+    enum Attribute {
+        POSITION = 1, NORMAL = 2, TEXCOORD = 4, TANGENT = 8
+    };
+
+    static const unsigned int MAX_LODS = 8;
+
+    struct Header
+    {
+        char               magic[8];
+        unsigned int       version;
+        unsigned int       nLods;
+        unsigned long long flags;          // Load options the data depends on
+        unsigned long long sourceHash;     // Hash of the source file contents
+        unsigned long long sourceSize;
+        unsigned int       nVerts;
+        unsigned int       nIndices;
+        unsigned int       stride;         // Floats per vertex
+        unsigned int       attributes;     // Attribute bits, in layout order
+        float              boundsMin[3];
+        float              boundsMax[3];
+        unsigned long long payloadHash;    // Hash of the rest of the header, vertices and indices
+        unsigned int       lodIndexCount[MAX_LODS];
+        float              lodError[MAX_LODS];  // Estimated distance from level 0, model units
+    };
+
+private:
+    MappedFile file;
+    vector<float> vertexStore;
+    vector<unsigned int> indexStore;
+
+    Header header;
+    const float * vertexData;
+    const unsigned int * indexData;
+
+    // Not copyable
+    MeshCache( const MeshCache & );
+    MeshCache & operator=( const MeshCache & );
+
+public:
+    static const unsigned int VERSION = 6;
+
+    MeshCache();
+
+    static unsigned long long hash( const void * data, size_t size,
+                                    unsigned long long seed = 14695981039346656037ULL );
+    static bool hashFile( const char * fileName, unsigned long long & hash,
+                          unsigned long long & size );
+
+    /**
+      Maps and validates a cache file.  Returns false if the file is
+      missing, truncated, from another version, built from different
+      source data or load options, or fails its checksum, which covers
+      the header too.  The header must also agree with itself and the data:
+      a stride matching the attributes, levels that add up to the index
+      count in whole triangles, and no index past the last vertex.
+      */
+    bool open( const char * cacheFile, unsigned long long sourceHash,
+               unsigned long long sourceSize, unsigned long long flags );
+
+    /**
+      Takes ownership of freshly built data (the vectors are swapped out).
+      Without a level table all the indices form a single level.
+      */
+    void assign( vector<float> & verts, vector<unsigned int> & indices,
+                 unsigned int stride, unsigned int attributes,
+                 unsigned long long sourceHash, unsigned long long sourceSize,
+                 unsigned long long flags, unsigned int nLods = 0,
+                 const unsigned int * lodIndexCounts = NULL,
+                 const float * lodErrors = NULL );
+
+    bool write( const char * cacheFile ) const;
+
+    void clear();
+
+    bool isMapped() const { return file.isOpen(); }
+    const float * vertices() const { return vertexData; }
+    const unsigned int * indices() const { return indexData; }
+    unsigned int vertexCount() const { return header.nVerts; }
+    unsigned int indexCount() const { return header.nIndices; }
+    unsigned int stride() const { return header.stride; }
+    unsigned int attributes() const { return header.attributes; }
+    unsigned int lodCount() const { return header.nLods; }
+    unsigned int lodIndexOffset( unsigned int lod ) const;
+    unsigned int lodIndexCount( unsigned int lod ) const { return header.lodIndexCount[lod]; }
+    float lodError( unsigned int lod ) const { return header.lodError[lod]; }
+    vec3 boundsMin() const;
+    vec3 boundsMax() const;
+};
+
+#endif // MESHCACHE_H
@@ -0,0 +1,77 @@
+#ifndef MESHDATA_H
+#define MESHDATA_H
+
+#include <cstddef>
+#include <vector>
+using std::vector;
+#include <glm/glm.hpp>
+using glm::vec3;
+
+/**
+  Triangle mesh geometry on the CPU, as produced by the generate functions
+  of the VBO classes.  Nothing here touches GL, so meshes can be built,
+  measured and cached on any thread; MeshDrawable uploads one.
+
+  Each attribute is a tightly packed stream with one entry per vertex, or
+  empty when the mesh doesn't have it.  Indices form a triangle list, or
+  triangle strips separated by RESTART_INDEX.
+  */
+class MeshData
+{
+public:
+    enum Primitive { TRIANGLES, TRIANGLE_STRIPS };
+    static const unsigned int RESTART_INDEX = 0xffffffff;
+
+    vector<float> positions;        // x, y, z
+    vector<float> normals;          // x, y, z
+    vector<float> texCoords;        // s, t
+    vector<float> tangents;         // x, y, z, handedness
+    vector<unsigned int> indices;
+    Primitive primitive;
+    vec3 boundsMin, boundsMax;
+
+    MeshData();
+
+    size_t vertexCount() const { return positions.size() / 3; }
+
+    // Triangles drawn, not counting the degenerate ones joining strips
+    size_t triangleCount() const;
+
+    /**
+      The triangles as a list, whichever the primitive, for the passes
+      and queries that take one.  Strips are unrolled keeping their
+      winding, and degenerate triangles are left out.
+      */
+    void triangleList( vector<unsigned int> & out ) const;
+
+    /**
+      Allocates every stream for nVerts vertices and nIndices indices,
+      including the optional ones asked for.
+      */
+    void resize( size_t nVerts, size_t nIndices, bool withNormals = true,
+                 bool withTexCoords = true, bool withTangents = false );
+
+    /**
+      Merges vertices that lie within positionTolerance of each other and
+      whose unit normals are within normalTolerance (or that have no
+      normals), keeping the first of each group, and rewrites the indices
+      to share them.  Texture coordinates, when present, must match to
+      within normalTolerance too.  Clearing matchTexCoords merges
+      vertices whatever their coordinates, keeping the first one's, which
+      is only right for meshes that won't be textured.  Triangles left
+      with a repeated vertex are removed from a list (strips are only
+      renumbered).  Returns the new vertex count.
+      */
+    size_t weld( float positionTolerance = 1e-5f, float normalTolerance = 1e-3f,
+                 bool matchTexCoords = true );
+
+    // Sets boundsMin/boundsMax from the positions
+    void computeBounds();
+
+    // Bytes held by the streams
+    size_t memoryBytes() const;
+
+    void clear();
+};
+
+#endif // MESHDATA_H
@@ -0,0 +1,38 @@
+#ifndef MESHDRAWABLE_H
+#define MESHDRAWABLE_H
+
+#include "drawable.h"
+#include "meshdata.h"
+
+/**
+  A MeshData uploaded to GL: a VAO with one attribute per stream present
+  (0 position, 1 normal, 2 texture coordinate, 3 tangent) and an element
+  buffer, drawn as a triangle list or, for MeshData::TRIANGLE_STRIPS, as
+  strips with primitive restart.  The CPU data can be freed afterwards.
+  The VBO shape classes derive from this, generating their MeshData and
+  calling upload() from their constructors.
+  */
+class MeshDrawable : public Drawable
+{
+protected:
+    unsigned int indexType;
+    unsigned int indexCount;
+    MeshData::Primitive primitive;
+
+    MeshDrawable();
+
+    void upload( const MeshData & data, VertexLayout layout,
+                 VertexCompression compression );
+
+    // render() and renderInstanced(), which only differ in the draw call
+    void draw( int instances, bool instanced ) const;
+
+public:
+    MeshDrawable( const MeshData & data, VertexLayout layout = SPLIT_BUFFERS,
+                  VertexCompression compression = NO_COMPRESSION );
+
+    void render() const;
+    void renderInstanced( int count ) const;
+};
+
+#endif // MESHDRAWABLE_H
@@ -0,0 +1,79 @@
+#ifndef MESHLETS_H
+#define MESHLETS_H
+
+#include <cstddef>
+#include <vector>
+using std::vector;
+#include <glm/glm.hpp>
+using glm::vec3;
+using glm::vec4;
+using glm::mat4;
+
+/**
+  Partitions an indexed triangle list into small clusters (meshlets) that
+  can be culled independently.  Each cluster is grown from a seed triangle
+  through its neighbours, preferring triangles that add no vertices and
+  then those facing the same way, which keeps clusters compact and their
+  normal cones narrow.  Every cluster carries a bounding sphere for
+  frustum culling and a normal cone for backface culling.  The triangles
+  are kept regrouped by cluster, each cluster being a contiguous range of
+  clusterIndices().
+  */
+class Meshlets
+{
+public:
+    static const unsigned int MAX_VERTICES = 64;
+    static const unsigned int MAX_TRIANGLES = 124;
+
+    struct Meshlet
+    {
+        unsigned int firstIndex;
+        unsigned int indexCount;
+        unsigned int vertexCount;   // Distinct vertices used
+        vec3 center;                // Bounding sphere
+        float radius;
+        vec3 coneAxis;              // Average facing of the triangles
+        float coneCutoff;           // Sine of the cone half angle, > 1 when the cone is useless
+    };
+
+    struct CullStats
+    {
+        unsigned int visible;
+        unsigned int frustumCulled;
+        unsigned int backfaceCulled;
+    };
+
+private:
+    vector<Meshlet> meshlets;
+    vector<unsigned int> indices;
+
+public:
+    /**
+      Builds the clusters from an index list.  Seeds are taken in index
+      order, so running the vertex cache pass first helps locality.
+      Positions are the first three floats of each vertex.
+      */
+    void build( const unsigned int * indices, size_t nIndices,
+                const float * verts, size_t stride, size_t nVerts,
+                unsigned int maxVertices = MAX_VERTICES,
+                unsigned int maxTriangles = MAX_TRIANGLES );
+
+    /**
+      Writes the indices of the clusters that may be visible to out, in
+      cluster order, and returns how many were written.  mvp maps the
+      mesh's coordinates to clip space.  camera is the eye position in the
+      same coordinates (w = 1), or for an orthographic view the direction
+      the camera looks along (w = 0).
+      */
+    size_t cull( const mat4 & mvp, const vec4 & camera, vector<unsigned int> & out,
+                 CullStats * stats = NULL ) const;
+
+    size_t size() const { return meshlets.size(); }
+    const Meshlet & operator[]( size_t i ) const { return meshlets[i]; }
+    const unsigned int * clusterIndices() const { return indices.empty() ? NULL : &indices[0]; }
+    size_t indexCount() const { return indices.size(); }
+
+    void swap( Meshlets & other ) { meshlets.swap(other.meshlets); indices.swap(other.indices); }
+};
+
+#endif // MESHLETS_H
@@ -0,0 +1,107 @@
+#ifndef MESHOPTIMIZER_H
+#define MESHOPTIMIZER_H
+
+#include <cstddef>
+
+/**
+  Index and vertex buffer reordering passes for indexed triangle lists,
+  plus CPU simulations of the GPU caches they target so the effect can
+  be measured.
+  */
+class MeshOptimizer
+{
+public:
+    struct VertexCacheStats
+    {
+        unsigned int transforms;    // Vertex shader invocations
+        float acmr;                 // Average cache miss ratio: transforms per triangle
+        float atvr;                 // Average transform to vertex ratio (1.0 is ideal)
+    };
+
+    struct VertexFetchStats
+    {
+        unsigned int bytesFetched;  // Memory traffic from vertex fetch
+        unsigned int lineMisses;    // Fetch cache line misses
+        float overfetch;            // Bytes fetched / vertex buffer size (1.0 is ideal)
+    };
+
+    struct OverdrawStats
+    {
+        unsigned int covered;       // Pixels touched by at least one fragment
+        unsigned int shaded;        // Fragments that passed the depth test
+        float overdraw;             // Shaded / covered (1.0 is ideal)
+    };
+
+    /**
+      Reorders the triangles in place for the post-transform vertex cache,
+      using Tom Forsyth's linear-speed vertex cache optimization.  The
+      vertices themselves are not touched.
+      */
+    static void optimizeVertexCache( unsigned int * indices, size_t nIndices, size_t nVerts );
+
+    /**
+      Simulates a FIFO post-transform cache of the given size.
+      */
+    static VertexCacheStats analyzeVertexCache( const unsigned int * indices, size_t nIndices,
+                                                size_t nVerts, unsigned int cacheSize = 16 );
+
+    /**
+      Reorders groups of triangles so that those likely to occlude the rest
+      of the mesh are drawn first.  The index buffer is cut into clusters at
+      post-transform cache boundaries (and further while the cluster's ACMR
+      stays within threshold times the original), then clusters are sorted
+      by how far they face away from the mesh centroid.  Clusters that
+      sort about the same keep their order, and the sort is coarsened
+      until the whole buffer's ACMR is within threshold times the input's;
+      if no order qualifies the indices are left alone.  Run it after
+      optimizeVertexCache.  Positions are the first three floats of each
+      vertex.
+      */
+    static void optimizeOverdraw( unsigned int * indices, size_t nIndices,
+                                  const float * verts, size_t stride, size_t nVerts,
+                                  float threshold = 1.05f );
+
+    /**
+      Renders the mesh from 14 directions around its bounding sphere with a
+      CPU depth-buffered rasterizer (no culling) and counts fragments.
+      */
+    static OverdrawStats analyzeOverdraw( const unsigned int * indices, size_t nIndices,
+                                          const float * verts, size_t stride, size_t nVerts );
+
+    /**
+      Renumbers the vertices in order of first use by the index buffer, so
+      that vertex fetch walks memory sequentially.  verts is an interleaved
+      array of stride floats per vertex; it and the indices are rewritten
+      in place.  Unreferenced vertices are dropped.  Returns the new vertex
+      count.  This must be the last pass, as it changes vertex numbering.
+      */
+    static size_t optimizeVertexFetch( float * verts, size_t stride,
+                                       unsigned int * indices, size_t nIndices, size_t nVerts );
+
+    /**
+      Simulates vertex fetch behind a 16 entry post-transform cache, with
+      a 4KB cache of 64 byte lines in front of the vertex buffer.
+      */
+    static VertexFetchStats analyzeVertexFetch( const unsigned int * indices, size_t nIndices,
+                                                size_t nVerts, size_t vertexSize );
+
+    /**
+      Reduces the triangle count towards targetIndexCount by collapsing
+      edges in order of quadric error.  Each collapse merges a vertex into
+      one of its neighbours, so the result only references existing
+      vertices and can share the original vertex buffer.  Attribute seams,
+      border corners and non-manifold edges are kept; border vertices
+      only slide along the border.  The result is written to destination
+      (room for nIndices, may alias indices) and its index count returned,
+      which stays above the target when no valid collapses remain.
+      resultError receives the square root of the largest quadric error
+      among the collapses made: roughly how far a merged vertex ended up
+      from the planes of the triangles it started in, in model units.  It
+      is an estimate of the deviation, not a bound on it.
+      */
+    static size_t simplify( unsigned int * destination, const unsigned int * indices, size_t nIndices,
+                            const float * verts, size_t stride, size_t nVerts,
+                            size_t targetIndexCount, float * resultError = NULL );
+};
+
+#endif // MESHOPTIMIZER_H
@@ -0,0 +1,78 @@
+#ifndef OBJPARSER_H
+#define OBJPARSER_H
+
+#include <vector>
+using std::vector;
+#include <glm/glm.hpp>
+using glm::vec3;
+using glm::vec2;
+
+/**
+  Raw attribute streams read from a Wavefront OBJ file, in file order.
+  faces holds three point indices per triangle; faceTexCoords and
+  faceNormals hold the matching vt and vn indices (-1 where absent).
+  */
+struct ObjData
+{
+    vector<vec3> points;
+    vector<vec3> normals;
+    vector<vec2> texCoords;
+    vector<int>  faces;
+    vector<int>  faceTexCoords;
+    vector<int>  faceNormals;
+    int nFaces;     // Number of face records, including rejected ones
+
+    ObjData() : nFaces(0) { }
+    void clear();
+
+    /**
+      True if any face vertex uses different v, vt and vn indices, in
+      which case the streams can't be used as a single indexed vertex
+      array until weld() has been called.
+      */
+    bool needsWelding() const;
+
+    /**
+      Replaces the attribute streams with one entry per unique (v, vt, vn)
+      triple referenced by the faces, in order of first use, and remaps
+      the faces to index it.  Afterwards all three face index streams are
+      identical.  Returns the number of unique vertices.
+      */
+    size_t weld();
+};
+
+class ObjParser
+{
+public:
+    /**
+      Memory maps the file and tokenizes it in place.  With nThreads other
+      than 1 the file is split into newline aligned chunks that are parsed
+      concurrently (0 picks one thread per hardware thread).  The result
+      is identical to the serial parse.  Returns false if the file could
+      not be opened.
+      */
+    static bool parseFile( const char * fileName, ObjData & obj, int nThreads = 1 );
+
+    /**
+      Parses the bytes in [begin, end).  The range does not need to be
+      null terminated.
+      */
+    static void parseBuffer( const char * begin, const char * end, ObjData & obj );
+
+    /**
+      Parallel version of parseBuffer.  Each chunk is parsed into its own
+      ObjData and the results are appended in file order.  OBJ indices are
+      absolute, so faces need no rebasing when the chunks are merged.
+      */
+    static void parseBufferParallel( const char * begin, const char * end,
+                                     ObjData & obj, int nThreads );
+
+    /**
+      The original getline/istringstream reader.  Kept as the reference
+      implementation for the benchmarks and as a fallback if the file
+      cannot be mapped.
+      */
+    static bool parseStream( const char * fileName, ObjData & obj );
+};
+
+#endif // OBJPARSER_H
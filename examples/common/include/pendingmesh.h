@@ -0,0 +1,62 @@
+#ifndef PENDINGMESH_H
+#define PENDINGMESH_H
+
+#include "vbomesh.h"
+#include "meshcache.h"
+
+#include <future>
+#include <string>
+using std::string;
+
+/**
+  A VBOMesh being loaded in the background.  The constructor starts
+  VBOMesh::loadVertexData (parsing, normals, tangents, optimization passes,
+  the binary cache, vertex compression, index narrowing and meshlets) on
+  a worker thread and returns at once.  The render thread polls ready()
+  each frame, drawing something else in the meantime, and then calls
+  upload(), which only creates and fills the GL buffers.  Destroying a
+  pending load waits for the worker to finish.
+  */
+class PendingMesh
+{
+private:
+    string fileName;
+    VBOMesh::Options options;
+    VBOMesh::UploadData loaded;
+    std::future<bool> result;
+    bool finished;
+    bool succeeded;
+
+    // Not copyable
+    PendingMesh( const PendingMesh & );
+    PendingMesh & operator=( const PendingMesh & );
+
+    void collect();
+
+public:
+    PendingMesh( const char * fileName, const VBOMesh::Options & options );
+    ~PendingMesh();
+
+    /**
+      True once the CPU work is done, successfully or not.  Never blocks.
+      */
+    bool ready();
+
+    /**
+      Blocks until the CPU work is done.  Returns false if the OBJ file
+      couldn't be opened.
+      */
+    bool wait();
+
+    /**
+      Creates the mesh from the loaded data; call on the GL thread.
+      Returns NULL if the data isn't ready yet or the load failed.  The
+      CPU copy of the data is released afterwards, so this succeeds once.
+      */
+    VBOMesh * upload();
+
+    bool failed() { return ready() && ! succeeded; }
+    const char * name() const { return fileName.c_str(); }
+};
+
+#endif // PENDINGMESH_H
@@ -1,17 +1,18 @@
 #ifndef VBOCUBE_H
 #define VBOCUBE_H
-#include "drawable.h"
+#include "meshdrawable.h"
 
-class VBOCube : public Drawable
+class VBOCube : public MeshDrawable
 {
-
-private:
-    unsigned int vaoHandle;
-
 public:
-    VBOCube();
+    VBOCube(VertexLayout layout = SPLIT_BUFFERS,
+            VertexCompression compression = NO_COMPRESSION);
 
-    void render() const;
+    /**
+      The CPU half of the constructor: a unit cube with separate vertices
+      per face, with no GL calls.
+      */
+    static void generate(MeshData & data);
 };
 
 #endif // VBOCUBE_H
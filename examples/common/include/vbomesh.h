@@ -2,6 +2,9 @@
 #define VBOMESH_H
 
 #include "drawable.h"
+#include "meshcache.h"
+#include "meshlets.h"
+#include "meshdata.h"
 
 #include <vector>
 using std::vector;
@@ -15,34 +18,200 @@ using std::string;
 
 class VBOMesh : public Drawable
 {
+public:
+    struct UploadData;
+
 private:
-    unsigned int faces;
-    unsigned int vaoHandle;
+    unsigned int indexType;
+    unsigned int vertexCount;
+    unsigned int nLods;
+    unsigned int lodFirst[MeshCache::MAX_LODS];    // First index of each level
+    unsigned int lodCount[MeshCache::MAX_LODS];    // Index count of each level
+    float lodError[MeshCache::MAX_LODS];
+
+    Meshlets meshlets;
+    unsigned int cullHandle;        // Per frame index buffer of visible meshlets
+    vector<unsigned int> visibleIndices;
 
-    void trimString( string & str );
-    void storeVBO( const vector<vec3> & points,
+    void storeVBO( UploadData & upload );
+    static void interleave( const vector<vec3> & points,
                             const vector<vec3> & normals,
-                            const vector<vec2> &texCoords,
-                            const vector<vec4> &tangents,
-                            const vector<int> &elements );
-    void generateAveragedNormals(
+                            const vector<vec2> & texCoords,
+                            const vector<vec4> & tangents,
+                            vector<float> & verts,
+                            unsigned int & stride,
+                            unsigned int & attributes );
+    static void center(vector<vec3> &);
+
+public:
+    /**
+      Load-time settings.  The defaults match the plain constructor.
+      */
+    struct Options
+    {
+        bool reCenterMesh;
+        int  loadThreads;   // Parser, normal and tangent threads; 0 = one per hardware thread
+        bool useCache;      // Read/write a binary <fileName>.vbocache sidecar
+        bool optimizeVertexCache;   // Reorder triangles for the post-transform cache
+        bool optimizeOverdraw;      // Then sort triangle clusters outside-in
+        float overdrawThreshold;    // ACMR the overdraw pass may trade away (1.05 = 5%)
+        bool optimizeVertexFetch;   // Renumber vertices in order of first use
+        VertexLayout layout;        // GL buffer layout; doesn't affect the cache
+        VertexCompression compression;  // GL vertex formats; doesn't affect the cache
+        int  lodLevels;     // Simplified levels after the full mesh, each with half the triangles
+        bool buildMeshlets; // Cluster the full mesh for renderCulled; doesn't affect the cache
+
+        Options() : reCenterMesh(false), loadThreads(1), useCache(false),
+                    optimizeVertexCache(false), optimizeOverdraw(false),
+                    overdrawThreshold(1.05f), optimizeVertexFetch(false),
+                    layout(INTERLEAVED), compression(NO_COMPRESSION),
+                    lodLevels(0), buildMeshlets(false) { }
+
+        // Bits for the options that change the final vertex data
+        unsigned long long cacheFlags() const;
+    };
+
+    /**
+      A loaded mesh with everything the GL side needs already worked out:
+      the vertices encoded in the options' layout and formats, the indices
+      narrowed and, with buildMeshlets, the meshlets.  The encoded data
+      may point into data.  Filled by loadVertexData on any thread.
+      */
+    struct UploadData
+    {
+        MeshCache data;
+        EncodedVertices vertices;
+        EncodedIndices indices;
+        Meshlets meshlets;
+
+        // Releases all of it
+        void clear();
+    };
+
+    VBOMesh( const char * fileName, bool reCenterMesh = false );
+    VBOMesh( const char * fileName, const Options & options );
+
+    /**
+      Uploads data already produced by loadVertexData, e.g. on another
+      thread (see PendingMesh).  Only the GL work happens here: buffers
+      are created and filled, and the meshlets are taken over.
+      */
+    VBOMesh( UploadData & upload );
+
+    // Deletes the culled index buffer; Drawable frees the rest
+    ~VBOMesh();
+
+    void render() const;
+
+    // The full mesh
+    void renderInstanced( int count ) const;
+
+    /**
+      Draws one level of detail (0 is the full mesh, out of range levels
+      are clamped to the coarsest).
+      */
+    void render( int lod ) const;
+
+    int getLodCount() const { return (int)nLods; }
+
+    /**
+      Estimate of how far level lod strays from the full mesh, in model
+      units: the quadric error of each simplification step, summed.  It is
+      not a bound, and parts of a level can stray further.
+      */
+    float getLodError( int lod ) const { return lodError[lod]; }
+
+    /**
+      The coarsest level whose error stays within maxPixelError once
+      projected, given the number of pixels one model unit covers at the
+      mesh's distance (e.g. viewportHeight * projection[1][1] / (2 * depth)
+      for a perspective projection).  The errors are estimates, so leave
+      some margin in maxPixelError where popping matters.
+      */
+    int selectLod( float pixelsPerUnit, float maxPixelError = 1.0f ) const;
+
+    /**
+      Draws the full mesh minus the meshlets that are outside the frustum
+      or facing away, as found by Meshlets::cull.  The visible indices are
+      streamed into a separate element buffer every call.  mvp and camera
+      are in the mesh's coordinates, before getPositionTransform().  Falls
+      back to render() when the mesh was loaded without meshlets.  Returns
+      the number of triangles drawn.
+      */
+    unsigned int renderCulled( const mat4 & mvp, const vec4 & camera,
+                               Meshlets::CullStats * stats = NULL );
+
+    const Meshlets & getMeshlets() const { return meshlets; }
+
+    void loadOBJ( const char * fileName, bool );
+    void loadOBJ( const char * fileName, const Options & options );
+
+    /**
+      The CPU half of loadOBJ.  Produces the final interleaved vertex and
+      index data without touching GL, mapping a valid cache instead of
+      parsing when the options allow it and (re)writing the cache when it
+      is missing or stale.  Returns false if the OBJ file can't be opened.
+      */
+    static bool loadVertexData( const char * fileName, const Options & options,
+                                MeshCache & data );
+
+    /**
+      The same, then also encodes the vertices and indices and builds the
+      meshlets as the options ask, leaving the constructor taking upload
+      only buffer copies.
+      */
+    static bool loadVertexData( const char * fileName, const Options & options,
+                                UploadData & upload );
+
+    /**
+      loadVertexData split back into separate attribute streams, for code
+      that works on MeshData.  Only the full detail level is kept.
+      */
+    static bool loadMeshData( const char * fileName, const Options & options,
+                              MeshData & data );
+
+    /**
+      Per vertex normals, the average of the normals of the faces using
+      each point.  Faces with no area are skipped.
+      */
+    static void generateAveragedNormals(
             const vector<vec3> & points,
             vector<vec3> & normals,
             const vector<int> & faces );
-    void generateTangents(
+
+    /**
+      Per vertex tangents, orthogonalized against the normal, with the
+      handedness of the texture space in w.  Faces with a degenerate
+      texture mapping are skipped.
+      */
+    static void generateTangents(
             const vector<vec3> & points,
             const vector<vec3> & normals,
             const vector<int> & faces,
             const vector<vec2> & texCoords,
             vector<vec4> & tangents);
-    void center(vector<vec3> &);
-
-public:
-    VBOMesh( const char * fileName, bool reCenterMesh = false );
 
-    void render() const;
-
-    void loadOBJ( const char * fileName, bool );
+    /**
+      Parallel versions of the two above (nThreads 0 = one per hardware
+      thread).  The faces are split into one range per thread, each thread
+      accumulating into its own buffer, and the buffers are then summed and
+      normalized per vertex.  Both steps work on four faces or vertices at
+      a time (see float4.h).  The results agree with the serial versions
+      to within rounding, and are the same from run to run for a given
+      thread count.
+      */
+    static void generateAveragedNormalsParallel(
+            const vector<vec3> & points,
+            vector<vec3> & normals,
+            const vector<int> & faces,
+            int nThreads );
+    static void generateTangentsParallel(
+            const vector<vec3> & points,
+            const vector<vec3> & normals,
+            const vector<int> & faces,
+            const vector<vec2> & texCoords,
+            vector<vec4> & tangents,
+            int nThreads );
 };
 
 #endif // VBOMESH_H
@@ -1,18 +1,25 @@
 #ifndef VBOPLANE_H
 #define VBOPLANE_H
 
-#include "drawable.h"
+#include "meshdrawable.h"
 
-class VBOPlane : public Drawable
+class VBOPlane : public MeshDrawable
 {
-private:
-    unsigned int vaoHandle;
-    int faces;
-
 public:
-    VBOPlane(float, float, int, int);
+    VBOPlane(float, float, int, int, VertexLayout layout = SPLIT_BUFFERS,
+             VertexCompression compression = NO_COMPRESSION,
+             MeshData::Primitive primitive = MeshData::TRIANGLES);
 
     void render() const;
+    void renderInstanced( int count ) const;
+
+    /**
+      The CPU half of the constructor: positions, texture coordinates and
+      indices, with no GL calls.  There are no normals; render() sets a
+      constant one.  TRIANGLE_STRIPS gives one strip per row of quads.
+      */
+    static void generate(MeshData & data, float xsize, float zsize, int xdivs, int zdivs,
+                         MeshData::Primitive primitive = MeshData::TRIANGLES);
 };
 
 #endif // VBOPLANE_H
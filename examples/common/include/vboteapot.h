@@ -1,39 +1,81 @@
 #ifndef VBOTEAPOT_H
 #define VBOTEAPOT_H
 
-#include "drawable.h"
+#include "meshdrawable.h"
 #include <glm/glm.hpp>
 using glm::vec3;
 using glm::mat3;
 using glm::mat4;
 
-class VBOTeapot : public Drawable
+class VBOTeapot : public MeshDrawable
 {
 private:
-    unsigned int vaoHandle;
-    unsigned int faces;
-
-    void generatePatches(float * v, float * n, float *tc, unsigned int* el, int grid);
-    void buildPatchReflect(int patchNum,
+    static void buildPatchReflect(int patchNum,
                            float *B, float *dB,
                            float *v, float *n, float *, unsigned int *el,
                            int &index, int &elIndex, int &, int grid,
                            bool reflectX, bool reflectY);
-    void buildPatch(vec3 patch[][4],
+    static void buildPatch(vec3 patch[][4],
                     float *B, float *dB,
                     float *v, float *n,float *, unsigned int *el,
                     int &index, int &elIndex, int &, int grid, mat3 reflect, bool invertNormal);
-    void getPatch( int patchNum, vec3 patch[][4], bool reverseV );
+    static void getPatch( int patchNum, vec3 patch[][4], bool reverseV );
 
-    void computeBasisFunctions( float * B, float * dB, int grid );
-    vec3 evaluate( int gridU, int gridV, float *B, vec3 patch[][4] );
-    vec3 evaluateNormal( int gridU, int gridV, float *B, float *dB, vec3 patch[][4] );
-    void moveLid(int,float *,mat4);
+    static void computeBasisFunctions( float * B, float * dB, int grid );
+    static vec3 evaluate( int gridU, int gridV, float *B, vec3 patch[][4] );
+    static vec3 evaluateNormal( int gridU, int gridV, float *B, float *dB, vec3 patch[][4] );
 
 public:
-    VBOTeapot(int grid, mat4 lidTransform);
+    VBOTeapot(int grid, mat4 lidTransform, bool optimizeVertexCache = false,
+              VertexLayout layout = SPLIT_BUFFERS,
+              VertexCompression compression = NO_COMPRESSION,
+              bool weldSeams = false,
+              MeshData::Primitive primitive = MeshData::TRIANGLES,
+              bool matchTexCoords = true);
+
+    /**
+      The CPU half of the constructor: positions, normals, texture
+      coordinates and indices, with no GL calls.  weldSeams shares the
+      vertices that neighbouring patches (and their reflections) both
+      generate along their common edges, where the normals agree (see
+      MeshData::weld).  Every patch maps the whole texture, so across most
+      seams the texture coordinates jump from 1 to 0: with matchTexCoords
+      those vertices stay separate and only a dozen are shared, whatever
+      the grid.  Clear it for a teapot that won't be textured to weld all
+      the seams (10% fewer vertices at grid 14), keeping one side's
+      coordinates.  TRIANGLE_STRIPS gives one strip per row of each
+      patch; the cache optimization only applies to a list, and is only
+      kept where it beats the patches' row order on a 32 entry FIFO cache
+      (grid 16 and up).
+      */
+    static void generate(MeshData & data, int grid, mat4 lidTransform,
+                         bool optimizeVertexCache = false, bool weldSeams = false,
+                         MeshData::Primitive primitive = MeshData::TRIANGLES,
+                         bool matchTexCoords = true);
+
+    /**
+      Fills 32 * (grid+1)^2 vertices and 6 * 32 * grid^2 indices.
+      */
+    static void generatePatches(float * v, float * n, float *tc, unsigned int* el, int grid);
 
-    void render() const;
+    /**
+      Same output as generatePatches, with the patches shared out between
+      nThreads threads (0 = one per hardware thread).  Each row of a patch
+      is first reduced to a cubic curve, then evaluated four vertices at a
+      time with SSE where available.  Agrees with generatePatches to within
+      rounding.
+      */
+    static void generatePatchesParallel(float * v, float * n, float * tc, unsigned int * el,
+                                        int grid, int nThreads = 0);
+    /**
+      The Bezier control points of the 32 patches (the ten in teapotdata.h
+      and their reflections), 16 per patch in u major order, as 3 floats
+      each: 32 * 16 * 3 floats in all.  Evaluating each patch gives the
+      same surface as generatePatches, with outward normals along
+      cross(dP/dv, dP/du).
+      */
+    static void generateControlPoints(float * cp, mat4 lidTransform);
+    static void moveLid(int,float *,mat4);
 };
 
 #endif // VBOTEAPOT_H
@@ -0,0 +1,45 @@
+#ifndef VBOTEAPOTPATCHES_H
+#define VBOTEAPOTPATCHES_H
+
+#include "drawable.h"
+#include <glm/glm.hpp>
+using glm::vec2;
+using glm::mat4;
+
+/**
+  The teapot as 32 bicubic Bezier patches, for tessellation on the GPU.
+  Only the control points are stored (6KB, against megabytes for a fine
+  VBOTeapot grid), at attribute 0, and render() draws them as GL_PATCHES
+  of 16 vertices.  The program must have tessellation control and
+  evaluation stages (OpenGL 4.0): see phongTeapot/teapotpatch.tcs, which
+  picks each patch's levels from its size on screen, and .tes, which
+  passes eye space positions and normals to teapotpatch.frag for lighting.
+  */
+class VBOTeapotPatches : public Drawable
+{
+public:
+    static const int PATCHES = 32;
+    static const int CONTROL_POINTS = 16;
+
+    VBOTeapotPatches(mat4 lidTransform);
+
+    void render() const;
+    void renderInstanced( int count ) const;
+
+    /**
+      The level selection done by teapotpatch.tcs, on the CPU, for one
+      patch of 16 control points (3 floats each).  The screen space length
+      of each edge's control polygon, divided by pixelsPerEdge and clamped
+      to [1, maxLevel], gives the outer levels; the inner levels are the
+      larger of the two facing outer levels.  Each edge is measured from
+      its end with the smaller (x, y, z), so that the patches on either
+      side get the same level whichever way round they list it.  Patches
+      entirely outside one of the frustum planes get zero levels, which
+      discards them.
+      */
+    static void tessLevels( const float * cp, const mat4 & mvp, const vec2 & viewport,
+                            float pixelsPerEdge, float maxLevel,
+                            float outer[4], float inner[2] );
+};
+
+#endif // VBOTEAPOTPATCHES_H
@@ -1,21 +1,31 @@
 #ifndef VBOTORUS_H
 #define VBOTORUS_H
 
-#include "drawable.h"
+#include "meshdrawable.h"
 
-class VBOTorus : public Drawable
+class VBOTorus : public MeshDrawable
 {
-private:
-    unsigned int vaoHandle;
-    int faces, rings, sides;
-
-    void generateVerts(float * , float * ,float *, unsigned int *,
-                       float , float);
-
 public:
-    VBOTorus(float, float, int, int);
+    VBOTorus(float, float, int, int, bool optimizeVertexCache = false,
+             VertexLayout layout = SPLIT_BUFFERS,
+             VertexCompression compression = NO_COMPRESSION,
+             MeshData::Primitive primitive = MeshData::TRIANGLES);
+
+    /**
+      The CPU half of the constructor: positions, normals, texture
+      coordinates and indices, with no GL calls.  TRIANGLE_STRIPS gives
+      one strip per ring, 2 * sides + 3 indices plus a restart, in place
+      of 6 * sides; the cache optimization only applies to a list.
+      */
+    static void generate(MeshData & data, float outerRadius, float innerRadius,
+                         int sides, int rings, bool optimizeVertexCache = false,
+                         MeshData::Primitive primitive = MeshData::TRIANGLES);
 
-    void render() const;
+    /**
+      Fills sides * (rings+1) vertices and 6 * sides * rings indices.
+      */
+    static void generateVerts(float * , float * ,float *, unsigned int *,
+                              float , float, int rings, int sides);
 };
 
 #endif // VBOTORUS_H
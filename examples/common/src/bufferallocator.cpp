@@ -0,0 +1,142 @@
+#include "bufferallocator.h"
+#include <GL/glew.h>
+
+BufferAllocator::BufferAllocator( size_t size ) : blockSize(size), allocations(0)
+{
+}
+
+BufferAllocator::~BufferAllocator()
+{
+    for( size_t b = 0; b < blocks.size(); b++ ) {
+        glDeleteBuffers(1, &blocks[b].buffer);
+    }
+}
+
+void BufferAllocator::addBlock( size_t size )
+{
+    Block block;
+    glGenBuffers(1, &block.buffer);
+    block.size = size;
+    block.used = 0;
+    block.freeRanges[0] = size;
+
+    // GL_COPY_WRITE_BUFFER so that the element buffer of whatever vertex
+    // array is bound doesn't change
+    glBindBuffer(GL_COPY_WRITE_BUFFER, block.buffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, size, NULL, GL_STATIC_DRAW);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    blocks.push_back(block);
+}
+
+bool BufferAllocator::allocateFrom( Block & block, size_t size, Range & range )
+{
+    for( map<size_t, size_t>::iterator it = block.freeRanges.begin();
+         it != block.freeRanges.end(); ++it ) {
+        if( it->second < size ) continue;
+
+        range.buffer = block.buffer;
+        range.offset = it->first;
+        range.size = size;
+        size_t rest = it->second - size;
+        block.freeRanges.erase(it);
+        if( rest > 0 ) block.freeRanges[range.offset + size] = rest;
+        block.used += size;
+        allocations++;
+        return true;
+    }
+    return false;
+}
+
+BufferAllocator::Range BufferAllocator::allocate( size_t bytes )
+{
+    Range range = { 0, 0, 0 };
+    if( bytes == 0 ) return range;
+
+    size_t size = (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    for( size_t b = 0; b < blocks.size(); b++ ) {
+        if( blocks[b].size - blocks[b].used >= size && allocateFrom(blocks[b], size, range) ) {
+            return range;
+        }
+    }
+    addBlock(size > blockSize ? size : blockSize);
+    allocateFrom(blocks.back(), size, range);
+    return range;
+}
+
+BufferAllocator::Range BufferAllocator::store( const void * data, size_t bytes )
+{
+    Range range = allocate(bytes);
+    if( range.buffer == 0 ) return range;
+    glBindBuffer(GL_COPY_WRITE_BUFFER, range.buffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, range.offset, bytes, data);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    return range;
+}
+
+void BufferAllocator::free( const Range & range )
+{
+    if( range.buffer == 0 ) return;
+
+    size_t b = 0;
+    while( b < blocks.size() && blocks[b].buffer != range.buffer ) b++;
+    if( b == blocks.size() ) return;
+    Block & block = blocks[b];
+
+    // Merge with the free neighbours
+    size_t offset = range.offset, size = range.size;
+    map<size_t, size_t>::iterator next = block.freeRanges.lower_bound(offset);
+    if( next != block.freeRanges.begin() ) {
+        map<size_t, size_t>::iterator prev = next;
+        --prev;
+        if( prev->first + prev->second == offset ) {
+            offset = prev->first;
+            size += prev->second;
+            block.freeRanges.erase(prev);
+        }
+    }
+    if( next != block.freeRanges.end() && next->first == range.offset + range.size ) {
+        size += next->second;
+        block.freeRanges.erase(next);
+    }
+    block.freeRanges[offset] = size;
+    block.used -= range.size;
+    allocations--;
+
+    if( block.used > 0 ) return;
+    for( size_t e = 0; e < blocks.size(); e++ ) {
+        if( e != b && blocks[e].used == 0 ) {
+            glDeleteBuffers(1, &block.buffer);
+            blocks.erase(blocks.begin() + b);
+            return;
+        }
+    }
+}
+
+BufferAllocator::Stats BufferAllocator::stats() const
+{
+    Stats s;
+    s.buffers = (unsigned int)blocks.size();
+    s.allocations = allocations;
+    s.reservedBytes = s.usedBytes = 0;
+    s.freeRanges = 0;
+    s.largestFreeRange = 0;
+    for( size_t b = 0; b < blocks.size(); b++ ) {
+        const Block & block = blocks[b];
+        s.reservedBytes += block.size;
+        s.usedBytes += block.used;
+        s.freeRanges += (unsigned int)block.freeRanges.size();
+        for( map<size_t, size_t>::const_iterator it = block.freeRanges.begin();
+             it != block.freeRanges.end(); ++it ) {
+            if( it->second > s.largestFreeRange ) s.largestFreeRange = it->second;
+        }
+    }
+    size_t freeBytes = s.reservedBytes - s.usedBytes;
+    s.fragmentation = freeBytes > 0 ? 1.0f - (float)s.largestFreeRange / freeBytes : 0.0f;
+    return s;
+}
+
+BufferAllocator & BufferAllocator::shared()
+{
+    static BufferAllocator * allocator = new BufferAllocator();
+    return *allocator;
+}
@@ -0,0 +1,422 @@
+#include "bvh.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define BVH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+const int binCount = 16;
+const unsigned int maxLeafSize = 8;
+const int maxSahDepth = 64;     // Below this, split at the median to bound the depth
+const int stackSize = 512;
+
+// Relative costs of visiting a node and testing a triangle, for the SAH
+const float traversalCost = 1.0f;
+const float intersectionCost = 1.0f;
+
+struct Box
+{
+    vec3 min, max;
+
+    Box() : min(FLT_MAX), max(-FLT_MAX) { }
+    void grow( const vec3 & p ) { min = glm::min(min, p); max = glm::max(max, p); }
+    void grow( const Box & b ) { min = glm::min(min, b.min); max = glm::max(max, b.max); }
+    float area() const
+    {
+        vec3 e = max - min;
+        return (e.x < 0.0f) ? 0.0f : 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+struct Reference
+{
+    Box bounds;
+    vec3 centroid;
+    unsigned int triangle;
+};
+
+struct BinaryNode
+{
+    Box bounds;
+    int left, right;        // -1 for a leaf
+    unsigned int first, count;
+};
+
+struct InBin
+{
+    int axis, bin;
+    float origin, scale;
+    bool operator()( const Reference & r ) const
+    {
+        int b = (int)((r.centroid[axis] - origin) * scale);
+        return std::min(b, binCount - 1) < bin;
+    }
+};
+
+struct CentroidLess
+{
+    int axis;
+    bool operator()( const Reference & a, const Reference & b ) const
+    {
+        return a.centroid[axis] < b.centroid[axis];
+    }
+};
+
+int buildBinary( vector<BinaryNode> & tree, vector<Reference> & refs,
+                 unsigned int first, unsigned int count, int depth )
+{
+    int index = (int)tree.size();
+    tree.push_back(BinaryNode());
+    Box bounds, centroids;
+    for( unsigned int i = first; i < first + count; i++ ) {
+        bounds.grow(refs[i].bounds);
+        centroids.grow(refs[i].centroid);
+    }
+    tree[index].bounds = bounds;
+    tree[index].left = tree[index].right = -1;
+    tree[index].first = first;
+    tree[index].count = count;
+    if( count <= 1 ) return index;
+
+    // Binned SAH over all three axes
+    float bestCost = FLT_MAX;
+    int bestAxis = -1, bestBin = 0;
+    vec3 extent = centroids.max - centroids.min;
+    for( int axis = 0; axis < 3 && depth < maxSahDepth; axis++ ) {
+        if( extent[axis] <= 0.0f ) continue;
+        float scale = binCount / extent[axis];
+        Box binBounds[binCount];
+        unsigned int binRefs[binCount] = { 0 };
+        for( unsigned int i = first; i < first + count; i++ ) {
+            int b = std::min((int)((refs[i].centroid[axis] - centroids.min[axis]) * scale), binCount - 1);
+            binBounds[b].grow(refs[i].bounds);
+            binRefs[b]++;
+        }
+
+        // Sweep from the right to get the cost of every right hand side
+        float rightCost[binCount];
+        Box right;
+        unsigned int nRight = 0;
+        for( int b = binCount - 1; b > 0; b-- ) {
+            right.grow(binBounds[b]);
+            nRight += binRefs[b];
+            rightCost[b] = right.area() * nRight;
+        }
+        Box left;
+        unsigned int nLeft = 0;
+        for( int b = 1; b < binCount; b++ ) {
+            left.grow(binBounds[b - 1]);
+            nLeft += binRefs[b - 1];
+            float cost = left.area() * nLeft + rightCost[b];
+            if( nLeft > 0 && nLeft < count && cost < bestCost ) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = b;
+            }
+        }
+    }
+
+    float parentArea = bounds.area();
+    float leafCost = intersectionCost * count;
+    float splitCost = (bestAxis < 0) ? FLT_MAX :
+            traversalCost + intersectionCost * bestCost / std::max(parentArea, FLT_MIN);
+    if( count <= maxLeafSize && leafCost <= splitCost ) return index;
+
+    unsigned int mid;
+    if( bestAxis >= 0 ) {
+        InBin inBin;
+        inBin.axis = bestAxis;
+        inBin.bin = bestBin;
+        inBin.origin = centroids.min[bestAxis];
+        inBin.scale = binCount / extent[bestAxis];
+        mid = (unsigned int)(std::partition(refs.begin() + first, refs.begin() + first + count, inBin) -
+                             refs.begin());
+    } else {
+        // No useful split (too deep, or every centroid in one place): halve
+        // the list along the longest axis
+        CentroidLess less;
+        less.axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+        mid = first + count / 2;
+        std::nth_element(refs.begin() + first, refs.begin() + mid, refs.begin() + first + count, less);
+    }
+
+    int left = buildBinary(tree, refs, first, mid - first, depth + 1);
+    int right = buildBinary(tree, refs, mid, first + count - mid, depth + 1);
+    tree[index].left = left;
+    tree[index].right = right;
+    return index;
+}
+
+// Turns the binary tree below b into four wide nodes, depth first.  Returns
+// the index of the node emitted for b.
+int collapse( vector<BVH::Node> & nodes, const vector<BinaryNode> & tree, int b )
+{
+    // Open up the largest inner child until there are four
+    int children[4] = { tree[b].left, tree[b].right, -1, -1 };
+    int nChildren = 2;
+    if( tree[b].left < 0 ) {
+        children[0] = b;
+        nChildren = 1;
+    }
+    while( nChildren < 4 ) {
+        int largest = -1;
+        float largestArea = -1.0f;
+        for( int i = 0; i < nChildren; i++ ) {
+            const BinaryNode & c = tree[children[i]];
+            if( c.left >= 0 && c.bounds.area() > largestArea ) {
+                largest = i;
+                largestArea = c.bounds.area();
+            }
+        }
+        if( largest < 0 ) break;
+        int opened = children[largest];
+        children[largest] = tree[opened].left;
+        children[nChildren++] = tree[opened].right;
+    }
+
+    int index = (int)nodes.size();
+    nodes.push_back(BVH::Node());
+    for( int i = 0; i < 4; i++ ) {
+        int child = -1;
+        unsigned int count = 0;
+        Box bounds;
+        if( i < nChildren ) {
+            const BinaryNode & c = tree[children[i]];
+            bounds = c.bounds;
+            if( c.left < 0 ) {
+                child = (int)c.first;
+                count = c.count;
+            } else {
+                child = collapse(nodes, tree, children[i]);
+            }
+        }
+        // Don't hold a reference across the recursion, nodes may grow
+        BVH::Node & node = nodes[index];
+        node.minX[i] = bounds.min.x; node.minY[i] = bounds.min.y; node.minZ[i] = bounds.min.z;
+        node.maxX[i] = bounds.max.x; node.maxY[i] = bounds.max.y; node.maxZ[i] = bounds.max.z;
+        node.child[i] = child;
+        node.count[i] = count;
+    }
+    return index;
+}
+
+// Slab test of the ray against the four child boxes.  Returns a bit per
+// child hit within [0, tMax], with the entry distances in tNear.
+inline int intersectBoxes( const BVH::Node & node, const vec3 & origin, const vec3 & invDir,
+                           float tMax, float tNear[4] )
+{
+#ifdef BVH_SSE2
+    __m128 ox = _mm_set1_ps(origin.x), oy = _mm_set1_ps(origin.y), oz = _mm_set1_ps(origin.z);
+    __m128 ix = _mm_set1_ps(invDir.x), iy = _mm_set1_ps(invDir.y), iz = _mm_set1_ps(invDir.z);
+
+    __m128 t0x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minX), ox), ix);
+    __m128 t1x = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxX), ox), ix);
+    __m128 t0y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minY), oy), iy);
+    __m128 t1y = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxY), oy), iy);
+    __m128 t0z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.minZ), oz), iz);
+    __m128 t1z = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(node.maxZ), oz), iz);
+
+    __m128 enter = _mm_max_ps(_mm_max_ps(_mm_min_ps(t0x, t1x), _mm_min_ps(t0y, t1y)),
+                              _mm_max_ps(_mm_min_ps(t0z, t1z), _mm_setzero_ps()));
+    __m128 leave = _mm_min_ps(_mm_min_ps(_mm_max_ps(t0x, t1x), _mm_max_ps(t0y, t1y)),
+                             _mm_min_ps(_mm_max_ps(t0z, t1z), _mm_set1_ps(tMax)));
+    _mm_storeu_ps(tNear, enter);
+    return _mm_movemask_ps(_mm_cmple_ps(enter, leave));
+#else
+    int mask = 0;
+    for( int i = 0; i < 4; i++ ) {
+        float t0x = (node.minX[i] - origin.x) * invDir.x, t1x = (node.maxX[i] - origin.x) * invDir.x;
+        float t0y = (node.minY[i] - origin.y) * invDir.y, t1y = (node.maxY[i] - origin.y) * invDir.y;
+        float t0z = (node.minZ[i] - origin.z) * invDir.z, t1z = (node.maxZ[i] - origin.z) * invDir.z;
+        float enter = std::max(std::max(std::min(t0x, t1x), std::min(t0y, t1y)),
+                               std::max(std::min(t0z, t1z), 0.0f));
+        float leave = std::min(std::min(std::max(t0x, t1x), std::max(t0y, t1y)),
+                              std::min(std::max(t0z, t1z), tMax));
+        tNear[i] = enter;
+        if( enter <= leave ) mask |= 1 << i;
+    }
+    return mask;
+#endif
+}
+
+}
+
+BVH::BVH()
+{
+}
+
+void BVH::build( const float * verts, size_t stride, size_t nVerts,
+                 const unsigned int * indices, size_t nIndices )
+{
+    nodes.clear();
+    triangles.clear();
+
+    size_t nTris = nIndices / 3;
+    if( nTris == 0 || nVerts == 0 ) return;
+
+    vector<Reference> refs(nTris);
+    for( size_t t = 0; t < nTris; t++ ) {
+        Reference & r = refs[t];
+        for( int k = 0; k < 3; k++ ) {
+            const float * p = verts + indices[t * 3 + k] * stride;
+            r.bounds.grow(vec3(p[0], p[1], p[2]));
+        }
+        r.centroid = 0.5f * (r.bounds.min + r.bounds.max);
+        r.triangle = (unsigned int)t;
+    }
+
+    vector<BinaryNode> tree;
+    tree.reserve(nTris * 2);
+    buildBinary(tree, refs, 0, (unsigned int)nTris, 0);
+    nodes.reserve(tree.size() / 2 + 1);
+    collapse(nodes, tree, 0);
+
+    // Triangles in leaf order, as a corner and two edges
+    triangles.resize(nTris);
+    for( size_t i = 0; i < nTris; i++ ) {
+        const unsigned int * tri = indices + refs[i].triangle * 3;
+        const float * p0 = verts + tri[0] * stride;
+        const float * p1 = verts + tri[1] * stride;
+        const float * p2 = verts + tri[2] * stride;
+        triangles[i].v0 = vec3(p0[0], p0[1], p0[2]);
+        triangles[i].edge1 = vec3(p1[0], p1[1], p1[2]) - triangles[i].v0;
+        triangles[i].edge2 = vec3(p2[0], p2[1], p2[2]) - triangles[i].v0;
+        triangles[i].index = refs[i].triangle;
+    }
+}
+
+template <bool anyHit>
+bool BVH::traverse( const vec3 & origin, const vec3 & direction, float tMax, Hit & hit ) const
+{
+    if( nodes.empty() ) return false;
+
+    // Keep the reciprocal finite so that 0 * inf can't produce a NaN
+    vec3 invDir;
+    for( int c = 0; c < 3; c++ ) {
+        float d = direction[c];
+        if( fabs(d) < 1e-20f ) d = (d < 0.0f) ? -1e-20f : 1e-20f;
+        invDir[c] = 1.0f / d;
+    }
+
+    int stack[stackSize];
+    int sp = 0;
+    stack[sp++] = 0;
+    float closest = tMax;
+    bool found = false;
+
+    while( sp > 0 ) {
+        const Node & node = nodes[stack[--sp]];
+        float tNear[4];
+        int mask = intersectBoxes(node, origin, invDir, closest, tNear);
+
+        // Inner children to visit, nearest first
+        int order[4];
+        int nOrder = 0;
+        for( int i = 0; i < 4; i++ ) {
+            if( !(mask & (1 << i)) || node.child[i] < 0 ) continue;
+
+            if( node.count[i] == 0 ) {
+                int j = nOrder++;
+                while( j > 0 && tNear[order[j - 1]] > tNear[i] ) {
+                    order[j] = order[j - 1];
+                    j--;
+                }
+                order[j] = i;
+                continue;
+            }
+
+            // Moller-Trumbore, both sides
+            for( unsigned int k = 0; k < node.count[i]; k++ ) {
+                const Triangle & tri = triangles[node.child[i] + k];
+                vec3 p = glm::cross(direction, tri.edge2);
+                float det = glm::dot(tri.edge1, p);
+                if( det == 0.0f ) continue;
+                float invDet = 1.0f / det;
+                vec3 s = origin - tri.v0;
+                float u = glm::dot(s, p) * invDet;
+                if( u < 0.0f || u > 1.0f ) continue;
+                vec3 q = glm::cross(s, tri.edge1);
+                float v = glm::dot(direction, q) * invDet;
+                if( v < 0.0f || u + v > 1.0f ) continue;
+                float t = glm::dot(tri.edge2, q) * invDet;
+                if( t < 0.0f || t >= closest ) continue;
+
+                closest = t;
+                found = true;
+                hit.t = t;
+                hit.triangle = tri.index;
+                hit.u = u;
+                hit.v = v;
+                if( anyHit ) return true;
+            }
+        }
+
+        // Push the farthest first so the nearest is popped next
+        for( int j = nOrder - 1; j >= 0 && sp < stackSize; j-- ) {
+            stack[sp++] = node.child[order[j]];
+        }
+    }
+    return found;
+}
+
+bool BVH::intersect( const vec3 & origin, const vec3 & direction, Hit & hit, float tMax ) const
+{
+    return traverse<false>(origin, direction, tMax, hit);
+}
+
+bool BVH::occluded( const vec3 & origin, const vec3 & direction, float tMax ) const
+{
+    Hit hit;
+    return traverse<true>(origin, direction, tMax, hit);
+}
+
+BVH::Stats BVH::stats() const
+{
+    Stats s;
+    s.nodes = (unsigned int)nodes.size();
+    s.leaves = 0;
+    s.maxDepth = 0;
+    s.sahCost = 0.0f;
+    if( nodes.empty() ) return s;
+
+    Box root;
+    for( int i = 0; i < 4; i++ ) {
+        if( nodes[0].child[i] < 0 ) continue;
+        root.grow(vec3(nodes[0].minX[i], nodes[0].minY[i], nodes[0].minZ[i]));
+        root.grow(vec3(nodes[0].maxX[i], nodes[0].maxY[i], nodes[0].maxZ[i]));
+    }
+    float rootArea = std::max(root.area(), FLT_MIN);
+
+    // Nodes are depth first, so a child's depth is known before it is visited
+    vector<unsigned int> depth(nodes.size(), 1);
+    s.sahCost = traversalCost;
+    for( size_t n = 0; n < nodes.size(); n++ ) {
+        const Node & node = nodes[n];
+        s.maxDepth = std::max(s.maxDepth, depth[n]);
+        for( int i = 0; i < 4; i++ ) {
+            if( node.child[i] < 0 ) continue;
+            Box b;
+            b.grow(vec3(node.minX[i], node.minY[i], node.minZ[i]));
+            b.grow(vec3(node.maxX[i], node.maxY[i], node.maxZ[i]));
+            float p = b.area() / rootArea;
+            if( node.count[i] > 0 ) {
+                s.leaves++;
+                s.sahCost += p * intersectionCost * node.count[i];
+            } else {
+                s.sahCost += p * traversalCost;
+                depth[node.child[i]] = depth[n] + 1;
+            }
+        }
+    }
+    return s;
+}
+
+size_t BVH::memoryBytes() const
+{
+    return nodes.size() * sizeof(Node) + triangles.size() * sizeof(Triangle);
+}
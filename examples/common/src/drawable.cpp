@@ -1,5 +1,292 @@
 #include "drawable.h"
+#include "instancebuffer.h"
+#include "glutils.h"
+#include <GL/glew.h>
 
-Drawable::Drawable()
+#include <glm/gtc/half_float.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+// How one attribute ends up in the buffer
+struct StoredFormat
+{
+    GLenum type;
+    GLint size;             // Components given to glVertexAttribPointer
+    GLboolean normalized;
+    int bytes;              // Per vertex, a multiple of four
+};
+
+StoredFormat storedFormat( const Drawable::VertexAttribute & attr,
+                           Drawable::VertexCompression compression )
+{
+    StoredFormat f = { GL_FLOAT, attr.size, GL_FALSE, attr.size * (int)sizeof(float) };
+    if( compression == Drawable::NO_COMPRESSION ) return f;
+
+    if( attr.usage == Drawable::DIRECTION && attr.size >= 3 ) {
+        f.type = GL_INT_2_10_10_10_REV;
+        f.size = 4;
+        f.normalized = GL_TRUE;
+        f.bytes = 4;
+    } else if( attr.usage == Drawable::TEXCOORD ) {
+        f.type = GL_HALF_FLOAT;
+        f.bytes = (attr.size * 2 + 3) & ~3;
+    } else if( attr.usage == Drawable::POSITION && compression == Drawable::COMPRESS_ALL ) {
+        f.type = GL_UNSIGNED_SHORT;
+        f.normalized = GL_TRUE;
+        f.bytes = (attr.size * 2 + 3) & ~3;
+    }
+    return f;
+}
+
+inline int snorm( float v, int maxValue )
+{
+    v = glm::clamp(v, -1.0f, 1.0f) * maxValue;
+    return (int)(v < 0.0f ? v - 0.5f : v + 0.5f);
+}
+
+// Signed normalized 10:10:10:2.  The handedness in w is stored as -2 or
+// +1, which decodes to exactly -1 and +1 under both the GL 3.3 and the
+// GL 4.2 conversion rules.
+GLuint pack2_10_10_10( const float * v, int size )
+{
+    GLuint x = snorm(v[0], 511) & 0x3ff;
+    GLuint y = snorm(v[1], 511) & 0x3ff;
+    GLuint z = snorm(v[2], 511) & 0x3ff;
+    GLuint w = 0;
+    if( size > 3 ) w = (v[3] < 0.0f ? -2 : 1) & 0x3;
+    return x | (y << 10) | (z << 20) | (w << 30);
+}
+
+// Writes attribute attr for every vertex to dst, dstStride bytes apart
+void encode( const Drawable::VertexAttribute & attr, const StoredFormat & f,
+             int nVerts, const glm::vec3 & qMin, float qScale,
+             GLubyte * dst, int dstStride )
+{
+    int srcStride = attr.dataStride ? attr.dataStride : attr.size;
+    for( int i = 0; i < nVerts; i++ ) {
+        const float * src = attr.data + i * srcStride;
+        GLubyte * out = dst + i * dstStride;
+        memset(out, 0, f.bytes);
+
+        if( f.type == GL_FLOAT ) {
+            memcpy(out, src, attr.size * sizeof(float));
+        } else if( f.type == GL_INT_2_10_10_10_REV ) {
+            GLuint packed = pack2_10_10_10(src, attr.size);
+            memcpy(out, &packed, 4);
+        } else if( f.type == GL_HALF_FLOAT ) {
+            for( int c = 0; c < attr.size; c++ ) {
+                glm::detail::hdata h = glm::half(src[c])._data();
+                memcpy(out + c * 2, &h, 2);
+            }
+        } else {
+            for( int c = 0; c < attr.size; c++ ) {
+                float t = glm::clamp((src[c] - qMin[c]) * qScale, 0.0f, 1.0f);
+                GLushort q = (GLushort)(t * 65535.0f + 0.5f);
+                memcpy(out + c * 2, &q, 2);
+            }
+        }
+    }
+}
+
+}
+
+Drawable::Drawable() : positionTransform(1.0f), vertexBytes(0), indexBytes(0), vaoHandle(0),
+    indexHandle(0), indexOffset(0)
+{
+}
+
+Drawable::~Drawable()
+{
+    releaseStorage();
+}
+
+void Drawable::releaseStorage()
+{
+    BufferAllocator & allocator = BufferAllocator::shared();
+    for( size_t r = 0; r < ranges.size(); r++ ) allocator.free(ranges[r]);
+    ranges.clear();
+    if( vaoHandle != 0 ) glDeleteVertexArrays(1, &vaoHandle);
+    vaoHandle = 0;
+    vertexBytes = indexBytes = 0;
+    indexHandle = 0;
+    indexOffset = 0;
+}
+
+void Drawable::attachInstances( const InstanceBuffer & instances )
 {
+    glBindVertexArray(vaoHandle);
+    instances.bindAttributes();
+    glBindVertexArray(0);
+}
+
+void Drawable::storeVertexAttributes( const VertexAttribute * attributes, int nAttributes,
+                                      int nVerts, VertexLayout layout,
+                                      VertexCompression compression )
+{
+    EncodedVertices encoded;
+    encodeVertexAttributes(attributes, nAttributes, nVerts, layout, compression, encoded);
+    storeVertexAttributes(encoded);
+}
+
+void Drawable::encodeVertexAttributes( const VertexAttribute * attributes, int nAttributes,
+                                       int nVerts, VertexLayout layout,
+                                       VertexCompression compression,
+                                       EncodedVertices & encoded )
+{
+    vector<StoredFormat> formats(nAttributes);
+    int stride = 0, floatStride = 0;
+    bool allFloat = true;
+    for( int a = 0; a < nAttributes; a++ ) {
+        formats[a] = storedFormat(attributes[a], compression);
+        stride += formats[a].bytes;
+        floatStride += attributes[a].size;
+        allFloat = allFloat && formats[a].type == GL_FLOAT;
+    }
+    encoded.vertexBytes = nVerts * stride;
+    encoded.buffers.clear();
+    encoded.pointers.clear();
+
+    // Quantized positions are stored relative to the bounding box.  The
+    // scale is the same on every axis so normals need no correction.
+    glm::vec3 qMin(0.0f);
+    float qScale = 1.0f;
+    encoded.positionTransform = mat4(1.0f);
+    for( int a = 0; a < nAttributes; a++ ) {
+        const VertexAttribute & attr = attributes[a];
+        if( formats[a].type != GL_UNSIGNED_SHORT || nVerts == 0 ) continue;
+
+        int srcStride = attr.dataStride ? attr.dataStride : attr.size;
+        glm::vec3 qMax(attributes[a].data[0], attr.size > 1 ? attr.data[1] : 0.0f,
+                       attr.size > 2 ? attr.data[2] : 0.0f);
+        qMin = qMax;
+        for( int i = 1; i < nVerts; i++ ) {
+            for( int c = 0; c < attr.size && c < 3; c++ ) {
+                float v = attr.data[i * srcStride + c];
+                qMin[c] = glm::min(qMin[c], v);
+                qMax[c] = glm::max(qMax[c], v);
+            }
+        }
+        glm::vec3 extent = qMax - qMin;
+        float maxExtent = glm::max(extent.x, glm::max(extent.y, extent.z));
+        qScale = maxExtent > 0.0f ? 1.0f / maxExtent : 1.0f;
+        encoded.positionTransform = glm::translate(mat4(1.0f), qMin) *
+                                    glm::scale(mat4(1.0f), glm::vec3(1.0f / qScale));
+    }
+
+    if( layout == SPLIT_BUFFERS ) {
+        encoded.buffers.resize(nAttributes);
+        for( int a = 0; a < nAttributes; a++ ) {
+            const VertexAttribute & attr = attributes[a];
+            const StoredFormat & f = formats[a];
+            EncodedVertices::Buffer & buffer = encoded.buffers[a];
+
+            buffer.bytes = nVerts * f.bytes;
+            buffer.source = NULL;
+            if( f.type == GL_FLOAT && (attr.dataStride == 0 || attr.dataStride == attr.size) ) {
+                buffer.source = attr.data;
+            } else if( nVerts > 0 ) {
+                buffer.converted.resize(buffer.bytes);
+                encode(attr, f, nVerts, qMin, qScale, &buffer.converted[0], f.bytes);
+            }
+
+            EncodedVertices::Pointer pointer = { attr.location, f.size, f.type,
+                                                 f.normalized == GL_TRUE, f.bytes,
+                                                 (unsigned int)a, 0 };
+            encoded.pointers.push_back(pointer);
+        }
+        return;
+    }
+
+    // Interleaved: one buffer, whole vertices back to back.  The source
+    // may already be laid out that way (VBOMesh), in which case it can be
+    // uploaded as is.
+    bool packed = allFloat;
+    int offset = 0;
+    for( int a = 0; a < nAttributes; a++ ) {
+        packed = packed && attributes[a].data == attributes[0].data + offset &&
+                 attributes[a].dataStride == floatStride;
+        offset += attributes[a].size;
+    }
+
+    encoded.buffers.resize(1);
+    EncodedVertices::Buffer & buffer = encoded.buffers[0];
+    buffer.bytes = nVerts * stride;
+    buffer.source = packed ? attributes[0].data : NULL;
+    if( ! packed && nVerts > 0 ) {
+        buffer.converted.resize(buffer.bytes);
+        offset = 0;
+        for( int a = 0; a < nAttributes; a++ ) {
+            encode(attributes[a], formats[a], nVerts, qMin, qScale,
+                   &buffer.converted[offset], stride);
+            offset += formats[a].bytes;
+        }
+    }
+
+    offset = 0;
+    for( int a = 0; a < nAttributes; a++ ) {
+        const StoredFormat & f = formats[a];
+        EncodedVertices::Pointer pointer = { attributes[a].location, f.size, f.type,
+                                             f.normalized == GL_TRUE, stride,
+                                             0, (unsigned int)offset };
+        encoded.pointers.push_back(pointer);
+        offset += f.bytes;
+    }
+}
+
+void Drawable::storeVertexAttributes( const EncodedVertices & encoded )
+{
+    positionTransform = encoded.positionTransform;
+    vertexBytes = encoded.vertexBytes;
+
+    BufferAllocator & allocator = BufferAllocator::shared();
+    size_t firstRange = ranges.size();
+    for( size_t b = 0; b < encoded.buffers.size(); b++ ) {
+        const EncodedVertices::Buffer & buffer = encoded.buffers[b];
+        const void * data = buffer.source;
+        if( ! data && ! buffer.converted.empty() ) data = &buffer.converted[0];
+        ranges.push_back(allocator.store(data, buffer.bytes));
+    }
+
+    for( size_t p = 0; p < encoded.pointers.size(); p++ ) {
+        const EncodedVertices::Pointer & pointer = encoded.pointers[p];
+        const BufferAllocator::Range & range = ranges[firstRange + pointer.buffer];
+        glBindBuffer(GL_ARRAY_BUFFER, range.buffer);
+        glVertexAttribPointer( pointer.location, pointer.size, pointer.type,
+                               pointer.normalized ? GL_TRUE : GL_FALSE, pointer.stride,
+                               ((GLubyte *)NULL + (range.offset + pointer.offset)) );
+        glEnableVertexAttribArray(pointer.location);
+    }
+}
+
+unsigned int Drawable::storeIndices( const unsigned int * el, int count, unsigned int nVerts )
+{
+    EncodedIndices encoded;
+    encodeIndices(el, count, nVerts, encoded);
+    return storeIndices(encoded);
+}
+
+void Drawable::encodeIndices( const unsigned int * el, int count, unsigned int nVerts,
+                              EncodedIndices & encoded )
+{
+    encoded.type = GLUtils::packElements(el, count, nVerts, encoded.converted);
+    encoded.source = encoded.converted.empty() ? (const void *)el : NULL;
+    encoded.bytes = count * GLUtils::indexTypeSize(encoded.type);
+}
+
+unsigned int Drawable::storeIndices( const EncodedIndices & encoded )
+{
+    const void * data = encoded.source;
+    if( ! data && ! encoded.converted.empty() ) data = &encoded.converted[0];
+    indexBytes = encoded.bytes;
+    BufferAllocator::Range range = BufferAllocator::shared().store(data, indexBytes);
+    ranges.push_back(range);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, range.buffer);
+    indexHandle = range.buffer;
+    indexOffset = range.offset;
+    return encoded.type;
 }
@@ -0,0 +1,141 @@
+#include "drawbatch.h"
+#include <GL/glew.h>
+
+namespace {
+
+const int FLOATS_PER_VERTEX = 8;
+
+}
+
+DrawBatch::DrawBatch() : drawIdCount(0), geometryChanged(false)
+{
+    glGenVertexArrays(1, &vaoHandle);
+    GLuint handles[5];
+    glGenBuffers(5, handles);
+    vertexHandle = handles[0];
+    indexHandle = handles[1];
+    commandHandle = handles[2];
+    drawDataHandle = handles[3];
+    drawIdHandle = handles[4];
+
+    glBindVertexArray(vaoHandle);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexHandle);
+    GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+    glVertexAttribPointer( 0, 3, GL_FLOAT, GL_FALSE, stride, ((GLubyte *)NULL + (0)) );
+    glEnableVertexAttribArray(0);  // Vertex position
+    glVertexAttribPointer( 1, 3, GL_FLOAT, GL_FALSE, stride, ((GLubyte *)NULL + (3 * sizeof(float))) );
+    glEnableVertexAttribArray(1);  // Vertex normal
+    glVertexAttribPointer( 2, 2, GL_FLOAT, GL_FALSE, stride, ((GLubyte *)NULL + (6 * sizeof(float))) );
+    glEnableVertexAttribArray(2);  // Texture coords
+
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdHandle);
+    glVertexAttribIPointer( DRAW_ID_LOCATION, 1, GL_UNSIGNED_INT, 0, ((GLubyte *)NULL + (0)) );
+    glVertexAttribDivisor(DRAW_ID_LOCATION, 1);
+    glEnableVertexAttribArray(DRAW_ID_LOCATION);
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexHandle);
+    glBindVertexArray(0);
+}
+
+DrawBatch::~DrawBatch()
+{
+    GLuint handles[5] = { vertexHandle, indexHandle, commandHandle, drawDataHandle, drawIdHandle };
+    glDeleteBuffers(5, handles);
+    glDeleteVertexArrays(1, &vaoHandle);
+}
+
+int DrawBatch::add( const MeshData & data )
+{
+    Mesh mesh;
+    mesh.firstIndex = (unsigned int)indices.size();
+    mesh.baseVertex = (int)(vertices.size() / FLOATS_PER_VERTEX);
+
+    vector<unsigned int> list;
+    data.triangleList(list);
+    indices.insert(indices.end(), list.begin(), list.end());
+    mesh.indexCount = (unsigned int)list.size();
+
+    size_t nVerts = data.vertexCount();
+    bool hasNormals = ! data.normals.empty(), hasTexCoords = ! data.texCoords.empty();
+    size_t start = vertices.size();
+    vertices.resize(start + nVerts * FLOATS_PER_VERTEX);
+    float * v = &vertices[start];
+    for( size_t i = 0; i < nVerts; i++ ) {
+        v[0] = data.positions[3 * i];
+        v[1] = data.positions[3 * i + 1];
+        v[2] = data.positions[3 * i + 2];
+        v[3] = hasNormals ? data.normals[3 * i] : 0.0f;
+        v[4] = hasNormals ? data.normals[3 * i + 1] : 1.0f;
+        v[5] = hasNormals ? data.normals[3 * i + 2] : 0.0f;
+        v[6] = hasTexCoords ? data.texCoords[2 * i] : 0.0f;
+        v[7] = hasTexCoords ? data.texCoords[2 * i + 1] : 0.0f;
+        v += FLOATS_PER_VERTEX;
+    }
+
+    meshes.push_back(mesh);
+    geometryChanged = true;
+    return (int)meshes.size() - 1;
+}
+
+void DrawBatch::draw( int mesh, const mat4 & model, unsigned int material )
+{
+    const Mesh & m = meshes[mesh];
+    DrawCommand command = { m.indexCount, 1, m.firstIndex, m.baseVertex,
+                            (unsigned int)commands.size() };
+    commands.push_back(command);
+
+    DrawData d;
+    d.model = model;
+    d.material = material;
+    d.pad[0] = d.pad[1] = d.pad[2] = 0;
+    drawData.push_back(d);
+}
+
+void DrawBatch::uploadGeometry()
+{
+    glBindBuffer(GL_ARRAY_BUFFER, vertexHandle);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float),
+                 vertices.empty() ? NULL : &vertices[0], GL_STATIC_DRAW);
+    glBindVertexArray(vaoHandle);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int),
+                 indices.empty() ? NULL : &indices[0], GL_STATIC_DRAW);
+    glBindVertexArray(0);
+    geometryChanged = false;
+}
+
+void DrawBatch::render()
+{
+    if( geometryChanged ) uploadGeometry();
+    GLsizei count = (GLsizei)commands.size();
+    if( count == 0 ) return;
+
+    // The draw IDs only ever grow, and are the same every frame
+    if( (unsigned int)count > drawIdCount ) {
+        vector<unsigned int> ids(count);
+        for( GLsizei i = 0; i < count; i++ ) ids[i] = (unsigned int)i;
+        glBindBuffer(GL_ARRAY_BUFFER, drawIdHandle);
+        glBufferData(GL_ARRAY_BUFFER, count * sizeof(unsigned int), &ids[0], GL_STATIC_DRAW);
+        drawIdCount = (unsigned int)count;
+    }
+
+    // Orphaned every frame, so the previous frame's draws needn't finish first
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawDataHandle);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, count * sizeof(DrawData), &drawData[0], GL_STREAM_DRAW);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, DRAW_DATA_BINDING, drawDataHandle);
+
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandHandle);
+    glBufferData(GL_DRAW_INDIRECT_BUFFER, count * sizeof(DrawCommand), &commands[0], GL_STREAM_DRAW);
+
+    glBindVertexArray(vaoHandle);
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, count, 0);
+    glBindVertexArray(0);
+    glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+    commands.clear();
+    drawData.clear();
+}
+
+size_t DrawBatch::geometryBytes() const
+{
+    return vertices.size() * sizeof(float) + indices.size() * sizeof(unsigned int);
+}
@@ -0,0 +1,237 @@
+#include "geometrycache.h"
+#include "vboteapot.h"
+#include "vboplane.h"
+#include "vbotorus.h"
+#include "vbocube.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// Keys spell out every argument, floats by their bit pattern so that
+// values that print alike don't collide
+void appendInt( string & key, int value )
+{
+    char text[16];
+    sprintf(text, " %d", value);
+    key += text;
+}
+
+void appendFloat( string & key, float value )
+{
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    char text[16];
+    sprintf(text, " %08x", bits);
+    key += text;
+}
+
+void appendBits( string & key, unsigned long long value )
+{
+    char text[24];
+    sprintf(text, " %llx", value);
+    key += text;
+}
+
+void appendFormat( string & key, Drawable::VertexLayout layout,
+                   Drawable::VertexCompression compression )
+{
+    appendInt(key, (int)layout);
+    appendInt(key, (int)compression);
+}
+
+}
+
+GeometryCache::GeometryCache( size_t budgetBytes ) : budget(budgetBytes), useClock(0)
+{
+    memset(&counts, 0, sizeof(counts));
+}
+
+GeometryCache::~GeometryCache()
+{
+    for( EntryMap::iterator it = entries.begin(); it != entries.end(); ++it ) {
+        delete it->second.drawable;
+    }
+}
+
+Drawable * GeometryCache::acquire( const string & key )
+{
+    EntryMap::iterator it = entries.find(key);
+    if( it == entries.end() ) {
+        counts.misses++;
+        return NULL;
+    }
+    counts.hits++;
+    it->second.refCount++;
+    it->second.lastUse = ++useClock;
+    return it->second.drawable;
+}
+
+Drawable * GeometryCache::insert( const string & key, Drawable * drawable )
+{
+    Entry entry;
+    entry.drawable = drawable;
+    entry.refCount = 1;
+    entry.bytes = drawable->getVertexBytes() + drawable->getIndexBytes();
+    entry.lastUse = ++useClock;
+
+    EntryMap::iterator it = entries.insert(EntryMap::value_type(key, entry)).first;
+    owners[drawable] = it;
+    counts.bytes += entry.bytes;
+    evict();
+    return drawable;
+}
+
+void GeometryCache::evict()
+{
+    // Least recently used first.  A scan per eviction is fine for the
+    // tens of shapes a set of scenes shares.
+    while( counts.bytes > budget ) {
+        EntryMap::iterator oldest = entries.end();
+        for( EntryMap::iterator it = entries.begin(); it != entries.end(); ++it ) {
+            if( it->second.refCount == 0 &&
+                (oldest == entries.end() || it->second.lastUse < oldest->second.lastUse) ) {
+                oldest = it;
+            }
+        }
+        if( oldest == entries.end() ) return;
+
+        counts.bytes -= oldest->second.bytes;
+        counts.evictions++;
+        owners.erase(oldest->second.drawable);
+        delete oldest->second.drawable;
+        entries.erase(oldest);
+    }
+}
+
+VBOTeapot * GeometryCache::teapot( int grid, const mat4 & lidTransform, bool optimizeVertexCache,
+                                   Drawable::VertexLayout layout,
+                                   Drawable::VertexCompression compression,
+                                   bool weldSeams, MeshData::Primitive primitive,
+                                   bool matchTexCoords )
+{
+    string key = "teapot";
+    appendInt(key, grid);
+    for( int c = 0; c < 4; c++ ) {
+        for( int r = 0; r < 4; r++ ) appendFloat(key, lidTransform[c][r]);
+    }
+    appendInt(key, optimizeVertexCache);
+    appendFormat(key, layout, compression);
+    appendInt(key, weldSeams);
+    appendInt(key, (int)primitive);
+    appendInt(key, weldSeams && matchTexCoords);
+
+    Drawable * drawable = acquire(key);
+    if( ! drawable ) {
+        drawable = insert(key, new VBOTeapot(grid, lidTransform, optimizeVertexCache, layout,
+                                             compression, weldSeams, primitive, matchTexCoords));
+    }
+    return static_cast<VBOTeapot *>(drawable);
+}
+
+VBOPlane * GeometryCache::plane( float xsize, float zsize, int xdivs, int zdivs,
+                                 Drawable::VertexLayout layout,
+                                 Drawable::VertexCompression compression,
+                                 MeshData::Primitive primitive )
+{
+    string key = "plane";
+    appendFloat(key, xsize);
+    appendFloat(key, zsize);
+    appendInt(key, xdivs);
+    appendInt(key, zdivs);
+    appendFormat(key, layout, compression);
+    appendInt(key, (int)primitive);
+
+    Drawable * drawable = acquire(key);
+    if( ! drawable ) {
+        drawable = insert(key, new VBOPlane(xsize, zsize, xdivs, zdivs, layout, compression,
+                                            primitive));
+    }
+    return static_cast<VBOPlane *>(drawable);
+}
+
+VBOTorus * GeometryCache::torus( float outerRadius, float innerRadius, int sides, int rings,
+                                 bool optimizeVertexCache, Drawable::VertexLayout layout,
+                                 Drawable::VertexCompression compression,
+                                 MeshData::Primitive primitive )
+{
+    string key = "torus";
+    appendFloat(key, outerRadius);
+    appendFloat(key, innerRadius);
+    appendInt(key, sides);
+    appendInt(key, rings);
+    appendInt(key, optimizeVertexCache);
+    appendFormat(key, layout, compression);
+    appendInt(key, (int)primitive);
+
+    Drawable * drawable = acquire(key);
+    if( ! drawable ) {
+        drawable = insert(key, new VBOTorus(outerRadius, innerRadius, sides, rings,
+                                            optimizeVertexCache, layout, compression, primitive));
+    }
+    return static_cast<VBOTorus *>(drawable);
+}
+
+VBOCube * GeometryCache::cube( Drawable::VertexLayout layout,
+                               Drawable::VertexCompression compression )
+{
+    string key = "cube";
+    appendFormat(key, layout, compression);
+
+    Drawable * drawable = acquire(key);
+    if( ! drawable ) drawable = insert(key, new VBOCube(layout, compression));
+    return static_cast<VBOCube *>(drawable);
+}
+
+VBOMesh * GeometryCache::mesh( const char * fileName, const VBOMesh::Options & options )
+{
+    // The thread count and the binary cache only change how the data is
+    // produced, not the data
+    string key = "obj ";
+    key += fileName;
+    appendBits(key, options.cacheFlags());
+    appendFormat(key, options.layout, options.compression);
+    appendInt(key, options.buildMeshlets);
+
+    Drawable * drawable = acquire(key);
+    if( ! drawable ) {
+        VBOMesh::UploadData upload;
+        if( ! VBOMesh::loadVertexData(fileName, options, upload) ) return NULL;
+        drawable = insert(key, new VBOMesh(upload));
+    }
+    return static_cast<VBOMesh *>(drawable);
+}
+
+void GeometryCache::release( const Drawable * drawable )
+{
+    map<const Drawable *, EntryMap::iterator>::iterator owner = owners.find(drawable);
+    if( owner == owners.end() || owner->second->second.refCount == 0 ) return;
+    owner->second->second.refCount--;
+    evict();
+}
+
+void GeometryCache::purge()
+{
+    size_t saved = budget;
+    budget = 0;
+    evict();
+    budget = saved;
+}
+
+void GeometryCache::setBudget( size_t budgetBytes )
+{
+    budget = budgetBytes;
+    evict();
+}
+
+GeometryCache::Stats GeometryCache::stats() const
+{
+    Stats s = counts;
+    s.entries = (unsigned int)entries.size();
+    s.referenced = 0;
+    for( EntryMap::const_iterator it = entries.begin(); it != entries.end(); ++it ) {
+        if( it->second.refCount > 0 ) s.referenced++;
+    }
+    return s;
+}
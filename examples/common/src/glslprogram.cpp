@@ -7,8 +7,12 @@ using std::ios;
 using std::ostringstream;
 
 #include <sys/stat.h>
+#include <cstring>
 
-GLSLProgram::GLSLProgram() : handle(0), linked(false) { }
+GLSLProgram::GLSLProgram() : handle(0), linked(false)
+{
+    resetUniformStats();
+}
 
 bool GLSLProgram::compileShaderFromFile( const char * fileName,
                                          GLSLShader::GLSLShaderType type )
@@ -131,6 +135,7 @@ bool GLSLProgram::link()
         return false;
     } else {
         linked = true;
+        loadUniforms();
         return linked;
     }
 }
@@ -168,70 +173,146 @@ void GLSLProgram::bindFragDataLocation( GLuint location, const char * name )
 
 void GLSLProgram::setUniform( const char *name, float x, float y, float z)
 {
-    int loc = getUniformLocation(name);
-    if( loc >= 0 ) {
-        glUniform3f(loc,x,y,z);
-    }
+    setUniform(getUniformHandle(name), x, y, z);
+}
+
+void GLSLProgram::setUniform( const char *name, const vec2 & v)
+{
+    setUniform(getUniformHandle(name), v);
 }
 
 void GLSLProgram::setUniform( const char *name, const vec3 & v)
 {
-    this->setUniform(name,v.x,v.y,v.z);
+    setUniform(getUniformHandle(name), v.x, v.y, v.z);
 }
 
 void GLSLProgram::setUniform( const char *name, const vec4 & v)
 {
-    int loc = getUniformLocation(name);
-    if( loc >= 0 ) {
-        glUniform4f(loc,v.x,v.y,v.z,v.w);
-    }
+    setUniform(getUniformHandle(name), v);
 }
 
 void GLSLProgram::setUniform( const char *name, const mat4 & m)
 {
-    int loc = getUniformLocation(name);
-    if( loc >= 0 )
-    {
-        glUniformMatrix4fv(loc, 1, GL_FALSE, &m[0][0]);
-    }
+    setUniform(getUniformHandle(name), m);
 }
 
 void GLSLProgram::setUniform( const char *name, const mat3 & m)
 {
-    int loc = getUniformLocation(name);
-    if( loc >= 0 )
+    setUniform(getUniformHandle(name), m);
+}
+
+void GLSLProgram::setUniform( const char *name, float val )
+{
+    setUniform(getUniformHandle(name), val);
+}
+
+void GLSLProgram::setUniform( const char *name, int val )
+{
+    setUniform(getUniformHandle(name), val);
+}
+
+void GLSLProgram::setUniform( const char *name, bool val )
+{
+    setUniform(getUniformHandle(name), val);
+}
+
+UniformHandle GLSLProgram::getUniformHandle( const char * name ) const
+{
+    UniformHandle u;
+    u.index = findUniform(name);
+    return u;
+}
+
+void GLSLProgram::setUniform( UniformHandle u, float x, float y, float z)
+{
+    float v[3] = { x, y, z };
+    if( changed(u, GL_FLOAT_VEC3, v, sizeof(v)) ) {
+        glUniform3f(uniforms[u.index].location,x,y,z);
+    }
+}
+
+void GLSLProgram::setUniform( UniformHandle u, const vec2 & v)
+{
+    if( changed(u, GL_FLOAT_VEC2, &v[0], sizeof(v)) ) {
+        glUniform2f(uniforms[u.index].location,v.x,v.y);
+    }
+}
+
+void GLSLProgram::setUniform( UniformHandle u, const vec3 & v)
+{
+    this->setUniform(u,v.x,v.y,v.z);
+}
+
+void GLSLProgram::setUniform( UniformHandle u, const vec4 & v)
+{
+    if( changed(u, GL_FLOAT_VEC4, &v[0], sizeof(v)) ) {
+        glUniform4f(uniforms[u.index].location,v.x,v.y,v.z,v.w);
+    }
+}
+
+void GLSLProgram::setUniform( UniformHandle u, const mat4 & m)
+{
+    if( changed(u, GL_FLOAT_MAT4, &m[0][0], sizeof(m)) )
     {
-        glUniformMatrix3fv(loc, 1, GL_FALSE, &m[0][0]);
+        glUniformMatrix4fv(uniforms[u.index].location, 1, GL_FALSE, &m[0][0]);
     }
 }
 
-void GLSLProgram::setUniform( const char *name, float val )
+void GLSLProgram::setUniform( UniformHandle u, const mat3 & m)
 {
-    int loc = getUniformLocation(name);
-    if( loc >= 0 )
+    if( changed(u, GL_FLOAT_MAT3, &m[0][0], sizeof(m)) )
     {
-        glUniform1f(loc, val);
+        glUniformMatrix3fv(uniforms[u.index].location, 1, GL_FALSE, &m[0][0]);
     }
 }
 
-void GLSLProgram::setUniform( const char *name, int val )
+void GLSLProgram::setUniform( UniformHandle u, float val )
 {
-    int loc = getUniformLocation(name);
-    if( loc >= 0 )
+    if( changed(u, GL_FLOAT, &val, sizeof(val)) )
     {
-        glUniform1i(loc, val);
+        glUniform1f(uniforms[u.index].location, val);
     }
 }
 
-void GLSLProgram::setUniform( const char *name, bool val )
+void GLSLProgram::setUniform( UniformHandle u, int val )
 {
-    int loc = getUniformLocation(name);
-    if( loc >= 0 )
+    if( changed(u, GL_INT, &val, sizeof(val)) )
     {
-        glUniform1i(loc, val);
+        glUniform1i(uniforms[u.index].location, val);
     }
 }
 
+void GLSLProgram::setUniform( UniformHandle u, bool val )
+{
+    setUniform(u, (int)val);
+}
+
+bool GLSLProgram::changed( UniformHandle u, GLenum type, const void * value, size_t bytes )
+{
+    if( u.index < 0 || uniforms[u.index].location < 0 ) return false;
+
+    UniformValue & last = values[uniforms[u.index].value];
+    if( last.type == type && memcmp(last.data, value, bytes) == 0 ) {
+        uniformStats.skipped++;
+        return false;
+    }
+    last.type = type;
+    memcpy(last.data, value, bytes);
+    uniformStats.uploads++;
+    return true;
+}
+
+void GLSLProgram::forgetUniformValues()
+{
+    for( size_t i = 0; i < values.size(); i++ ) values[i].type = GL_NONE;
+}
+
+void GLSLProgram::resetUniformStats()
+{
+    uniformStats.uploads = 0;
+    uniformStats.skipped = 0;
+}
+
 void GLSLProgram::printActiveUniforms() {
 
     GLint nUniforms, size, location, maxLen;
@@ -277,9 +358,95 @@ void GLSLProgram::printActiveAttribs() {
     free(name);
 }
 
-int GLSLProgram::getUniformLocation(const char * name )
+namespace {
+
+// FNV-1a
+unsigned int hashName( const char * name )
 {
-    return glGetUniformLocation(handle, name);
+    unsigned int hash = 2166136261u;
+    for( ; *name; name++ ) {
+        hash = (hash ^ (unsigned char)*name) * 16777619u;
+    }
+    return hash;
+}
+
+}
+
+void GLSLProgram::loadUniforms()
+{
+    GLint nUniforms = 0, maxLen = 0;
+    glGetProgramiv( handle, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLen);
+    glGetProgramiv( handle, GL_ACTIVE_UNIFORMS, &nUniforms);
+
+    uniforms.clear();
+    uniformSlots.clear();
+    values.clear();
+    vector<GLchar> name(maxLen > 0 ? maxLen : 1);
+    for( int i = 0; i < nUniforms; ++i ) {
+        GLint size;
+        GLenum type;
+        GLsizei written;
+        glGetActiveUniform( handle, i, maxLen, &written, &size, &type, &name[0] );
+        string uniformName(&name[0], written);
+        addUniform(uniformName, glGetUniformLocation(handle, uniformName.c_str()));
+
+        // Arrays are reported as their first element, "Weight[0]"
+        size_t bracket = uniformName.rfind("[0]");
+        if( size > 1 && bracket != string::npos && bracket + 3 == uniformName.size() ) {
+            string base = uniformName.substr(0, bracket);
+            addUniform(base, uniforms.back().location, uniforms.back().value);
+            for( int e = 1; e < size; e++ ) {
+                ostringstream element;
+                element << base << '[' << e << ']';
+                addUniform(element.str(), glGetUniformLocation(handle, element.str().c_str()));
+            }
+        }
+    }
+}
+
+void GLSLProgram::addUniform( const string & name, int location, int value )
+{
+    Uniform u;
+    u.name = name;
+    u.hash = hashName(name.c_str());
+    u.location = location;
+    u.value = value;
+    if( value < 0 ) {
+        UniformValue unset;
+        memset(&unset, 0, sizeof(unset));
+        unset.type = GL_NONE;
+        u.value = (int)values.size();
+        values.push_back(unset);
+    }
+    uniforms.push_back(u);
+
+    // Rehash at half full, so probe sequences stay short
+    size_t slots = uniformSlots.size();
+    if( uniforms.size() * 2 > slots ) {
+        slots = slots ? slots * 2 : 32;
+        uniformSlots.assign(slots, -1);
+        for( size_t i = 0; i < uniforms.size(); i++ ) {
+            size_t slot = uniforms[i].hash & (slots - 1);
+            while( uniformSlots[slot] >= 0 ) slot = (slot + 1) & (slots - 1);
+            uniformSlots[slot] = (int)i;
+        }
+        return;
+    }
+    size_t slot = u.hash & (slots - 1);
+    while( uniformSlots[slot] >= 0 ) slot = (slot + 1) & (slots - 1);
+    uniformSlots[slot] = (int)uniforms.size() - 1;
+}
+
+int GLSLProgram::findUniform( const char * name ) const
+{
+    size_t slots = uniformSlots.size();
+    if( slots == 0 ) return -1;
+    unsigned int hash = hashName(name);
+    for( size_t slot = hash & (slots - 1); uniformSlots[slot] >= 0; slot = (slot + 1) & (slots - 1) ) {
+        const Uniform & u = uniforms[uniformSlots[slot]];
+        if( u.hash == hash && u.name == name ) return uniformSlots[slot];
+    }
+    return -1;
 }
 
 bool GLSLProgram::fileExists( const string & fileName )
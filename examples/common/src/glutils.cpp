@@ -25,6 +25,34 @@ int GLUtils::checkForOpenGLError(const char * file, int line) {
 
 }
 
+GLenum GLUtils::bufferElementData(const GLuint * el, GLsizei count, GLuint nVerts, GLenum usage) {
+    std::vector<GLushort> shortEl;
+    GLenum type = packElements(el, count, nVerts, shortEl);
+    const void * data = shortEl.empty() ? (const void *)el : &shortEl[0];
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, count * indexTypeSize(type), data, usage);
+    return type;
+}
+
+GLenum GLUtils::packElements(const GLuint * el, GLsizei count, GLuint nVerts,
+                             std::vector<GLushort> & shortEl) {
+    shortEl.clear();
+    if( nVerts > 65536 ) return GL_UNSIGNED_INT;
+
+    shortEl.resize(count);
+    for( GLsizei i = 0; i < count; i++ ) {
+        shortEl[i] = (GLushort)el[i];
+    }
+    return GL_UNSIGNED_SHORT;
+}
+
+GLsizei GLUtils::indexTypeSize(GLenum type) {
+    switch( type ) {
+    case GL_UNSIGNED_BYTE:  return sizeof(GLubyte);
+    case GL_UNSIGNED_SHORT: return sizeof(GLushort);
+    default:                return sizeof(GLuint);
+    }
+}
+
 void GLUtils::dumpGLInfo(bool dumpExtensions) {
     const GLubyte *renderer = glGetString( GL_RENDERER );
     const GLubyte *vendor = glGetString( GL_VENDOR );
@@ -0,0 +1,40 @@
+#include "instancebuffer.h"
+#include <GL/glew.h>
+
+InstanceBuffer::InstanceBuffer() : handle(0), count(0), capacity(0)
+{
+    glGenBuffers(1, &handle);
+}
+
+InstanceBuffer::~InstanceBuffer()
+{
+    glDeleteBuffers(1, &handle);
+}
+
+void InstanceBuffer::update( const Instance * instances, int n )
+{
+    glBindBuffer(GL_ARRAY_BUFFER, handle);
+    if( n > capacity ) {
+        capacity = n;
+        glBufferData(GL_ARRAY_BUFFER, capacity * sizeof(Instance), instances, GL_DYNAMIC_DRAW);
+    } else if( n > 0 ) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, n * sizeof(Instance), instances);
+    }
+    count = n;
+}
+
+void InstanceBuffer::bindAttributes() const
+{
+    glBindBuffer(GL_ARRAY_BUFFER, handle);
+    for( int c = 0; c < 4; c++ ) {
+        GLuint location = MODEL_LOCATION + c;
+        glVertexAttribPointer( location, 4, GL_FLOAT, GL_FALSE, sizeof(Instance),
+                               ((GLubyte *)NULL + (c * sizeof(glm::vec4))) );
+        glVertexAttribDivisor(location, 1);
+        glEnableVertexAttribArray(location);
+    }
+    glVertexAttribIPointer( MATERIAL_LOCATION, 1, GL_UNSIGNED_INT, sizeof(Instance),
+                            ((GLubyte *)NULL + (sizeof(mat4))) );
+    glVertexAttribDivisor(MATERIAL_LOCATION, 1);
+    glEnableVertexAttribArray(MATERIAL_LOCATION);
+}
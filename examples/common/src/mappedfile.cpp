@@ -0,0 +1,96 @@
+#include "mappedfile.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() : bytes(NULL), length(0), opened(false)
+#ifdef WIN32
+    , fileHandle(INVALID_HANDLE_VALUE), mapHandle(NULL)
+#else
+    , fd(-1)
+#endif
+{ }
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+bool MappedFile::open( const char * fileName )
+{
+    close();
+
+#ifdef WIN32
+    fileHandle = CreateFileA( fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL );
+    if( fileHandle == INVALID_HANDLE_VALUE ) return false;
+
+    LARGE_INTEGER fileSize;
+    if( ! GetFileSizeEx( fileHandle, &fileSize ) ) {
+        close();
+        return false;
+    }
+    length = (size_t)fileSize.QuadPart;
+
+    if( length > 0 ) {
+        mapHandle = CreateFileMappingA( fileHandle, NULL, PAGE_READONLY, 0, 0, NULL );
+        if( mapHandle == NULL ) {
+            close();
+            return false;
+        }
+        bytes = (const char *)MapViewOfFile( mapHandle, FILE_MAP_READ, 0, 0, 0 );
+        if( bytes == NULL ) {
+            close();
+            return false;
+        }
+    }
+#else
+    fd = ::open( fileName, O_RDONLY );
+    if( fd < 0 ) return false;
+
+    struct stat info;
+    if( fstat( fd, &info ) != 0 ) {
+        close();
+        return false;
+    }
+    length = (size_t)info.st_size;
+
+    if( length > 0 ) {
+        void * addr = mmap( NULL, length, PROT_READ, MAP_PRIVATE, fd, 0 );
+        if( addr == MAP_FAILED ) {
+            close();
+            return false;
+        }
+        bytes = (const char *)addr;
+        // The parsers walk the file front to back exactly once
+        madvise( addr, length, MADV_SEQUENTIAL );
+    }
+#endif
+
+    opened = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+#ifdef WIN32
+    if( bytes != NULL ) UnmapViewOfFile( bytes );
+    if( mapHandle != NULL ) CloseHandle( mapHandle );
+    if( fileHandle != INVALID_HANDLE_VALUE ) CloseHandle( fileHandle );
+    mapHandle = NULL;
+    fileHandle = INVALID_HANDLE_VALUE;
+#else
+    if( bytes != NULL ) munmap( (void *)bytes, length );
+    if( fd >= 0 ) ::close( fd );
+    fd = -1;
+#endif
+    bytes = NULL;
+    length = 0;
+    opened = false;
+}
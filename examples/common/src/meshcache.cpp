@@ -0,0 +1,249 @@
+#include "meshcache.h"
+
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const char magicBytes[8] = { 'V', 'B', 'O', 'M', 'E', 'S', 'H', '\0' };
+
+// Floats per vertex for a set of attribute bits, 0 if any bit is unknown
+unsigned int attributeFloats( unsigned int attributes )
+{
+    const unsigned int known = MeshCache::POSITION | MeshCache::NORMAL |
+                               MeshCache::TEXCOORD | MeshCache::TANGENT;
+    if( attributes & ~known ) return 0;
+
+    unsigned int floats = 0;
+    if( attributes & MeshCache::POSITION ) floats += 3;
+    if( attributes & MeshCache::NORMAL ) floats += 3;
+    if( attributes & MeshCache::TEXCOORD ) floats += 2;
+    if( attributes & MeshCache::TANGENT ) floats += 4;
+    return floats;
+}
+
+// The header (with the checksum field itself zeroed), then the vertex and
+// index data
+unsigned long long checksum( const MeshCache::Header & header,
+                             const void * vertices, size_t vertexBytes,
+                             const void * indices, size_t indexBytes )
+{
+    MeshCache::Header copy = header;
+    copy.payloadHash = 0;
+    unsigned long long h = MeshCache::hash(&copy, sizeof(copy));
+    h = MeshCache::hash(vertices, vertexBytes, h);
+    return MeshCache::hash(indices, indexBytes, h);
+}
+
+}
+
+MeshCache::MeshCache() : vertexData(NULL), indexData(NULL)
+{
+    memset(&header, 0, sizeof(Header));
+}
+
+// FNV-1a style hash, consuming eight bytes per step.  Only used to detect
+// stale or damaged caches, not for security.
+unsigned long long MeshCache::hash( const void * data, size_t size,
+                                    unsigned long long seed )
+{
+    const unsigned long long prime = 1099511628211ULL;
+    const unsigned char * p = (const unsigned char *)data;
+    unsigned long long h = seed;
+
+    size_t nWords = size / 8;
+    for( size_t i = 0; i < nWords; i++ ) {
+        unsigned long long word;
+        memcpy(&word, p + i * 8, 8);
+        h = (h ^ word) * prime;
+    }
+    for( size_t i = nWords * 8; i < size; i++ ) {
+        h = (h ^ p[i]) * prime;
+    }
+    h ^= size;
+    h ^= h >> 29;
+    return h;
+}
+
+bool MeshCache::hashFile( const char * fileName, unsigned long long & h,
+                          unsigned long long & size )
+{
+    MappedFile source;
+    if( ! source.open(fileName) ) return false;
+    h = hash(source.data(), source.size());
+    size = source.size();
+    return true;
+}
+
+bool MeshCache::open( const char * cacheFile, unsigned long long sourceHash,
+                      unsigned long long sourceSize, unsigned long long flags )
+{
+    clear();
+
+    if( ! file.open(cacheFile) ) return false;
+
+    if( file.size() < sizeof(Header) ) {
+        clear();
+        return false;
+    }
+    memcpy(&header, file.data(), sizeof(Header));
+
+    unsigned long long vertexBytes =
+            (unsigned long long)header.nVerts * header.stride * sizeof(float);
+    unsigned long long indexBytes =
+            (unsigned long long)header.nIndices * sizeof(unsigned int);
+
+    if( memcmp(header.magic, magicBytes, sizeof(magicBytes)) != 0 ||
+        header.version != VERSION ||
+        header.flags != flags ||
+        header.sourceHash != sourceHash ||
+        header.sourceSize != sourceSize ||
+        sizeof(Header) + vertexBytes + indexBytes != file.size() ||
+        header.nLods < 1 || header.nLods > MAX_LODS )
+    {
+        clear();
+        return false;
+    }
+
+    // The attributes, positions among them, have to add up to the stride,
+    // and the levels have to fill the index buffer in whole triangles
+    unsigned long long lodIndices = 0;
+    bool wholeTriangles = true;
+    for( unsigned int l = 0; l < header.nLods; l++ ) {
+        lodIndices += header.lodIndexCount[l];
+        wholeTriangles = wholeTriangles && header.lodIndexCount[l] % 3 == 0;
+    }
+    if( ! (header.attributes & POSITION) ||
+        header.stride != attributeFloats(header.attributes) ||
+        lodIndices != header.nIndices || ! wholeTriangles )
+    {
+        clear();
+        return false;
+    }
+
+    const char * payload = file.data() + sizeof(Header);
+    if( checksum(header, payload, (size_t)vertexBytes,
+                 payload + vertexBytes, (size_t)indexBytes) != header.payloadHash ) {
+        clear();
+        return false;
+    }
+
+    // The checksum only shows the file is as written; the indices still
+    // decide how far past the vertex buffer GL would read
+    const unsigned int * indices = (const unsigned int *)(payload + vertexBytes);
+    for( unsigned int i = 0; i < header.nIndices; i++ ) {
+        if( indices[i] >= header.nVerts ) {
+            clear();
+            return false;
+        }
+    }
+
+    vertexData = (const float *)payload;
+    indexData = indices;
+    return true;
+}
+
+void MeshCache::assign( vector<float> & verts, vector<unsigned int> & indices,
+                        unsigned int stride, unsigned int attributes,
+                        unsigned long long sourceHash, unsigned long long sourceSize,
+                        unsigned long long flags, unsigned int nLods,
+                        const unsigned int * lodIndexCounts, const float * lodErrors )
+{
+    clear();
+
+    vertexStore.swap(verts);
+    indexStore.swap(indices);
+    vertexData = vertexStore.empty() ? NULL : &vertexStore[0];
+    indexData = indexStore.empty() ? NULL : &indexStore[0];
+
+    memcpy(header.magic, magicBytes, sizeof(magicBytes));
+    header.version = VERSION;
+    header.flags = flags;
+    header.sourceHash = sourceHash;
+    header.sourceSize = sourceSize;
+    header.stride = stride;
+    header.attributes = attributes;
+    header.nVerts = stride > 0 ? (unsigned int)(vertexStore.size() / stride) : 0;
+    header.nIndices = (unsigned int)indexStore.size();
+    if( nLods == 0 ) {
+        header.nLods = 1;
+        header.lodIndexCount[0] = header.nIndices;
+    } else {
+        header.nLods = nLods;
+        for( unsigned int l = 0; l < nLods; l++ ) {
+            header.lodIndexCount[l] = lodIndexCounts[l];
+            header.lodError[l] = lodErrors ? lodErrors[l] : 0.0f;
+        }
+    }
+
+    // Positions always come first in the layout
+    vec3 minPoint(0.0f), maxPoint(0.0f);
+    for( unsigned int i = 0; i < header.nVerts; i++ ) {
+        vec3 p( vertexData[i * stride], vertexData[i * stride + 1], vertexData[i * stride + 2] );
+        if( i == 0 ) {
+            minPoint = maxPoint = p;
+        } else {
+            minPoint = glm::min(minPoint, p);
+            maxPoint = glm::max(maxPoint, p);
+        }
+    }
+    for( int c = 0; c < 3; c++ ) {
+        header.boundsMin[c] = minPoint[c];
+        header.boundsMax[c] = maxPoint[c];
+    }
+
+    size_t vertexBytes = vertexStore.size() * sizeof(float);
+    size_t indexBytes = indexStore.size() * sizeof(unsigned int);
+    header.payloadHash = checksum(header, vertexData, vertexBytes, indexData, indexBytes);
+}
+
+bool MeshCache::write( const char * cacheFile ) const
+{
+    // Write under a temporary name first so that a crash part way through
+    // never leaves a truncated cache behind with a valid header.
+    string tempName = string(cacheFile) + ".tmp";
+    FILE * fp = fopen(tempName.c_str(), "wb");
+    if( fp == NULL ) return false;
+
+    size_t vertexBytes = (size_t)header.nVerts * header.stride * sizeof(float);
+    size_t indexBytes = (size_t)header.nIndices * sizeof(unsigned int);
+
+    bool ok = fwrite(&header, sizeof(Header), 1, fp) == 1;
+    if( ok && vertexBytes > 0 ) ok = fwrite(vertexData, vertexBytes, 1, fp) == 1;
+    if( ok && indexBytes > 0 ) ok = fwrite(indexData, indexBytes, 1, fp) == 1;
+    ok = (fclose(fp) == 0) && ok;
+
+    if( ok ) {
+        remove(cacheFile);
+        ok = rename(tempName.c_str(), cacheFile) == 0;
+    }
+    if( ! ok ) remove(tempName.c_str());
+    return ok;
+}
+
+void MeshCache::clear()
+{
+    file.close();
+    vertexStore.clear();
+    indexStore.clear();
+    vertexData = NULL;
+    indexData = NULL;
+    memset(&header, 0, sizeof(Header));
+}
+
+unsigned int MeshCache::lodIndexOffset( unsigned int lod ) const
+{
+    unsigned int offset = 0;
+    for( unsigned int l = 0; l < lod; l++ ) offset += header.lodIndexCount[l];
+    return offset;
+}
+
+vec3 MeshCache::boundsMin() const
+{
+    return vec3(header.boundsMin[0], header.boundsMin[1], header.boundsMin[2]);
+}
+
+vec3 MeshCache::boundsMax() const
+{
+    return vec3(header.boundsMax[0], header.boundsMax[1], header.boundsMax[2]);
+}
@@ -0,0 +1,211 @@
+#include "meshdata.h"
+#include <cmath>
+#include <algorithm>
+
+namespace {
+
+// Welding grid cell of a position.  Cells are twice the position tolerance
+// wide, so a vertex's matches are in its own cell or, along each axis, the
+// neighbour on the side of the cell it is nearer: eight cells in all.
+struct Cell
+{
+    int x, y, z;
+    bool operator==( const Cell & o ) const { return x == o.x && y == o.y && z == o.z; }
+};
+
+inline unsigned int hashCell( const Cell & c )
+{
+    return ((unsigned int)c.x * 73856093u) ^ ((unsigned int)c.y * 19349663u) ^ ((unsigned int)c.z * 83492791u);
+}
+
+inline bool within( const float * a, const float * b, int n, float tolerance )
+{
+    float d = 0.0f;
+    for( int i = 0; i < n; i++ ) d += (a[i] - b[i]) * (a[i] - b[i]);
+    return d <= tolerance * tolerance;
+}
+
+}
+
+MeshData::MeshData() : primitive(TRIANGLES), boundsMin(0.0f), boundsMax(0.0f)
+{
+}
+
+size_t MeshData::triangleCount() const
+{
+    if( primitive == TRIANGLES ) return indices.size() / 3;
+
+    size_t count = 0, length = 0;
+    for( size_t i = 0; i < indices.size(); i++ ) {
+        if( indices[i] == RESTART_INDEX ) {
+            length = 0;
+            continue;
+        }
+        if( ++length < 3 ) continue;
+        unsigned int a = indices[i - 2], b = indices[i - 1], c = indices[i];
+        if( a != b && b != c && a != c ) count++;
+    }
+    return count;
+}
+
+void MeshData::triangleList( vector<unsigned int> & out ) const
+{
+    if( primitive == TRIANGLES ) {
+        out = indices;
+        return;
+    }
+
+    out.clear();
+    out.reserve(triangleCount() * 3);
+    size_t length = 0;
+    for( size_t i = 0; i < indices.size(); i++ ) {
+        if( indices[i] == RESTART_INDEX ) {
+            length = 0;
+            continue;
+        }
+        if( ++length < 3 ) continue;
+        unsigned int a = indices[i - 2], b = indices[i - 1], c = indices[i];
+        if( a == b || b == c || a == c ) continue;
+        // Every other triangle of a strip has its first two vertices swapped
+        if( length % 2 == 0 ) std::swap(a, b);
+        out.push_back(a);
+        out.push_back(b);
+        out.push_back(c);
+    }
+}
+
+void MeshData::resize( size_t nVerts, size_t nIndices, bool withNormals,
+                       bool withTexCoords, bool withTangents )
+{
+    positions.resize(3 * nVerts);
+    normals.resize(withNormals ? 3 * nVerts : 0);
+    texCoords.resize(withTexCoords ? 2 * nVerts : 0);
+    tangents.resize(withTangents ? 4 * nVerts : 0);
+    indices.resize(nIndices);
+}
+
+size_t MeshData::weld( float positionTolerance, float normalTolerance, bool matchTexCoords )
+{
+    const unsigned int none = ~0u;
+    size_t nVerts = vertexCount();
+    if( nVerts == 0 ) return 0;
+
+    computeBounds();
+    float scale = 0.5f / positionTolerance;
+    bool withNormals = ! normals.empty();
+    bool withTexCoords = matchTexCoords && ! texCoords.empty();
+
+    // Open addressing from cell to the first kept vertex in it; the kept
+    // vertices in a cell are chained through next
+    size_t size = 16;
+    while( size < nVerts * 2 ) size *= 2;
+    size_t mask = size - 1;
+    vector<Cell> cells(size);
+    vector<unsigned int> heads(size, none);
+    vector<unsigned int> next, kept;         // Per kept vertex: chain, original vertex
+    vector<unsigned int> remap(nVerts);
+    next.reserve(nVerts);
+    kept.reserve(nVerts);
+
+    for( size_t v = 0; v < nVerts; v++ ) {
+        const float * p = &positions[3 * v];
+        float fx = (p[0] - boundsMin.x) * scale;
+        float fy = (p[1] - boundsMin.y) * scale;
+        float fz = (p[2] - boundsMin.z) * scale;
+        Cell home = { (int)floor(fx), (int)floor(fy), (int)floor(fz) };
+        int sx = (fx - home.x < 0.5f) ? -1 : 1;
+        int sy = (fy - home.y < 0.5f) ? -1 : 1;
+        int sz = (fz - home.z < 0.5f) ? -1 : 1;
+
+        unsigned int match = none;
+        for( int n = 0; n < 8 && match == none; n++ ) {
+            Cell c = { home.x + (n & 1) * sx, home.y + ((n >> 1) & 1) * sy, home.z + (n >> 2) * sz };
+            size_t i = hashCell(c) & mask;
+            while( heads[i] != none && ! (cells[i] == c) ) i = (i + 1) & mask;
+
+            for( unsigned int k = heads[i]; k != none && match == none; k = next[k] ) {
+                unsigned int u = kept[k];
+                if( ! within(&positions[3 * u], p, 3, positionTolerance) ) continue;
+                if( withNormals && ! within(&normals[3 * u], &normals[3 * v], 3, normalTolerance) ) continue;
+                if( withTexCoords && ! within(&texCoords[2 * u], &texCoords[2 * v], 2, normalTolerance) ) continue;
+                match = k;
+            }
+        }
+
+        if( match == none ) {
+            match = (unsigned int)kept.size();
+            size_t i = hashCell(home) & mask;
+            while( heads[i] != none && ! (cells[i] == home) ) i = (i + 1) & mask;
+            cells[i] = home;
+            next.push_back(heads[i]);
+            heads[i] = match;
+            kept.push_back((unsigned int)v);
+        }
+        remap[v] = match;
+    }
+
+    // Kept vertices only move down, so the streams compact in place
+    size_t nKept = kept.size();
+    for( size_t k = 0; k < nKept; k++ ) {
+        size_t v = kept[k];
+        for( int c = 0; c < 3; c++ ) positions[3 * k + c] = positions[3 * v + c];
+        if( withNormals ) for( int c = 0; c < 3; c++ ) normals[3 * k + c] = normals[3 * v + c];
+        if( ! texCoords.empty() ) for( int c = 0; c < 2; c++ ) texCoords[2 * k + c] = texCoords[2 * v + c];
+        if( ! tangents.empty() ) for( int c = 0; c < 4; c++ ) tangents[4 * k + c] = tangents[4 * v + c];
+    }
+    positions.resize(3 * nKept);
+    if( withNormals ) normals.resize(3 * nKept);
+    if( ! texCoords.empty() ) texCoords.resize(2 * nKept);
+    if( ! tangents.empty() ) tangents.resize(4 * nKept);
+
+    if( primitive == TRIANGLE_STRIPS ) {
+        for( size_t i = 0; i < indices.size(); i++ ) {
+            if( indices[i] != RESTART_INDEX ) indices[i] = remap[indices[i]];
+        }
+        return nKept;
+    }
+
+    size_t out = 0;
+    for( size_t i = 0; i + 2 < indices.size(); i += 3 ) {
+        unsigned int a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+        if( a == b || b == c || a == c ) continue;
+        indices[out++] = a;
+        indices[out++] = b;
+        indices[out++] = c;
+    }
+    indices.resize(out);
+
+    return nKept;
+}
+
+void MeshData::computeBounds()
+{
+    size_t nVerts = vertexCount();
+    if( nVerts == 0 ) {
+        boundsMin = boundsMax = vec3(0.0f);
+        return;
+    }
+    boundsMin = boundsMax = vec3(positions[0], positions[1], positions[2]);
+    for( size_t v = 1; v < nVerts; v++ ) {
+        vec3 p(positions[3 * v], positions[3 * v + 1], positions[3 * v + 2]);
+        boundsMin = glm::min(boundsMin, p);
+        boundsMax = glm::max(boundsMax, p);
+    }
+}
+
+size_t MeshData::memoryBytes() const
+{
+    return (positions.size() + normals.size() + texCoords.size() + tangents.size()) * sizeof(float) +
+            indices.size() * sizeof(unsigned int);
+}
+
+void MeshData::clear()
+{
+    positions.clear();
+    normals.clear();
+    texCoords.clear();
+    tangents.clear();
+    indices.clear();
+    primitive = TRIANGLES;
+    boundsMin = boundsMax = vec3(0.0f);
+}
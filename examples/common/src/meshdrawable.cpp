@@ -0,0 +1,78 @@
+#include "meshdrawable.h"
+#include <GL/glew.h>
+
+MeshDrawable::MeshDrawable() : indexType(GL_UNSIGNED_INT), indexCount(0),
+    primitive(MeshData::TRIANGLES)
+{
+}
+
+MeshDrawable::MeshDrawable( const MeshData & data, VertexLayout layout,
+                            VertexCompression compression ) :
+    indexType(GL_UNSIGNED_INT), indexCount(0), primitive(MeshData::TRIANGLES)
+{
+    upload(data, layout, compression);
+}
+
+void MeshDrawable::upload( const MeshData & data, VertexLayout layout,
+                           VertexCompression compression )
+{
+    GLuint nVerts = (GLuint)data.vertexCount();
+    if( nVerts == 0 || data.indices.empty() ) return;
+    releaseStorage();
+    indexCount = (unsigned int)data.indices.size();
+    primitive = data.primitive;
+
+    glGenVertexArrays( 1, &vaoHandle );
+    glBindVertexArray(vaoHandle);
+
+    VertexAttribute attributes[4];
+    int nAttributes = 0;
+    VertexAttribute position = { 0, 3, &data.positions[0], 0, POSITION };
+    attributes[nAttributes++] = position;
+    if( ! data.normals.empty() ) {
+        VertexAttribute normal = { 1, 3, &data.normals[0], 0, DIRECTION };
+        attributes[nAttributes++] = normal;
+    }
+    if( ! data.texCoords.empty() ) {
+        VertexAttribute texCoord = { 2, 2, &data.texCoords[0], 0, TEXCOORD };
+        attributes[nAttributes++] = texCoord;
+    }
+    if( ! data.tangents.empty() ) {
+        VertexAttribute tangent = { 3, 4, &data.tangents[0], 0, DIRECTION };
+        attributes[nAttributes++] = tangent;
+    }
+    storeVertexAttributes(attributes, nAttributes, nVerts, layout, compression);
+
+    // The restart index becomes the largest value of the index type, so
+    // strips need one value more than the vertices
+    GLuint range = (primitive == MeshData::TRIANGLE_STRIPS) ? nVerts + 1 : nVerts;
+    indexType = storeIndices(&data.indices[0], indexCount, range);
+
+    glBindVertexArray(0);
+}
+
+void MeshDrawable::render() const {
+    draw(1, false);
+}
+
+void MeshDrawable::renderInstanced( int count ) const {
+    draw(count, true);
+}
+
+void MeshDrawable::draw( int instances, bool instanced ) const {
+    bool strips = (primitive == MeshData::TRIANGLE_STRIPS);
+    GLenum mode = strips ? GL_TRIANGLE_STRIP : GL_TRIANGLES;
+
+    glBindVertexArray(vaoHandle);
+    if( strips ) {
+        glEnable(GL_PRIMITIVE_RESTART);
+        glPrimitiveRestartIndex(indexType == GL_UNSIGNED_SHORT ? 0xffff : 0xffffffff);
+    }
+    if( instanced ) {
+        glDrawElementsInstanced(mode, indexCount, indexType, ((GLubyte *)NULL + (indexOffset)),
+                                instances);
+    } else {
+        glDrawElements(mode, indexCount, indexType, ((GLubyte *)NULL + (indexOffset)));
+    }
+    if( strips ) glDisable(GL_PRIMITIVE_RESTART);
+}
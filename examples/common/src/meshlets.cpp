@@ -0,0 +1,222 @@
+#include "meshlets.h"
+
+#include <cmath>
+
+namespace {
+
+inline vec3 position( const float * verts, size_t stride, unsigned int v )
+{
+    const float * p = verts + v * stride;
+    return vec3(p[0], p[1], p[2]);
+}
+
+// Distinct vertices of the triangle not yet in cluster id
+unsigned int newVertices( const unsigned int * tri, const vector<unsigned int> & seen, unsigned int id )
+{
+    unsigned int count = 0;
+    for( int k = 0; k < 3; k++ ) {
+        bool repeat = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+        if( seen[tri[k]] != id && ! repeat ) count++;
+    }
+    return count;
+}
+
+void computeBounds( Meshlets::Meshlet & m, const unsigned int * indices,
+                    const float * verts, size_t stride )
+{
+    const unsigned int * el = indices + m.firstIndex;
+
+    // Sphere around the centre of the bounding box
+    vec3 minPoint = position(verts, stride, el[0]), maxPoint = minPoint;
+    for( unsigned int i = 1; i < m.indexCount; i++ ) {
+        vec3 p = position(verts, stride, el[i]);
+        minPoint = glm::min(minPoint, p);
+        maxPoint = glm::max(maxPoint, p);
+    }
+    m.center = 0.5f * (minPoint + maxPoint);
+    m.radius = 0.0f;
+    for( unsigned int i = 0; i < m.indexCount; i++ ) {
+        m.radius = glm::max(m.radius, glm::length(position(verts, stride, el[i]) - m.center));
+    }
+
+    // Normal cone: the axis is the average triangle normal, and the cone
+    // is as wide as the triangle furthest from it.  Once that reaches 90
+    // degrees some triangle faces every direction the camera can look from.
+    m.coneAxis = vec3(0.0f);
+    m.coneCutoff = 2.0f;
+    vec3 normals[Meshlets::MAX_TRIANGLES];
+    unsigned int nNormals = 0;
+    for( unsigned int i = 0; i < m.indexCount; i += 3 ) {
+        vec3 p0 = position(verts, stride, el[i]);
+        vec3 n = glm::cross(position(verts, stride, el[i + 1]) - p0,
+                            position(verts, stride, el[i + 2]) - p0);
+        float len = glm::length(n);
+        if( len == 0.0f ) continue;
+        if( nNormals == Meshlets::MAX_TRIANGLES ) return;
+        normals[nNormals++] = n / len;
+        m.coneAxis += n / len;
+    }
+    float axisLen = glm::length(m.coneAxis);
+    if( nNormals == 0 || axisLen == 0.0f ) return;
+    m.coneAxis /= axisLen;
+
+    float minDot = 1.0f;
+    for( unsigned int i = 0; i < nNormals; i++ ) {
+        minDot = glm::min(minDot, glm::dot(normals[i], m.coneAxis));
+    }
+    if( minDot > 0.0f ) m.coneCutoff = sqrt(1.0f - minDot * minDot);
+}
+
+}
+
+void Meshlets::build( const unsigned int * el, size_t nIndices,
+                      const float * verts, size_t stride, size_t nVerts,
+                      unsigned int maxVertices, unsigned int maxTriangles )
+{
+    if( maxTriangles > MAX_TRIANGLES ) maxTriangles = MAX_TRIANGLES;
+    size_t nTris = nIndices / 3;
+
+    meshlets.clear();
+    indices.clear();
+    indices.reserve(nTris * 3);
+
+    // Vertex to triangle adjacency
+    vector<unsigned int> adjOffset(nVerts + 1, 0), adjTris(nTris * 3);
+    for( size_t i = 0; i < nTris * 3; i++ ) adjOffset[el[i] + 1]++;
+    for( size_t v = 0; v < nVerts; v++ ) adjOffset[v + 1] += adjOffset[v];
+    {
+        vector<unsigned int> fill(adjOffset.begin(), adjOffset.end() - 1);
+        for( size_t i = 0; i < nTris * 3; i++ ) adjTris[fill[el[i]]++] = (unsigned int)(i / 3);
+    }
+
+    vector<vec3> normals(nTris);
+    for( size_t t = 0; t < nTris; t++ ) {
+        vec3 p0 = position(verts, stride, el[t * 3]);
+        vec3 n = glm::cross(position(verts, stride, el[t * 3 + 1]) - p0,
+                            position(verts, stride, el[t * 3 + 2]) - p0);
+        float len = glm::length(n);
+        normals[t] = (len > 0.0f) ? n / len : vec3(0.0f);
+    }
+
+    // seen[v] is the cluster that last used vertex v
+    vector<unsigned int> seen(nVerts, ~0u);
+    vector<bool> emitted(nTris, false);
+    vector<unsigned int> clusterVerts;
+    size_t seed = 0;
+
+    while( true ) {
+        // Seed each cluster with the first triangle left in index order, so
+        // clusters follow the locality of the input
+        while( seed < nTris && emitted[seed] ) seed++;
+        if( seed == nTris ) break;
+
+        unsigned int id = (unsigned int)meshlets.size();
+        Meshlet m;
+        m.firstIndex = (unsigned int)indices.size();
+        m.indexCount = m.vertexCount = 0;
+        vec3 axis(0.0f);
+        clusterVerts.clear();
+
+        size_t next = seed;
+        while( next != nTris ) {
+            const unsigned int * tri = el + next * 3;
+            unsigned int newVerts = newVertices(tri, seen, id);
+            for( int k = 0; k < 3; k++ ) {
+                if( seen[tri[k]] != id ) clusterVerts.push_back(tri[k]);
+                seen[tri[k]] = id;
+                indices.push_back(tri[k]);
+            }
+            emitted[next] = true;
+            m.vertexCount += newVerts;
+            m.indexCount += 3;
+            axis += normals[next];
+            if( m.indexCount / 3 == maxTriangles ) break;
+
+            // Grow through the triangles around the cluster: fewest new
+            // vertices first (keeps the cluster compact), then the one
+            // closest to the cluster's facing (keeps the normal cone narrow)
+            next = nTris;
+            unsigned int bestNew = 4;
+            float bestDot = -2.0f;
+            for( size_t c = 0; c < clusterVerts.size(); c++ ) {
+                unsigned int v = clusterVerts[c];
+                for( unsigned int j = adjOffset[v]; j < adjOffset[v + 1]; j++ ) {
+                    unsigned int t = adjTris[j];
+                    if( emitted[t] ) continue;
+                    unsigned int n = newVertices(el + t * 3, seen, id);
+                    if( m.vertexCount + n > maxVertices ) continue;
+                    float d = glm::dot(normals[t], axis);
+                    if( n < bestNew || (n == bestNew && d > bestDot) ) {
+                        next = t;
+                        bestNew = n;
+                        bestDot = d;
+                    }
+                }
+            }
+        }
+
+        computeBounds(m, &indices[0], verts, stride);
+        meshlets.push_back(m);
+    }
+}
+
+size_t Meshlets::cull( const mat4 & mvp, const vec4 & camera, vector<unsigned int> & out,
+                       CullStats * stats ) const
+{
+    // Frustum planes in the mesh's coordinates (Gribb & Hartmann), with
+    // normalized normals so that distances compare against radii
+    vec4 rows[4];
+    for( int r = 0; r < 4; r++ ) rows[r] = vec4(mvp[0][r], mvp[1][r], mvp[2][r], mvp[3][r]);
+    vec4 planes[6];
+    for( int p = 0; p < 3; p++ ) {
+        planes[2 * p] = rows[3] + rows[p];
+        planes[2 * p + 1] = rows[3] - rows[p];
+    }
+    for( int p = 0; p < 6; p++ ) {
+        float len = glm::length(vec3(planes[p]));
+        if( len > 0.0f ) planes[p] /= len;
+    }
+
+    bool orthographic = (camera.w == 0.0f);
+    vec3 eye(camera);
+    if( orthographic ) eye = glm::normalize(eye);
+
+    CullStats counts;
+    counts.visible = counts.frustumCulled = counts.backfaceCulled = 0;
+    out.clear();
+
+    for( size_t i = 0; i < meshlets.size(); i++ ) {
+        const Meshlet & m = meshlets[i];
+
+        bool outside = false;
+        for( int p = 0; p < 6 && ! outside; p++ ) {
+            outside = glm::dot(vec3(planes[p]), m.center) + planes[p].w < -m.radius;
+        }
+        if( outside ) {
+            counts.frustumCulled++;
+            continue;
+        }
+
+        if( m.coneCutoff <= 1.0f ) {
+            bool backfacing;
+            if( orthographic ) {
+                backfacing = glm::dot(eye, m.coneAxis) >= m.coneCutoff;
+            } else {
+                vec3 toCenter = m.center - eye;
+                backfacing = glm::dot(toCenter, m.coneAxis) >=
+                        m.coneCutoff * glm::length(toCenter) + m.radius;
+            }
+            if( backfacing ) {
+                counts.backfaceCulled++;
+                continue;
+            }
+        }
+
+        counts.visible++;
+        out.insert(out.end(), indices.begin() + m.firstIndex,
+                   indices.begin() + m.firstIndex + m.indexCount);
+    }
+
+    if( stats ) *stats = counts;
+    return out.size();
+}
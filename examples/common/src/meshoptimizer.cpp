@@ -0,0 +1,887 @@
+#include "meshoptimizer.h"
+
+#include <vector>
+using std::vector;
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <glm/glm.hpp>
+using glm::vec3;
+
+namespace {
+
+// Tuning constants from Forsyth's "Linear-Speed Vertex Cache Optimisation"
+const int   maxCacheSize = 32;
+const float cacheDecayPower = 1.5f;
+const float lastTriScore = 0.75f;
+const float valenceBoostScale = 2.0f;
+const float valenceBoostPower = 0.5f;
+const int   maxValenceTable = 32;
+
+struct ScoreTables
+{
+    float cache[maxCacheSize];
+    float valence[maxValenceTable];
+
+    ScoreTables()
+    {
+        for( int i = 0; i < maxCacheSize; i++ ) {
+            if( i < 3 ) {
+                // The three vertices of the last triangle get a fixed score
+                // so the next triangle is not forced to reuse them
+                cache[i] = lastTriScore;
+            } else {
+                float s = 1.0f - (i - 3) * (1.0f / (maxCacheSize - 3));
+                cache[i] = pow(s, cacheDecayPower);
+            }
+        }
+        valence[0] = 0.0f;
+        for( int i = 1; i < maxValenceTable; i++ ) {
+            valence[i] = valenceBoostScale * pow((float)i, -valenceBoostPower);
+        }
+    }
+};
+
+const ScoreTables scoreTables;
+
+inline float vertexScore( int cachePosition, unsigned int remaining )
+{
+    // Vertices with no triangles left never need to be visited again
+    if( remaining == 0 ) return -1.0f;
+
+    float score = (cachePosition >= 0) ? scoreTables.cache[cachePosition] : 0.0f;
+    if( remaining < (unsigned int)maxValenceTable ) {
+        score += scoreTables.valence[remaining];
+    } else {
+        score += valenceBoostScale * pow((float)remaining, -valenceBoostPower);
+    }
+    return score;
+}
+
+}
+
+void MeshOptimizer::optimizeVertexCache( unsigned int * indices, size_t nIndices, size_t nVerts )
+{
+    size_t nTris = nIndices / 3;
+    if( nTris == 0 || nVerts == 0 ) return;
+
+    // Vertex to triangle adjacency.  The first remaining[v] entries of each
+    // list are the triangles that haven't been emitted yet.
+    vector<unsigned int> remaining(nVerts, 0);
+    for( size_t i = 0; i < nTris * 3; i++ ) remaining[indices[i]]++;
+
+    vector<unsigned int> offsets(nVerts + 1, 0);
+    for( size_t v = 0; v < nVerts; v++ ) offsets[v + 1] = offsets[v] + remaining[v];
+
+    vector<unsigned int> adjacency(nTris * 3);
+    vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+    for( size_t t = 0; t < nTris; t++ ) {
+        for( int k = 0; k < 3; k++ ) {
+            adjacency[fill[indices[t * 3 + k]]++] = (unsigned int)t;
+        }
+    }
+
+    vector<int> cachePosition(nVerts, -1);
+    vector<float> vScore(nVerts);
+    for( size_t v = 0; v < nVerts; v++ ) vScore[v] = vertexScore(-1, remaining[v]);
+
+    vector<bool> emitted(nTris, false);
+    int best = 0;
+    float bestScore = -1.0f;
+    for( size_t t = 0; t < nTris; t++ ) {
+        float score = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] + vScore[indices[t * 3 + 2]];
+        if( score > bestScore ) {
+            bestScore = score;
+            best = (int)t;
+        }
+    }
+
+    unsigned int cache[maxCacheSize + 3];
+    int cacheCount = 0;
+    size_t scanCursor = 0;
+    vector<unsigned int> output(nTris * 3);
+
+    for( size_t outTri = 0; outTri < nTris; outTri++ ) {
+        if( best < 0 ) {
+            // Nothing in the cache touches an unemitted triangle; restart
+            // from the next one in input order
+            while( emitted[scanCursor] ) scanCursor++;
+            best = (int)scanCursor;
+        }
+
+        const unsigned int * tri = indices + best * 3;
+        output[outTri * 3] = tri[0];
+        output[outTri * 3 + 1] = tri[1];
+        output[outTri * 3 + 2] = tri[2];
+        emitted[best] = true;
+
+        // Remove the triangle from its vertices' live lists (a degenerate
+        // triangle is listed once per corner, so this runs per corner too)
+        for( int k = 0; k < 3; k++ ) {
+            unsigned int v = tri[k];
+            unsigned int * list = &adjacency[offsets[v]];
+            for( unsigned int j = 0; j < remaining[v]; j++ ) {
+                if( list[j] == (unsigned int)best ) {
+                    list[j] = list[remaining[v] - 1];
+                    list[remaining[v] - 1] = (unsigned int)best;
+                    remaining[v]--;
+                    break;
+                }
+            }
+        }
+
+        // Move the triangle's vertices to the front of the LRU cache
+        unsigned int newCache[maxCacheSize + 3];
+        int newCount = 0;
+        for( int k = 0; k < 3; k++ ) {
+            bool seen = false;
+            for( int j = 0; j < newCount; j++ ) seen = seen || newCache[j] == tri[k];
+            if( ! seen ) newCache[newCount++] = tri[k];
+        }
+        for( int i = 0; i < cacheCount; i++ ) {
+            unsigned int v = cache[i];
+            if( v != tri[0] && v != tri[1] && v != tri[2] ) newCache[newCount++] = v;
+        }
+
+        // Rescore the vertices that were in or just fell out of the cache
+        for( int i = 0; i < newCount; i++ ) {
+            unsigned int v = newCache[i];
+            cachePosition[v] = (i < maxCacheSize) ? i : -1;
+            vScore[v] = vertexScore(cachePosition[v], remaining[v]);
+        }
+        cacheCount = (newCount < maxCacheSize) ? newCount : maxCacheSize;
+        for( int i = 0; i < cacheCount; i++ ) cache[i] = newCache[i];
+
+        // Rescore their triangles and pick the next one to emit
+        best = -1;
+        bestScore = -1.0f;
+        for( int i = 0; i < newCount; i++ ) {
+            unsigned int v = newCache[i];
+            const unsigned int * list = &adjacency[offsets[v]];
+            for( unsigned int j = 0; j < remaining[v]; j++ ) {
+                unsigned int t = list[j];
+                float score = vScore[indices[t * 3]] + vScore[indices[t * 3 + 1]] +
+                              vScore[indices[t * 3 + 2]];
+                if( score > bestScore ) {
+                    bestScore = score;
+                    best = (int)t;
+                }
+            }
+        }
+    }
+
+    for( size_t i = 0; i < nTris * 3; i++ ) indices[i] = output[i];
+}
+
+MeshOptimizer::VertexCacheStats MeshOptimizer::analyzeVertexCache(
+        const unsigned int * indices, size_t nIndices, size_t nVerts, unsigned int cacheSize )
+{
+    VertexCacheStats stats;
+    stats.transforms = 0;
+    stats.acmr = 0.0f;
+    stats.atvr = 0.0f;
+
+    // FIFO: a vertex is a hit if fewer than cacheSize misses happened since
+    // it was last brought into the cache
+    vector<unsigned int> timestamp(nVerts, 0);
+    unsigned int time = cacheSize + 1;
+    size_t unique = 0;
+    for( size_t i = 0; i < nIndices; i++ ) {
+        unsigned int v = indices[i];
+        if( timestamp[v] == 0 ) unique++;
+        if( time - timestamp[v] > cacheSize ) {
+            timestamp[v] = time++;
+            stats.transforms++;
+        }
+    }
+
+    if( nIndices >= 3 ) stats.acmr = (float)stats.transforms / (nIndices / 3);
+    if( unique > 0 ) stats.atvr = (float)stats.transforms / unique;
+    return stats;
+}
+
+namespace {
+
+struct Cluster
+{
+    size_t start;       // First triangle
+    size_t end;         // One past the last triangle
+    float sortKey;
+};
+
+bool clusterBefore( const Cluster & a, const Cluster & b )
+{
+    return a.sortKey > b.sortKey;
+}
+
+inline vec3 position( const float * verts, size_t stride, unsigned int v )
+{
+    const float * p = verts + v * stride;
+    return vec3(p[0], p[1], p[2]);
+}
+
+// FIFO post-transform cache used to find cluster boundaries.  Returns the
+// number of misses for one triangle.
+struct FifoCache
+{
+    vector<unsigned int> timestamp;
+    unsigned int time;
+    unsigned int size;
+
+    FifoCache( size_t nVerts, unsigned int cacheSize ) :
+        timestamp(nVerts, 0), time(cacheSize + 1), size(cacheSize) { }
+
+    void reset() { time += size + 1; }
+
+    int triangleMisses( const unsigned int * tri )
+    {
+        int misses = 0;
+        for( int k = 0; k < 3; k++ ) {
+            if( time - timestamp[tri[k]] > size ) {
+                timestamp[tri[k]] = time++;
+                misses++;
+            }
+        }
+        return misses;
+    }
+};
+
+}
+
+void MeshOptimizer::optimizeOverdraw( unsigned int * indices, size_t nIndices,
+                                      const float * verts, size_t stride, size_t nVerts,
+                                      float threshold )
+{
+    size_t nTris = nIndices / 3;
+    if( nTris == 0 ) return;
+
+    // Hard boundaries: triangles where the cache was effectively flushed
+    // (all three vertices missed)
+    vector<size_t> hard;
+    {
+        FifoCache cache(nVerts, 16);
+        for( size_t t = 0; t < nTris; t++ ) {
+            if( cache.triangleMisses(indices + t * 3) == 3 || t == 0 ) hard.push_back(t);
+        }
+        hard.push_back(nTris);
+    }
+
+    // Soft boundaries: within each hard cluster, close a cluster as soon as
+    // its own ACMR drops to within threshold of the hard cluster's ACMR
+    vector<Cluster> clusters;
+    {
+        FifoCache cache(nVerts, 16);
+        for( size_t h = 0; h + 1 < hard.size(); h++ ) {
+            size_t start = hard[h], end = hard[h + 1];
+
+            cache.reset();
+            int misses = 0;
+            for( size_t t = start; t < end; t++ ) misses += cache.triangleMisses(indices + t * 3);
+            float target = threshold * misses / (end - start);
+
+            cache.reset();
+            size_t clusterStart = start;
+            misses = 0;
+            for( size_t t = start; t < end; t++ ) {
+                misses += cache.triangleMisses(indices + t * 3);
+                if( t + 1 < end && (float)misses / (t + 1 - clusterStart) <= target ) {
+                    Cluster c = { clusterStart, t + 1, 0.0f };
+                    clusters.push_back(c);
+                    clusterStart = t + 1;
+                    misses = 0;
+                    cache.reset();
+                }
+            }
+            Cluster c = { clusterStart, end, 0.0f };
+            clusters.push_back(c);
+        }
+    }
+
+    // Area weighted centroid of the whole mesh
+    vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for( size_t t = 0; t < nTris; t++ ) {
+        vec3 p0 = position(verts, stride, indices[t * 3]);
+        vec3 p1 = position(verts, stride, indices[t * 3 + 1]);
+        vec3 p2 = position(verts, stride, indices[t * 3 + 2]);
+        float area = glm::length(glm::cross(p1 - p0, p2 - p0));
+        meshCentroid += (p0 + p1 + p2) * (area / 3.0f);
+        meshArea += area;
+    }
+    if( meshArea > 0.0f ) meshCentroid /= meshArea;
+
+    // Occlusion potential of each cluster: how far out along its average
+    // normal it sits relative to the centroid, as a fraction of the mesh
+    // radius
+    float radius = 0.0f;
+    for( size_t t = 0; t < nTris * 3; t++ ) {
+        radius = glm::max(radius, glm::length(position(verts, stride, indices[t]) - meshCentroid));
+    }
+    if( radius <= 0.0f ) return;
+
+    vector<float> keys(clusters.size());
+    for( size_t i = 0; i < clusters.size(); i++ ) {
+        const Cluster & c = clusters[i];
+        vec3 centroid(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for( size_t t = c.start; t < c.end; t++ ) {
+            vec3 p0 = position(verts, stride, indices[t * 3]);
+            vec3 p1 = position(verts, stride, indices[t * 3 + 1]);
+            vec3 p2 = position(verts, stride, indices[t * 3 + 2]);
+            vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float a = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal += n;
+            area += a;
+        }
+        if( area > 0.0f ) centroid /= area;
+        float len = glm::length(normal);
+        keys[i] = (len > 0.0f) ? glm::dot(centroid - meshCentroid, normal / len) / radius : 0.0f;
+    }
+
+    // The keys are quantized and the sort is stable, so clusters of about
+    // the same potential stay in cache order and neighbours in that order
+    // stay together.  Coarser steps move fewer clusters: take the finest
+    // whose ACMR is within threshold of the input's, else leave the input.
+    float inputAcmr = analyzeVertexCache(indices, nTris * 3, nVerts, 16).acmr;
+    vector<Cluster> sorted(clusters.size());
+    vector<unsigned int> output(nTris * 3);
+    for( int levels = 16; levels >= 1; levels /= 2 ) {
+        for( size_t i = 0; i < clusters.size(); i++ ) {
+            sorted[i] = clusters[i];
+            sorted[i].sortKey = floor(keys[i] * levels);
+        }
+        std::stable_sort(sorted.begin(), sorted.end(), clusterBefore);
+
+        unsigned int * out = &output[0];
+        for( size_t i = 0; i < sorted.size(); i++ ) {
+            size_t n = (sorted[i].end - sorted[i].start) * 3;
+            memcpy(out, indices + sorted[i].start * 3, n * sizeof(unsigned int));
+            out += n;
+        }
+        if( analyzeVertexCache(&output[0], nTris * 3, nVerts, 16).acmr <= threshold * inputAcmr ) {
+            memcpy(indices, &output[0], nTris * 3 * sizeof(unsigned int));
+            return;
+        }
+    }
+}
+
+MeshOptimizer::OverdrawStats MeshOptimizer::analyzeOverdraw(
+        const unsigned int * indices, size_t nIndices,
+        const float * verts, size_t stride, size_t nVerts )
+{
+    const int res = 256;
+
+    OverdrawStats stats;
+    stats.covered = 0;
+    stats.shaded = 0;
+    stats.overdraw = 0.0f;
+    if( nVerts == 0 || nIndices < 3 ) return stats;
+
+    // Bounding sphere (AABB centre, farthest vertex)
+    vec3 minPoint = position(verts, stride, 0), maxPoint = minPoint;
+    for( size_t v = 1; v < nVerts; v++ ) {
+        minPoint = glm::min(minPoint, position(verts, stride, (unsigned int)v));
+        maxPoint = glm::max(maxPoint, position(verts, stride, (unsigned int)v));
+    }
+    vec3 center = (minPoint + maxPoint) * 0.5f;
+    float radius = 0.0f;
+    for( size_t v = 0; v < nVerts; v++ ) {
+        radius = glm::max(radius, glm::length(position(verts, stride, (unsigned int)v) - center));
+    }
+    if( radius <= 0.0f ) return stats;
+
+    // The six axes and the eight cube diagonals
+    vector<vec3> views;
+    for( int axis = 0; axis < 3; axis++ ) {
+        vec3 d(0.0f);
+        d[axis] = 1.0f;
+        views.push_back(d);
+        views.push_back(-d);
+    }
+    for( int i = 0; i < 8; i++ ) {
+        views.push_back(glm::normalize(vec3((i & 1) ? 1.0f : -1.0f,
+                                            (i & 2) ? 1.0f : -1.0f,
+                                            (i & 4) ? 1.0f : -1.0f)));
+    }
+
+    vector<float> depth(res * res);
+    vector<vec3> screen(nVerts);
+
+    for( size_t view = 0; view < views.size(); view++ ) {
+        vec3 dir = views[view];
+        vec3 up = (fabs(dir.y) < 0.99f) ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f);
+        vec3 right = glm::normalize(glm::cross(up, dir));
+        up = glm::cross(dir, right);
+
+        // Orthographic projection; smaller z is nearer the viewer
+        float scale = 0.5f * res / radius;
+        for( size_t v = 0; v < nVerts; v++ ) {
+            vec3 p = position(verts, stride, (unsigned int)v) - center;
+            screen[v] = vec3(glm::dot(p, right) * scale + 0.5f * res,
+                             glm::dot(p, up) * scale + 0.5f * res,
+                             glm::dot(p, dir));
+        }
+
+        std::fill(depth.begin(), depth.end(), 1e30f);
+
+        for( size_t i = 0; i + 2 < nIndices; i += 3 ) {
+            vec3 a = screen[indices[i]];
+            vec3 b = screen[indices[i + 1]];
+            vec3 c = screen[indices[i + 2]];
+
+            float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+            if( area == 0.0f ) continue;
+            if( area < 0.0f ) {
+                std::swap(b, c);
+                area = -area;
+            }
+
+            int x0 = glm::max(0, (int)floor(glm::min(a.x, glm::min(b.x, c.x))));
+            int x1 = glm::min(res - 1, (int)ceil(glm::max(a.x, glm::max(b.x, c.x))));
+            int y0 = glm::max(0, (int)floor(glm::min(a.y, glm::min(b.y, c.y))));
+            int y1 = glm::min(res - 1, (int)ceil(glm::max(a.y, glm::max(b.y, c.y))));
+
+            float invArea = 1.0f / area;
+            for( int y = y0; y <= y1; y++ ) {
+                float py = y + 0.5f;
+                for( int x = x0; x <= x1; x++ ) {
+                    float px = x + 0.5f;
+                    float w0 = (c.x - b.x) * (py - b.y) - (c.y - b.y) * (px - b.x);
+                    float w1 = (a.x - c.x) * (py - c.y) - (a.y - c.y) * (px - c.x);
+                    float w2 = (b.x - a.x) * (py - a.y) - (b.y - a.y) * (px - a.x);
+                    if( w0 < 0.0f || w1 < 0.0f || w2 < 0.0f ) continue;
+
+                    float z = (w0 * a.z + w1 * b.z + w2 * c.z) * invArea;
+                    float & d = depth[y * res + x];
+                    if( d == 1e30f ) stats.covered++;
+                    if( z < d ) {
+                        d = z;
+                        stats.shaded++;
+                    }
+                }
+            }
+        }
+    }
+
+    if( stats.covered > 0 ) stats.overdraw = (float)stats.shaded / stats.covered;
+    return stats;
+}
+
+size_t MeshOptimizer::optimizeVertexFetch( float * verts, size_t stride,
+                                           unsigned int * indices, size_t nIndices, size_t nVerts )
+{
+    const unsigned int unused = ~0u;
+    vector<unsigned int> remap(nVerts, unused);
+    unsigned int next = 0;
+    for( size_t i = 0; i < nIndices; i++ ) {
+        unsigned int & r = remap[indices[i]];
+        if( r == unused ) r = next++;
+        indices[i] = r;
+    }
+
+    vector<float> reordered((size_t)next * stride);
+    for( size_t v = 0; v < nVerts; v++ ) {
+        if( remap[v] != unused ) {
+            memcpy(&reordered[remap[v] * stride], verts + v * stride, stride * sizeof(float));
+        }
+    }
+    if( next > 0 ) memcpy(verts, &reordered[0], reordered.size() * sizeof(float));
+    return next;
+}
+
+MeshOptimizer::VertexFetchStats MeshOptimizer::analyzeVertexFetch(
+        const unsigned int * indices, size_t nIndices, size_t nVerts, size_t vertexSize )
+{
+    const unsigned int lineSize = 64;
+    const unsigned int cacheLines = 64;
+
+    VertexFetchStats stats;
+    stats.bytesFetched = 0;
+    stats.lineMisses = 0;
+    stats.overfetch = 0.0f;
+    if( nVerts == 0 || vertexSize == 0 ) return stats;
+
+    FifoCache vertexCache(nVerts, 16);
+
+    size_t nLines = (nVerts * vertexSize + lineSize - 1) / lineSize;
+    vector<unsigned int> lineTime(nLines, 0);
+    unsigned int time = cacheLines + 1;
+
+    for( size_t i = 0; i < nIndices; i++ ) {
+        unsigned int v = indices[i];
+        if( vertexCache.time - vertexCache.timestamp[v] <= vertexCache.size ) continue;
+        vertexCache.timestamp[v] = vertexCache.time++;
+
+        size_t first = (v * vertexSize) / lineSize;
+        size_t last = ((v + 1) * vertexSize - 1) / lineSize;
+        for( size_t line = first; line <= last; line++ ) {
+            if( time - lineTime[line] > cacheLines ) {
+                lineTime[line] = time++;
+                stats.lineMisses++;
+                stats.bytesFetched += lineSize;
+            }
+        }
+    }
+
+    stats.overfetch = (float)stats.bytesFetched / (nVerts * vertexSize);
+    return stats;
+}
+
+namespace {
+
+// Symmetric 4x4 plane quadric (Garland & Heckbert) plus the total weight
+// of the planes summed into it, so that errors come out as a weighted mean
+// squared distance rather than growing with valence.
+struct Quadric
+{
+    double a00, a11, a22, a10, a20, a21;
+    double b0, b1, b2, c;
+    double w;
+};
+
+void quadricFromPlane( Quadric & q, const vec3 & n, float d, float w )
+{
+    q.a00 = w * n.x * n.x; q.a11 = w * n.y * n.y; q.a22 = w * n.z * n.z;
+    q.a10 = w * n.y * n.x; q.a20 = w * n.z * n.x; q.a21 = w * n.z * n.y;
+    q.b0 = w * n.x * d; q.b1 = w * n.y * d; q.b2 = w * n.z * d;
+    q.c = w * d * d;
+    q.w = w;
+}
+
+void quadricAdd( Quadric & q, const Quadric & r )
+{
+    q.a00 += r.a00; q.a11 += r.a11; q.a22 += r.a22;
+    q.a10 += r.a10; q.a20 += r.a20; q.a21 += r.a21;
+    q.b0 += r.b0; q.b1 += r.b1; q.b2 += r.b2;
+    q.c += r.c;
+    q.w += r.w;
+}
+
+double quadricError( const Quadric & q, const vec3 & p )
+{
+    double x = p.x, y = p.y, z = p.z;
+    double e = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z +
+            2.0 * (q.a10 * x * y + q.a20 * x * z + q.a21 * y * z) +
+            2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    // Rounding can push an exact fit slightly negative
+    return (q.w > 0.0) ? fabs(e) / q.w : 0.0;
+}
+
+enum VertexKind { MANIFOLD, BORDER, LOCKED };
+
+struct Collapse
+{
+    unsigned int from;  // Vertex being removed
+    unsigned int to;    // Vertex it merges into
+    float error;
+};
+
+bool collapseBefore( const Collapse & a, const Collapse & b )
+{
+    return a.error < b.error;
+}
+
+// Open addressing set of directed edges with a use count per edge
+struct EdgeTable
+{
+    vector<unsigned long long> keys;
+    vector<unsigned int> counts;
+    size_t mask;
+
+    EdgeTable( size_t nEdges )
+    {
+        size_t size = 16;
+        while( size < nEdges * 2 ) size *= 2;
+        keys.assign(size, ~0ull);
+        counts.assign(size, 0);
+        mask = size - 1;
+    }
+
+    static unsigned long long key( unsigned int a, unsigned int b )
+    {
+        return ((unsigned long long)a << 32) | b;
+    }
+
+    size_t slot( unsigned long long k ) const
+    {
+        unsigned long long h = k * 0x9E3779B97F4A7C15ull;
+        size_t i = (size_t)(h >> 32) & mask;
+        while( keys[i] != ~0ull && keys[i] != k ) i = (i + 1) & mask;
+        return i;
+    }
+
+    void add( unsigned int a, unsigned int b )
+    {
+        size_t i = slot(key(a, b));
+        keys[i] = key(a, b);
+        counts[i]++;
+    }
+
+    unsigned int count( unsigned int a, unsigned int b ) const
+    {
+        return counts[slot(key(a, b))];
+    }
+};
+
+// Maps every vertex to the first vertex sharing its position, so that
+// attribute seams are treated as a single point of the surface.
+void positionRemap( vector<unsigned int> & remap, const float * verts, size_t stride, size_t nVerts )
+{
+    size_t size = 16;
+    while( size < nVerts * 2 ) size *= 2;
+    size_t mask = size - 1;
+    vector<unsigned int> table(size, ~0u);
+
+    remap.resize(nVerts);
+    for( size_t v = 0; v < nVerts; v++ ) {
+        const float * p = verts + v * stride;
+        unsigned int bits[3];
+        memcpy(bits, p, sizeof(bits));
+        unsigned int h = (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+        size_t i = h & mask;
+        while( table[i] != ~0u && memcmp(verts + table[i] * stride, p, sizeof(bits)) != 0 ) {
+            i = (i + 1) & mask;
+        }
+        if( table[i] == ~0u ) table[i] = (unsigned int)v;
+        remap[v] = table[i];
+    }
+}
+
+}
+
+size_t MeshOptimizer::simplify( unsigned int * destination, const unsigned int * indices, size_t nIndices,
+                                const float * verts, size_t stride, size_t nVerts,
+                                size_t targetIndexCount, float * resultError )
+{
+    // Boundary edges are held in place by a perpendicular plane weighted
+    // this much more than the faces
+    const float borderWeight = 10.0f;
+    const unsigned int none = ~0u;
+
+    vector<unsigned int> result(indices, indices + nIndices);
+    double maxError = 0.0;
+    size_t targetTris = targetIndexCount / 3;
+
+    vector<unsigned int> remap;
+    positionRemap(remap, verts, stride, nVerts);
+
+    // Vertices that share their position with another one sit on an
+    // attribute seam.  They are never removed, but may be collapsed onto.
+    vector<unsigned int> wedges(nVerts, 0);
+    for( size_t v = 0; v < nVerts; v++ ) wedges[remap[v]]++;
+
+    // Quadrics are accumulated per position from the original triangles,
+    // and keep accumulating across collapses so the error is always
+    // measured against the original surface.
+    vector<Quadric> quadrics(nVerts);
+    memset(&quadrics[0], 0, nVerts * sizeof(Quadric));
+
+    vector<unsigned char> kind(nVerts);
+    vector<unsigned int> borderNext(nVerts), borderPrev(nVerts);
+    vector<unsigned int> adjOffset(nVerts + 1), adjTris;
+    vector<unsigned int> target(nVerts);
+    vector<unsigned char> touched(nVerts);
+    vector<unsigned int> mark(nVerts, 0);
+    unsigned int markStamp = 0;
+    vector<Collapse> collapses;
+
+    for( bool first = true; result.size() / 3 > targetTris; first = false ) {
+        size_t nTris = result.size() / 3;
+
+        // Classify vertices by the edges around them
+        EdgeTable edges(result.size());
+        for( size_t i = 0; i < result.size(); i += 3 ) {
+            for( int k = 0; k < 3; k++ ) {
+                edges.add(remap[result[i + k]], remap[result[i + (k + 1) % 3]]);
+            }
+        }
+        for( size_t v = 0; v < nVerts; v++ ) {
+            kind[v] = (wedges[v] > 1) ? LOCKED : MANIFOLD;
+            borderNext[v] = borderPrev[v] = none;
+        }
+        for( size_t i = 0; i < result.size(); i += 3 ) {
+            for( int k = 0; k < 3; k++ ) {
+                unsigned int a = remap[result[i + k]];
+                unsigned int b = remap[result[i + (k + 1) % 3]];
+                if( edges.count(a, b) > 1 ) {
+                    // Non-manifold edge
+                    kind[a] = kind[b] = LOCKED;
+                } else if( edges.count(b, a) == 0 ) {
+                    // A second border edge through the same vertex makes it
+                    // a corner, which is kept
+                    if( borderNext[a] != none || borderPrev[b] != none ) {
+                        kind[a] = kind[b] = LOCKED;
+                    }
+                    borderNext[a] = b;
+                    borderPrev[b] = a;
+                    if( kind[a] == MANIFOLD ) kind[a] = BORDER;
+                    if( kind[b] == MANIFOLD ) kind[b] = BORDER;
+
+                    if( first ) {
+                        vec3 p0 = position(verts, stride, a);
+                        vec3 p1 = position(verts, stride, b);
+                        vec3 p2 = position(verts, stride, result[i + (k + 2) % 3]);
+                        vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                        vec3 plane = glm::cross(p1 - p0, normal);
+                        float len = glm::length(plane);
+                        if( len > 0.0f ) {
+                            plane /= len;
+                            float edgeLen = glm::length(p1 - p0);
+                            Quadric q;
+                            quadricFromPlane(q, plane, -glm::dot(plane, p0), borderWeight * edgeLen * edgeLen);
+                            quadricAdd(quadrics[a], q);
+                            quadricAdd(quadrics[b], q);
+                        }
+                    }
+                }
+            }
+        }
+        // A border vertex only has both neighbours if it wasn't a corner
+        for( size_t v = 0; v < nVerts; v++ ) {
+            if( kind[v] == BORDER && (borderNext[v] == none || borderPrev[v] == none) ) kind[v] = LOCKED;
+        }
+
+        if( first ) {
+            for( size_t i = 0; i < result.size(); i += 3 ) {
+                vec3 p0 = position(verts, stride, result[i]);
+                vec3 p1 = position(verts, stride, result[i + 1]);
+                vec3 p2 = position(verts, stride, result[i + 2]);
+                vec3 normal = glm::cross(p1 - p0, p2 - p0);
+                float len = glm::length(normal);
+                if( len == 0.0f ) continue;
+                normal /= len;
+                Quadric q;
+                quadricFromPlane(q, normal, -glm::dot(normal, p0), 0.5f * len);
+                for( int k = 0; k < 3; k++ ) quadricAdd(quadrics[remap[result[i + k]]], q);
+            }
+        }
+
+        // Position to triangle adjacency
+        std::fill(adjOffset.begin(), adjOffset.end(), 0);
+        for( size_t i = 0; i < result.size(); i++ ) adjOffset[remap[result[i]] + 1]++;
+        for( size_t v = 0; v < nVerts; v++ ) adjOffset[v + 1] += adjOffset[v];
+        adjTris.resize(result.size());
+        {
+            vector<unsigned int> fill(adjOffset.begin(), adjOffset.end() - 1);
+            for( size_t i = 0; i < result.size(); i++ ) {
+                adjTris[fill[remap[result[i]]]++] = (unsigned int)(i / 3);
+            }
+        }
+
+        // Cheapest allowed direction of every edge
+        collapses.clear();
+        for( size_t i = 0; i < result.size(); i += 3 ) {
+            for( int k = 0; k < 3; k++ ) {
+                unsigned int a = result[i + k], b = result[i + (k + 1) % 3];
+                unsigned int ra = remap[a], rb = remap[b];
+                if( ra == rb ) continue;
+
+                Quadric q = quadrics[ra];
+                quadricAdd(q, quadrics[rb]);
+
+                bool aToB = kind[ra] == MANIFOLD ||
+                        (kind[ra] == BORDER && (borderNext[ra] == rb || borderPrev[ra] == rb));
+                bool bToA = kind[rb] == MANIFOLD ||
+                        (kind[rb] == BORDER && (borderNext[rb] == ra || borderPrev[rb] == ra));
+                if( !aToB && !bToA ) continue;
+
+                Collapse c;
+                float errorAB = aToB ? (float)quadricError(q, position(verts, stride, b)) : 0.0f;
+                float errorBA = bToA ? (float)quadricError(q, position(verts, stride, a)) : 0.0f;
+                if( aToB && (!bToA || errorAB <= errorBA) ) {
+                    c.from = a; c.to = b; c.error = errorAB;
+                } else {
+                    c.from = b; c.to = a; c.error = errorBA;
+                }
+                collapses.push_back(c);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), collapseBefore);
+
+        // Apply collapses cheapest first.  Each one locks the neighbourhood
+        // of the removed vertex for the rest of the pass, so that the
+        // geometric checks below always see up to date triangles.
+        std::fill(target.begin(), target.end(), none);
+        std::fill(touched.begin(), touched.end(), 0);
+        size_t applied = 0;
+        for( size_t c = 0; c < collapses.size() && nTris > targetTris; c++ ) {
+            unsigned int u = collapses[c].from, v = collapses[c].to;
+            unsigned int ru = remap[u], rv = remap[v];
+            if( touched[ru] || touched[rv] ) continue;
+
+            vec3 pv = position(verts, stride, v);
+            unsigned int removed = 0;
+            bool valid = true;
+            markStamp++;
+            for( unsigned int j = adjOffset[ru]; j < adjOffset[ru + 1] && valid; j++ ) {
+                const unsigned int * tri = &result[adjTris[j] * 3];
+                unsigned int r[3] = { remap[tri[0]], remap[tri[1]], remap[tri[2]] };
+                for( int k = 0; k < 3; k++ ) mark[r[k]] = markStamp;
+                if( r[0] == rv || r[1] == rv || r[2] == rv ) {
+                    removed++;
+                    continue;
+                }
+
+                // Reject collapses that flip a surviving triangle over
+                vec3 p[3], moved[3];
+                for( int k = 0; k < 3; k++ ) {
+                    p[k] = position(verts, stride, tri[k]);
+                    moved[k] = (r[k] == ru) ? pv : p[k];
+                }
+                vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                vec3 after = glm::cross(moved[1] - moved[0], moved[2] - moved[0]);
+                if( glm::dot(before, after) <= 0.0f ) valid = false;
+            }
+            if( !valid ) continue;
+
+            // Link condition: the only vertices adjacent to both ends are
+            // the apexes of the triangles on the edge, otherwise the
+            // collapse would pinch the surface into a non-manifold fan
+            unsigned int shared = 0;
+            mark[ru] = mark[rv] = 0;
+            for( unsigned int j = adjOffset[rv]; j < adjOffset[rv + 1]; j++ ) {
+                const unsigned int * tri = &result[adjTris[j] * 3];
+                for( int k = 0; k < 3; k++ ) {
+                    unsigned int r = remap[tri[k]];
+                    if( mark[r] == markStamp ) {
+                        shared++;
+                        mark[r] = 0;
+                    }
+                }
+            }
+            if( shared != removed ) continue;
+
+            target[ru] = v;
+            for( unsigned int j = adjOffset[ru]; j < adjOffset[ru + 1]; j++ ) {
+                const unsigned int * tri = &result[adjTris[j] * 3];
+                for( int k = 0; k < 3; k++ ) touched[remap[tri[k]]] = 1;
+            }
+            quadricAdd(quadrics[rv], quadrics[ru]);
+            maxError = std::max(maxError, (double)collapses[c].error);
+            nTris -= removed;
+            applied++;
+        }
+        if( applied == 0 ) break;
+
+        // Rewrite the index buffer, dropping the triangles that collapsed
+        size_t out = 0;
+        for( size_t i = 0; i < result.size(); i += 3 ) {
+            unsigned int tri[3];
+            for( int k = 0; k < 3; k++ ) {
+                unsigned int t = target[remap[result[i + k]]];
+                tri[k] = (t != none) ? t : result[i + k];
+            }
+            if( remap[tri[0]] == remap[tri[1]] || remap[tri[1]] == remap[tri[2]] ||
+                    remap[tri[2]] == remap[tri[0]] ) {
+                continue;
+            }
+            for( int k = 0; k < 3; k++ ) result[out++] = tri[k];
+        }
+        result.resize(out);
+    }
+
+    if( !result.empty() ) memcpy(destination, &result[0], result.size() * sizeof(unsigned int));
+    if( resultError ) *resultError = (float)sqrt(maxError);
+    return result.size();
+}
@@ -0,0 +1,516 @@
+#include "objparser.h"
+#include "mappedfile.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <fstream>
+using std::ifstream;
+#include <sstream>
+using std::istringstream;
+#include <string>
+using std::string;
+#include <thread>
+#include <atomic>
+
+void ObjData::clear()
+{
+    points.clear();
+    normals.clear();
+    texCoords.clear();
+    faces.clear();
+    faceTexCoords.clear();
+    faceNormals.clear();
+    nFaces = 0;
+}
+
+bool ObjData::needsWelding() const
+{
+    for( size_t i = 0; i < faces.size(); i++ ) {
+        if( faceTexCoords[i] != -1 && faceTexCoords[i] != faces[i] ) return true;
+        if( faceNormals[i] != -1 && faceNormals[i] != faces[i] ) return true;
+    }
+    return false;
+}
+
+namespace {
+
+struct WeldKey
+{
+    int p, t, n;
+};
+
+inline unsigned int hashKey( const WeldKey & k )
+{
+    unsigned int h = (unsigned int)k.p * 73856093u;
+    h ^= (unsigned int)k.t * 19349663u;
+    h ^= (unsigned int)k.n * 83492791u;
+    return h ^ (h >> 16);
+}
+
+}
+
+size_t ObjData::weld()
+{
+    int nPoints = (int)points.size();
+    int nTexCoords = (int)texCoords.size();
+    int nNormals = (int)normals.size();
+
+    // Open addressing table of unique vertex ids, at most half full
+    size_t capacity = 16;
+    while( capacity < faces.size() * 2 ) capacity *= 2;
+    size_t mask = capacity - 1;
+    vector<int> table(capacity, -1);
+    vector<WeldKey> keys;
+    keys.reserve(faces.size() / 2 + 1);
+
+    for( size_t i = 0; i < faces.size(); i++ ) {
+        WeldKey k;
+        k.p = faces[i];
+        k.t = faceTexCoords[i];
+        k.n = faceNormals[i];
+        // Out of range attribute indices are treated as missing
+        if( k.t < -1 || k.t >= nTexCoords ) k.t = -1;
+        if( k.n < -1 || k.n >= nNormals ) k.n = -1;
+
+        size_t slot = hashKey(k) & mask;
+        int id;
+        for( ;; ) {
+            id = table[slot];
+            if( id == -1 ) {
+                id = (int)keys.size();
+                table[slot] = id;
+                keys.push_back(k);
+                break;
+            }
+            const WeldKey & other = keys[id];
+            if( other.p == k.p && other.t == k.t && other.n == k.n ) break;
+            slot = (slot + 1) & mask;
+        }
+        faces[i] = id;
+    }
+
+    // Gather the attribute streams for the unique vertices
+    vector<vec3> weldedPoints(keys.size());
+    vector<vec3> weldedNormals(nNormals > 0 ? keys.size() : 0);
+    vector<vec2> weldedTexCoords(nTexCoords > 0 ? keys.size() : 0);
+    for( size_t v = 0; v < keys.size(); v++ ) {
+        const WeldKey & k = keys[v];
+        weldedPoints[v] = (k.p >= 0 && k.p < nPoints) ? points[k.p] : vec3(0.0f);
+        if( nNormals > 0 ) weldedNormals[v] = (k.n >= 0) ? normals[k.n] : vec3(0.0f);
+        if( nTexCoords > 0 ) weldedTexCoords[v] = (k.t >= 0) ? texCoords[k.t] : vec2(0.0f);
+    }
+
+    points.swap(weldedPoints);
+    normals.swap(weldedNormals);
+    texCoords.swap(weldedTexCoords);
+    faceTexCoords = faces;
+    faceNormals = faces;
+    return keys.size();
+}
+
+namespace {
+
+// Exactly representable powers of ten.  Dividing or multiplying a mantissa
+// below 2^53 by one of these gives a correctly rounded double.
+const double powersOfTen[] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+inline bool isDigit( char c ) { return c >= '0' && c <= '9'; }
+inline bool isSpace( char c ) { return c == ' ' || c == '\t' || c == '\r'; }
+
+inline const char * skipSpace( const char * p, const char * end )
+{
+    while( p < end && isSpace(*p) ) ++p;
+    return p;
+}
+
+inline const char * skipToken( const char * p, const char * end )
+{
+    while( p < end && !isSpace(*p) ) ++p;
+    return p;
+}
+
+// Scans a decimal floating point number (with optional exponent) starting
+// at p.  Returns the first character past the number.
+const char * scanFloat( const char * p, const char * end, float & result )
+{
+    bool negative = false;
+    if( p < end && (*p == '-' || *p == '+') ) {
+        negative = (*p == '-');
+        ++p;
+    }
+
+    unsigned long long mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+
+    for( ; p < end && isDigit(*p); ++p ) {
+        if( significant < 19 ) {
+            mantissa = mantissa * 10 + (*p - '0');
+            if( mantissa != 0 ) significant++;
+        } else {
+            exponent++;
+        }
+    }
+    if( p < end && *p == '.' ) {
+        ++p;
+        for( ; p < end && isDigit(*p); ++p ) {
+            if( significant < 19 ) {
+                mantissa = mantissa * 10 + (*p - '0');
+                if( mantissa != 0 ) significant++;
+                exponent--;
+            }
+        }
+    }
+    if( p < end && (*p == 'e' || *p == 'E') ) {
+        const char * q = p + 1;
+        bool negExp = false;
+        if( q < end && (*q == '-' || *q == '+') ) {
+            negExp = (*q == '-');
+            ++q;
+        }
+        if( q < end && isDigit(*q) ) {
+            int e = 0;
+            for( ; q < end && isDigit(*q); ++q ) {
+                if( e < 10000 ) e = e * 10 + (*q - '0');
+            }
+            exponent += negExp ? -e : e;
+            p = q;
+        }
+    }
+
+    double value = (double)mantissa;
+    if( exponent < 0 ) {
+        if( exponent >= -22 ) value /= powersOfTen[-exponent];
+        else value /= pow(10.0, -exponent);
+    } else if( exponent > 0 ) {
+        if( exponent <= 22 ) value *= powersOfTen[exponent];
+        else value *= pow(10.0, exponent);
+    }
+    result = (float)(negative ? -value : value);
+    return p;
+}
+
+// Same semantics as atoi: optional sign followed by digits.
+const char * scanInt( const char * p, const char * end, int & result )
+{
+    bool negative = false;
+    if( p < end && (*p == '-' || *p == '+') ) {
+        negative = (*p == '-');
+        ++p;
+    }
+    int value = 0;
+    for( ; p < end && isDigit(*p); ++p ) {
+        value = value * 10 + (*p - '0');
+    }
+    result = negative ? -value : value;
+    return p;
+}
+
+// Parses one face vertex of the form p, p/t, p//n or p/t/n.  Indices are
+// converted to zero based; missing ones are left at -1.
+const char * scanFaceVertex( const char * p, const char * end,
+                             int & pIndex, int & tcIndex, int & nIndex )
+{
+    pIndex = tcIndex = nIndex = -1;
+    p = scanInt(p, end, pIndex);
+    pIndex -= 1;
+    if( p < end && *p == '/' ) {
+        ++p;
+        if( p < end && *p != '/' ) {
+            p = scanInt(p, end, tcIndex);
+            tcIndex -= 1;
+        }
+        if( p < end && *p == '/' ) {
+            ++p;
+            p = scanInt(p, end, nIndex);
+            nIndex -= 1;
+        }
+    }
+    return skipToken(p, end);
+}
+
+void parseLine( const char * p, const char * end, ObjData & obj )
+{
+    p = skipSpace(p, end);
+    if( p == end || *p == '#' ) return;
+
+    const char * tokenEnd = skipToken(p, end);
+    size_t tokenLen = tokenEnd - p;
+
+    if( tokenLen == 1 && p[0] == 'v' ) {
+        vec3 v;
+        p = scanFloat(skipSpace(tokenEnd, end), end, v.x);
+        p = scanFloat(skipSpace(p, end), end, v.y);
+        p = scanFloat(skipSpace(p, end), end, v.z);
+        obj.points.push_back(v);
+    } else if( tokenLen == 2 && p[0] == 'v' && p[1] == 't' ) {
+        vec2 tc;
+        p = scanFloat(skipSpace(tokenEnd, end), end, tc.x);
+        p = scanFloat(skipSpace(p, end), end, tc.y);
+        obj.texCoords.push_back(tc);
+    } else if( tokenLen == 2 && p[0] == 'v' && p[1] == 'n' ) {
+        vec3 n;
+        p = scanFloat(skipSpace(tokenEnd, end), end, n.x);
+        p = scanFloat(skipSpace(p, end), end, n.y);
+        p = scanFloat(skipSpace(p, end), end, n.z);
+        obj.normals.push_back(n);
+    } else if( tokenLen == 1 && p[0] == 'f' ) {
+        obj.nFaces++;
+
+        int face[3][3];
+        int count = 0;
+        p = skipSpace(tokenEnd, end);
+        while( p < end ) {
+            int pIndex, tcIndex, nIndex;
+            p = scanFaceVertex(p, end, pIndex, tcIndex, nIndex);
+            p = skipSpace(p, end);
+
+            if( pIndex == -1 ) {
+                printf("Missing point index!!!");
+            } else {
+                if( count < 3 ) {
+                    face[count][0] = pIndex;
+                    face[count][1] = tcIndex;
+                    face[count][2] = nIndex;
+                }
+                count++;
+            }
+        }
+        if( count != 3 ) {
+            printf("Found non-triangular face.\n");
+        } else {
+            for( int i = 0; i < 3; i++ ) {
+                obj.faces.push_back(face[i][0]);
+                obj.faceTexCoords.push_back(face[i][1]);
+                obj.faceNormals.push_back(face[i][2]);
+            }
+        }
+    }
+}
+
+void trimString( string & str )
+{
+    const char * whiteSpace = " \t\n\r";
+    size_t location;
+    location = str.find_first_not_of(whiteSpace);
+    str.erase(0,location);
+    location = str.find_last_not_of(whiteSpace);
+    str.erase(location + 1);
+}
+
+// Chunks smaller than this are not worth a thread
+const size_t minChunkSize = 256 * 1024;
+
+struct ObjChunk
+{
+    const char * begin;
+    const char * end;
+    ObjData data;
+};
+
+template <typename T>
+void append( vector<T> & dst, const vector<T> & src )
+{
+    dst.insert(dst.end(), src.begin(), src.end());
+}
+
+} // namespace
+
+bool ObjParser::parseFile( const char * fileName, ObjData & obj, int nThreads )
+{
+    MappedFile file;
+    if( ! file.open(fileName) ) {
+        return parseStream(fileName, obj);
+    }
+
+    if( nThreads == 1 ) {
+        parseBuffer(file.data(), file.data() + file.size(), obj);
+    } else {
+        parseBufferParallel(file.data(), file.data() + file.size(), obj, nThreads);
+    }
+    return true;
+}
+
+void ObjParser::parseBuffer( const char * begin, const char * end, ObjData & obj )
+{
+    const char * p = begin;
+    while( p < end ) {
+        const char * eol = (const char *)memchr(p, '\n', end - p);
+        if( eol == NULL ) eol = end;
+        parseLine(p, eol, obj);
+        p = eol + 1;
+    }
+}
+
+void ObjParser::parseBufferParallel( const char * begin, const char * end,
+                                     ObjData & obj, int nThreads )
+{
+    if( nThreads <= 0 ) nThreads = (int)std::thread::hardware_concurrency();
+    if( nThreads <= 0 ) nThreads = 1;
+
+    // A few chunks per thread so that uneven line lengths balance out
+    size_t size = end - begin;
+    size_t nChunks = (size_t)nThreads * 4;
+    if( size / minChunkSize < nChunks ) nChunks = size / minChunkSize;
+
+    if( nThreads == 1 || nChunks <= 1 ) {
+        parseBuffer(begin, end, obj);
+        return;
+    }
+
+    // Cut at the first newline after each evenly spaced split point
+    vector<ObjChunk> chunks(nChunks);
+    const char * p = begin;
+    for( size_t i = 0; i < nChunks; i++ ) {
+        const char * cut = end;
+        if( i < nChunks - 1 ) {
+            cut = begin + size * (i + 1) / nChunks;
+            if( cut < p ) {
+                cut = p;
+            } else {
+                const char * eol = (const char *)memchr(cut, '\n', end - cut);
+                cut = (eol == NULL) ? end : eol + 1;
+            }
+        }
+        chunks[i].begin = p;
+        chunks[i].end = cut;
+        p = cut;
+    }
+
+    std::atomic<int> nextChunk(0);
+    auto worker = [&]() {
+        int i;
+        while( (i = nextChunk++) < (int)nChunks ) {
+            parseBuffer(chunks[i].begin, chunks[i].end, chunks[i].data);
+        }
+    };
+
+    vector<std::thread> threads;
+    for( int t = 1; t < nThreads; t++ ) {
+        threads.push_back(std::thread(worker));
+    }
+    worker();
+    for( size_t t = 0; t < threads.size(); t++ ) {
+        threads[t].join();
+    }
+
+    // Merge in file order
+    size_t nPoints = obj.points.size(), nNormals = obj.normals.size();
+    size_t nTexCoords = obj.texCoords.size(), nElements = obj.faces.size();
+    for( size_t i = 0; i < nChunks; i++ ) {
+        nPoints += chunks[i].data.points.size();
+        nNormals += chunks[i].data.normals.size();
+        nTexCoords += chunks[i].data.texCoords.size();
+        nElements += chunks[i].data.faces.size();
+    }
+    obj.points.reserve(nPoints);
+    obj.normals.reserve(nNormals);
+    obj.texCoords.reserve(nTexCoords);
+    obj.faces.reserve(nElements);
+    obj.faceTexCoords.reserve(nElements);
+    obj.faceNormals.reserve(nElements);
+
+    for( size_t i = 0; i < nChunks; i++ ) {
+        ObjData & data = chunks[i].data;
+        append(obj.points, data.points);
+        append(obj.normals, data.normals);
+        append(obj.texCoords, data.texCoords);
+        append(obj.faces, data.faces);
+        append(obj.faceTexCoords, data.faceTexCoords);
+        append(obj.faceNormals, data.faceNormals);
+        obj.nFaces += data.nFaces;
+        data.clear();
+    }
+}
+
+bool ObjParser::parseStream( const char * fileName, ObjData & obj )
+{
+    ifstream objStream( fileName, std::ios::in );
+
+    if( !objStream ) {
+        return false;
+    }
+
+    string line, token;
+    vector<int> face, faceTc, faceN;
+
+    getline( objStream, line );
+    while( !objStream.eof() ) {
+        trimString(line);
+        if( line.length( ) > 0 && line.at(0) != '#' ) {
+            istringstream lineStream( line );
+
+            lineStream >> token;
+
+            if (token == "v" ) {
+                float x, y, z;
+                lineStream >> x >> y >> z;
+                obj.points.push_back( vec3(x,y,z) );
+            } else if (token == "vt" ) {
+                // Process texture coordinate
+                float s,t;
+                lineStream >> s >> t;
+                obj.texCoords.push_back( vec2(s,t) );
+            } else if (token == "vn" ) {
+                float x, y, z;
+                lineStream >> x >> y >> z;
+                obj.normals.push_back( vec3(x,y,z) );
+            } else if (token == "f" ) {
+                obj.nFaces++;
+
+                // Process face
+                face.clear();
+                faceTc.clear();
+                faceN.clear();
+                size_t slash1, slash2;
+                while( lineStream.good() ) {
+                    string vertString;
+                    lineStream >> vertString;
+                    int pIndex = -1, nIndex = -1 , tcIndex = -1;
+
+                    slash1 = vertString.find("/");
+                    if( slash1 == string::npos ){
+                        pIndex = atoi( vertString.c_str() ) - 1;
+                    } else {
+                        slash2 = vertString.find("/", slash1 + 1 );
+                        pIndex = atoi( vertString.substr(0,slash1).c_str() )
+                                        - 1;
+                        if( slash2 > slash1 + 1 ) {
+                                tcIndex =
+                                        atoi( vertString.substr(slash1 + 1, slash2).c_str() )
+                                        - 1;
+                        }
+                        if( slash2 != string::npos ) {
+                                nIndex =
+                                        atoi( vertString.substr(slash2 + 1,vertString.length()).c_str() )
+                                        - 1;
+                        }
+                    }
+                    if( pIndex == -1 ) {
+                        printf("Missing point index!!!");
+                    } else {
+                        face.push_back(pIndex);
+                        faceTc.push_back(tcIndex);
+                        faceN.push_back(nIndex);
+                    }
+                }
+                if( face.size() != 3 ) {
+                    printf("Found non-triangular face.\n");
+                } else {
+                    obj.faces.insert(obj.faces.end(), face.begin(), face.end());
+                    obj.faceTexCoords.insert(obj.faceTexCoords.end(), faceTc.begin(), faceTc.end());
+                    obj.faceNormals.insert(obj.faceNormals.end(), faceN.begin(), faceN.end());
+                }
+            }
+        }
+        getline( objStream, line );
+    }
+
+    objStream.close();
+    return true;
+}
@@ -0,0 +1,55 @@
+#include "pendingmesh.h"
+
+#include <chrono>
+
+namespace {
+
+bool loadInBackground( const string * fileName, const VBOMesh::Options * options,
+                       VBOMesh::UploadData * data )
+{
+    return VBOMesh::loadVertexData(fileName->c_str(), *options, *data);
+}
+
+}
+
+PendingMesh::PendingMesh( const char * name, const VBOMesh::Options & loadOptions ) :
+    fileName(name), options(loadOptions), finished(false), succeeded(false)
+{
+    result = std::async(std::launch::async, loadInBackground, &fileName, &options, &loaded);
+}
+
+PendingMesh::~PendingMesh()
+{
+    if( result.valid() ) result.wait();
+}
+
+void PendingMesh::collect()
+{
+    if( ! finished ) {
+        succeeded = result.get();
+        finished = true;
+    }
+}
+
+bool PendingMesh::ready()
+{
+    if( ! finished && result.wait_for(std::chrono::seconds(0)) == std::future_status::ready ) {
+        collect();
+    }
+    return finished;
+}
+
+bool PendingMesh::wait()
+{
+    collect();
+    return succeeded;
+}
+
+VBOMesh * PendingMesh::upload()
+{
+    if( ! ready() || ! succeeded || loaded.data.vertexCount() == 0 ) return NULL;
+
+    VBOMesh * mesh = new VBOMesh(loaded);
+    loaded.clear();
+    return mesh;
+}
@@ -1,11 +1,16 @@
 #include "vbocube.h"
 #include "defines.h"
-#include <GL/glew.h>
-#include "glutils.h"
 
 #include <cstdio>
 
-VBOCube::VBOCube()
+VBOCube::VBOCube(VertexLayout layout, VertexCompression compression)
+{
+    MeshData data;
+    generate(data);
+    upload(data, layout, compression);
+}
+
+void VBOCube::generate(MeshData & data)
 {
     float side = 1.0f;
     float side2 = side / 2.0f;
@@ -109,7 +114,7 @@ VBOCube::VBOCube()
         0.0f, 1.0f
     };
 
-    GLuint el[] = {
+    unsigned int el[] = {
         0,1,2,0,2,3,
         4,5,6,4,6,7,
         8,9,10,8,10,11,
@@ -118,34 +123,10 @@ VBOCube::VBOCube()
         20,21,22,20,22,23
     };
 
-    glGenVertexArrays( 1, &vaoHandle );
-    glBindVertexArray(vaoHandle);
-
-    unsigned int handle[4];
-    glGenBuffers(4, handle);
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[0]);
-    glBufferData(GL_ARRAY_BUFFER, 24 * 3 * sizeof(float), v, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)0, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(0);  // Vertex position
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
-    glBufferData(GL_ARRAY_BUFFER, 24 * 3 * sizeof(float), n, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)1, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(1);  // Vertex normal
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[2]);
-    glBufferData(GL_ARRAY_BUFFER, 24 * 2 * sizeof(float), tex, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)2, 2, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(2);  // texture coords
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle[3]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 36 * sizeof(GLuint), el, GL_STATIC_DRAW);
-
-    glBindVertexArray(0);
-}
-
-void VBOCube::render() const {
-    glBindVertexArray(vaoHandle);
-    glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, ((GLubyte *)NULL + (0)));
+    data.positions.assign(v, v + 24*3);
+    data.normals.assign(n, n + 24*3);
+    data.texCoords.assign(tex, tex + 24*2);
+    data.tangents.clear();
+    data.indices.assign(el, el + 36);
+    data.computeBounds();
 }
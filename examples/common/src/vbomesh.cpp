@@ -3,139 +3,462 @@
 using std::cout;
 using std::cerr;
 using std::endl;
-#include <fstream>
-using std::ifstream;
-#include <sstream>
-using std::istringstream;
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+#include "objparser.h"
+#include "meshoptimizer.h"
+#include "float4.h"
 
 #include <GL/glew.h>
+#include "glutils.h"
+
+#include <thread>
+
+namespace {
+
+// Threads worth using for nFaces faces (nThreads 0 = one per hardware thread)
+int threadCount( int nThreads, size_t nFaces )
+{
+    const size_t minFacesPerThread = 16 * 1024;
+    if( nThreads <= 0 ) nThreads = (int)std::thread::hardware_concurrency();
+    if( (size_t)nThreads > nFaces / minFacesPerThread ) nThreads = (int)(nFaces / minFacesPerThread);
+    return nThreads < 1 ? 1 : nThreads;
+}
+
+// The parallel normal and tangent passes work on four faces, or four
+// vertices, at a time: the vectors are gathered into one Float4 per
+// component, computed on, and the results scattered back.  Each lane does
+// the same operations in the same order as the glm code of the serial
+// versions, and the sums are added in the same order, so with one thread
+// the results are exactly the serial ones.
+
+// Four vectors, one Float4 per component
+struct Float4x3
+{
+    Float4 x, y, z;
+};
+
+inline Float4x3 operator+( const Float4x3 & a, const Float4x3 & b )
+{
+    Float4x3 r = { a.x + b.x, a.y + b.y, a.z + b.z };
+    return r;
+}
+
+inline Float4x3 operator-( const Float4x3 & a, const Float4x3 & b )
+{
+    Float4x3 r = { a.x - b.x, a.y - b.y, a.z - b.z };
+    return r;
+}
+
+inline Float4x3 operator*( const Float4x3 & a, Float4 s )
+{
+    Float4x3 r = { a.x * s, a.y * s, a.z * s };
+    return r;
+}
+
+// glm::cross
+inline Float4x3 cross4( const Float4x3 & a, const Float4x3 & b )
+{
+    Float4x3 r = { a.y * b.z - b.y * a.z, a.z * b.x - b.z * a.x, a.x * b.y - b.x * a.y };
+    return r;
+}
+
+inline Float4 dot4( const Float4x3 & a, const Float4x3 & b )
+{
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+// glm::normalize
+inline Float4x3 normalize4( const Float4x3 & v )
+{
+    return v * (splat4(1.0f) / sqrt4(dot4(v, v)));
+}
+
+// One corner of four faces: v[corner[0]], v[corner[3]], v[corner[6]] and
+// v[corner[9]]
+inline Float4x3 gatherCorner( const vec3 * v, const int * corner )
+{
+    Float4x3 r;
+    transpose3(&v[corner[0]].x, &v[corner[3]].x, &v[corner[6]].x, &v[corner[9]].x, r.x, r.y, r.z);
+    return r;
+}
 
+inline void gatherCorner( const vec2 * v, const int * corner, Float4 & x, Float4 & y )
+{
+    transpose2(&v[corner[0]].x, &v[corner[3]].x, &v[corner[6]].x, &v[corner[9]].x, x, y);
+}
+
+// lanes consecutive vectors, the last repeated to fill four
+inline Float4x3 gatherRun( const vec3 * v, int lanes )
+{
+    Float4x3 r;
+    transpose3(&v[0].x, &v[std::min(1, lanes - 1)].x, &v[std::min(2, lanes - 1)].x,
+               &v[lanes - 1].x, r.x, r.y, r.z);
+    return r;
+}
 
-VBOMesh::VBOMesh(const char * fileName, bool center)
+// The same from an accumulator padded to four floats per vertex
+inline Float4x3 gatherRun( const float * accum, int lanes )
+{
+    Float4 a = load4(accum), b = load4(accum + 4 * std::min(1, lanes - 1));
+    Float4 c = load4(accum + 4 * std::min(2, lanes - 1)), d = load4(accum + 4 * (lanes - 1));
+    transpose4(a, b, c, d);
+    Float4x3 r = { a, b, c };
+    return r;
+}
+
+// The indices of the group of faces at face, the last face of a short
+// group repeated to fill four
+inline const int * faceGroup( const int * face, int lanes, int * padded )
+{
+    if( lanes == 4 ) return face;
+    for( int i = 0; i < 12; i++ ) padded[i] = face[std::min(i / 3, lanes - 1) * 3 + i % 3];
+    return padded;
+}
+
+// Adds v to the padded accumulators of the three corners of a face
+inline void addToCorners( const int * face, Float4 v, float * accum )
+{
+    float * a = accum + 4 * face[0], * b = accum + 4 * face[1], * c = accum + 4 * face[2];
+    store4(a, load4(a) + v);
+    store4(b, load4(b) + v);
+    store4(c, load4(c) + v);
+}
+
+// Adds each of the first lanes vectors of v to the corners of its face,
+// in the order the serial loops do
+inline void scatterAdd( const Float4x3 & v, const int * face, int lanes, float * accum )
+{
+    Float4 a = v.x, b = v.y, c = v.z, d = splat4(0.0f);
+    transpose4(a, b, c, d);
+    addToCorners(face, a, accum);
+    if( lanes > 1 ) addToCorners(face + 3, b, accum);
+    if( lanes > 2 ) addToCorners(face + 6, c, accum);
+    if( lanes > 3 ) addToCorners(face + 9, d, accum);
+}
+
+// Unit normals of four faces, zero where a face has no area
+inline Float4x3 faceNormals4( const Float4x3 & p1, const Float4x3 & p2, const Float4x3 & p3 )
+{
+    Float4x3 n = cross4(p2 - p1, p3 - p1);
+    Float4 zero = splat4(0.0f), length2 = dot4(n, n);
+    return n * select4(equal4(length2, zero), zero, splat4(1.0f) / sqrt4(length2));
+}
+
+// The texture space directions of four faces, from their corners' positions
+// and texture coordinates (u, v), zero where the mapping is degenerate
+inline void faceTangents4( const Float4x3 & p1, const Float4x3 & p2, const Float4x3 & p3,
+                           Float4 u1, Float4 v1, Float4 u2, Float4 v2, Float4 u3, Float4 v3,
+                           Float4x3 & tan1, Float4x3 & tan2 )
+{
+    Float4 s1 = u2 - u1, s2 = u3 - u1;
+    Float4 t1 = v2 - v1, t2 = v3 - v1;
+    Float4 det = s1 * t2 - s2 * t1;
+    Float4 zero = splat4(0.0f);
+    Float4 r = select4(equal4(det, zero), zero, splat4(1.0f) / det);
+
+    Float4x3 q1 = p2 - p1, q2 = p3 - p1;
+    tan1.x = (t2 * q1.x - t1 * q2.x) * r;
+    tan1.y = (t2 * q1.y - t1 * q2.y) * r;
+    tan1.z = (t2 * q1.z - t1 * q2.z) * r;
+    tan2.x = (s1 * q2.x - s2 * q1.x) * r;
+    tan2.y = (s1 * q2.y - s2 * q1.y) * r;
+    tan2.z = (s1 * q2.z - s2 * q1.z) * r;
+}
+
+// The attributes of cached, interleaved data: position, normal, then
+// optionally the texture coordinate and tangent.  Returns how many.
+int meshAttributes( const MeshCache & data, Drawable::VertexAttribute * attributes )
+{
+    const float * v = data.vertices();
+    int stride = (int)data.stride();
+    Drawable::VertexAttribute all[] = {
+        { 0, 3, v, stride, Drawable::POSITION },        // Vertex position
+        { 1, 3, v + 3, stride, Drawable::DIRECTION },   // Vertex normal
+        { 2, 2, v + 6, stride, Drawable::TEXCOORD },    // Texture coords
+        { 3, 4, v + 8, stride, Drawable::DIRECTION }    // Tangent vector
+    };
+    int nAttributes = (data.attributes() & MeshCache::TANGENT) ? 4 : 2;
+    for( int a = 0; a < nAttributes; a++ ) attributes[a] = all[a];
+    return nAttributes;
+}
+
+// Runs work(t) for t in [0, nThreads), t = 0 on the calling thread
+template <typename F>
+void parallelRun( int nThreads, F work )
+{
+    vector<std::thread> threads;
+    for( int t = 1; t < nThreads; t++ ) {
+        threads.push_back(std::thread(work, t));
+    }
+    work(0);
+    for( size_t t = 0; t < threads.size(); t++ ) {
+        threads[t].join();
+    }
+}
+
+}
+
+
+VBOMesh::VBOMesh(const char * fileName, bool center) : cullHandle(0)
 {
     loadOBJ(fileName, center);
 }
 
+VBOMesh::VBOMesh(const char * fileName, const Options & options) : cullHandle(0)
+{
+    loadOBJ(fileName, options);
+}
+
+VBOMesh::VBOMesh(UploadData & upload) : cullHandle(0)
+{
+    storeVBO(upload);
+}
+
+VBOMesh::~VBOMesh()
+{
+    if( cullHandle != 0 ) glDeleteBuffers(1, &cullHandle);
+}
+
 void VBOMesh::render() const {
+    render(0);
+}
+
+void VBOMesh::renderInstanced( int count ) const {
     glBindVertexArray(vaoHandle);
-    glDrawElements(GL_TRIANGLES, 3 * faces, GL_UNSIGNED_INT, ((GLubyte *)NULL + (0)));
+    glDrawElementsInstanced(GL_TRIANGLES, lodCount[0], indexType,
+                            ((GLubyte *)NULL + indexOffset + lodFirst[0] * GLUtils::indexTypeSize(indexType)),
+                            count);
 }
 
-void VBOMesh::loadOBJ( const char * fileName, bool reCenterMesh ) {
+void VBOMesh::render( int lod ) const {
+    if( lod < 0 ) lod = 0;
+    if( lod >= (int)nLods ) lod = (int)nLods - 1;
+    glBindVertexArray(vaoHandle);
+    glDrawElements(GL_TRIANGLES, lodCount[lod], indexType,
+                   ((GLubyte *)NULL + indexOffset + lodFirst[lod] * GLUtils::indexTypeSize(indexType)));
+}
+
+unsigned int VBOMesh::renderCulled( const mat4 & mvp, const vec4 & camera,
+                                    Meshlets::CullStats * stats ) {
+    if( cullHandle == 0 ) {
+        render(0);
+        return lodCount[0] / 3;
+    }
+
+    meshlets.cull(mvp, camera, visibleIndices, stats);
+    GLsizei count = (GLsizei)visibleIndices.size();
+
+    // Swap the culled indices in for this draw only; the element buffer
+    // binding is part of the VAO
+    glBindVertexArray(vaoHandle);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, cullHandle);
+    if( count > 0 ) {
+        GLUtils::bufferElementData(&visibleIndices[0], count, vertexCount, GL_STREAM_DRAW);
+        glDrawElements(GL_TRIANGLES, count, indexType, ((GLubyte *)NULL + (0)));
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexHandle);
+    glBindVertexArray(0);
+    return count / 3;
+}
 
-    vector <vec3> points;
-    vector <vec3> normals;
-    vector <vec2> texCoords;
-    vector <int> faces;
+int VBOMesh::selectLod( float pixelsPerUnit, float maxPixelError ) const {
+    int lod = 0;
+    for( unsigned int l = 1; l < nLods; l++ ) {
+        if( lodError[l] * pixelsPerUnit <= maxPixelError ) lod = (int)l;
+    }
+    return lod;
+}
+
+void VBOMesh::loadOBJ( const char * fileName, bool reCenterMesh ) {
+    Options options;
+    options.reCenterMesh = reCenterMesh;
+    loadOBJ(fileName, options);
+}
 
-    int nFaces = 0;
+unsigned long long VBOMesh::Options::cacheFlags() const {
+    unsigned long long flags = 0;
+    if( reCenterMesh ) flags |= 1;
+    if( optimizeVertexCache ) flags |= 2;
+    if( optimizeVertexFetch ) flags |= 8;
+    // loadVertexData builds no more levels than the cache has room for
+    int levels = std::max(0, std::min(lodLevels, (int)MeshCache::MAX_LODS - 1));
+    flags |= (unsigned long long)levels << 8;
+    if( optimizeOverdraw ) {
+        // Any change to the threshold can change the result, so the upper
+        // half holds all of its bits
+        unsigned int bits;
+        memcpy(&bits, &overdrawThreshold, sizeof(bits));
+        flags |= 4;
+        flags |= (unsigned long long)bits << 32;
+    }
+    return flags;
+}
 
-    ifstream objStream( fileName, std::ios::in );
+void VBOMesh::loadOBJ( const char * fileName, const Options & options ) {
 
-    if( !objStream ) {
+    UploadData upload;
+    if( ! loadVertexData( fileName, options, upload ) ) {
         cerr << "Unable to open OBJ file: " << fileName << endl;
         exit(1);
     }
 
-    string line, token;
-    vector<int> face;
-
-    getline( objStream, line );
-    while( !objStream.eof() ) {
-        trimString(line);
-        if( line.length( ) > 0 && line.at(0) != '#' ) {
-            istringstream lineStream( line );
-
-            lineStream >> token;
-
-            if (token == "v" ) {
-                float x, y, z;
-                lineStream >> x >> y >> z;
-                points.push_back( vec3(x,y,z) );
-            } else if (token == "vt" ) {
-                // Process texture coordinate
-                float s,t;
-                lineStream >> s >> t;
-                texCoords.push_back( vec2(s,t) );
-            } else if (token == "vn" ) {
-                float x, y, z;
-                lineStream >> x >> y >> z;
-                normals.push_back( vec3(x,y,z) );
-            } else if (token == "f" ) {
-                nFaces++;
-
-                // Process face
-                face.clear();
-                size_t slash1, slash2;
-                //int point, texCoord, normal;
-                while( lineStream.good() ) {
-                    string vertString;
-                    lineStream >> vertString;
-                    int pIndex = -1, nIndex = -1 , tcIndex = -1;
-
-                    slash1 = vertString.find("/");
-                    if( slash1 == string::npos ){
-                        pIndex = atoi( vertString.c_str() ) - 1;
-                    } else {
-                        slash2 = vertString.find("/", slash1 + 1 );
-                        pIndex = atoi( vertString.substr(0,slash1).c_str() )
-                                        - 1;
-                        if( slash2 > slash1 + 1 ) {
-                                tcIndex =
-                                        atoi( vertString.substr(slash1 + 1, slash2).c_str() )
-                                        - 1;
-                        }
-                        nIndex =
-                                atoi( vertString.substr(slash2 + 1,vertString.length()).c_str() )
-                                - 1;
-                    }
-                    if( pIndex == -1 ) {
-                        printf("Missing point index!!!");
-                    } else {
-                        face.push_back(pIndex);
-                    }
-
-                    if( tcIndex != -1 && pIndex != nIndex ) {
-                        printf("Texture and point indices are not consistent.\n");
-                    }
-                    if ( nIndex != -1 && nIndex != pIndex ) {
-                        printf("Normal and point indices are not consistent.\n");
-                    }
-                }
-                if( face.size() != 3 ) {
-                    printf("Found non-triangular face.\n");
-                } else {
-                    faces.push_back(face[0]);
-                    faces.push_back(face[1]);
-                    faces.push_back(face[2]);
-                }
-            }
-        }
-        getline( objStream, line );
+    storeVBO(upload);
+
+    const MeshCache & data = upload.data;
+    cout << "Loaded mesh from: " << fileName;
+    if( data.isMapped() ) cout << " (cached)";
+    cout << endl;
+    cout << " " << data.vertexCount() << " points" << endl;
+    cout << " " << data.lodIndexCount(0) / 3 << " faces" << endl;
+    for( unsigned int l = 1; l < data.lodCount(); l++ ) {
+        cout << " LOD " << l << ": " << data.lodIndexCount(l) / 3 << " faces, error "
+             << data.lodError(l) << endl;
+    }
+    cout << " " << data.vertexCount() << " normals" << endl;
+    cout << " " << ((data.attributes() & MeshCache::TEXCOORD) ? data.vertexCount() : 0)
+         << " texture coordinates." << endl;
+}
+
+bool VBOMesh::loadVertexData( const char * fileName, const Options & options,
+                              MeshCache & data )
+{
+    unsigned long long sourceHash = 0, sourceSize = 0;
+    unsigned long long flags = options.cacheFlags();
+    string cacheName = string(fileName) + ".vbocache";
+
+    if( options.useCache ) {
+        if( ! MeshCache::hashFile( fileName, sourceHash, sourceSize ) ) return false;
+        if( data.open( cacheName.c_str(), sourceHash, sourceSize, flags ) ) return true;
     }
 
-    objStream.close();
+    ObjData obj;
+    if( ! ObjParser::parseFile( fileName, obj, options.loadThreads ) ) {
+        return false;
+    }
+
+    vector <vec3> & points = obj.points;
+    vector <vec3> & normals = obj.normals;
+    vector <vec2> & texCoords = obj.texCoords;
+    vector <int> & faces = obj.faces;
 
+    // Average normals over the shared positions before welding, so that
+    // texture seams don't also become shading seams
     if( normals.size() == 0 ) {
-        generateAveragedNormals(points,normals,faces);
+        if( options.loadThreads == 1 ) {
+            generateAveragedNormals(points,normals,faces);
+        } else {
+            generateAveragedNormalsParallel(points,normals,faces,options.loadThreads);
+        }
+        obj.faceNormals = faces;
+    }
+
+    if( obj.needsWelding() ) {
+        size_t corners = faces.size();
+        size_t unique = obj.weld();
+        cout << "Welded " << corners << " face vertices into "
+             << unique << " unique vertices." << endl;
     }
 
     vector<vec4> tangents;
     if( texCoords.size() > 0 ) {
-        generateTangents(points,normals,faces,texCoords,tangents);
+        if( options.loadThreads == 1 ) {
+            generateTangents(points,normals,faces,texCoords,tangents);
+        } else {
+            generateTangentsParallel(points,normals,faces,texCoords,tangents,options.loadThreads);
+        }
     }
 
-    if( reCenterMesh ) {
+    if( options.reCenterMesh ) {
         center(points);
     }
 
-    storeVBO(points, normals, texCoords, tangents, faces);
+    vector<float> verts;
+    unsigned int stride, attributes;
+    interleave(points, normals, texCoords, tangents, verts, stride, attributes);
+
+    // Levels of detail, each simplified from the one before.  They only
+    // reference existing vertices, so all of them share the vertex buffer.
+    // Simplifying a level resets the quadrics, so a level's error is
+    // estimated as the sum of the errors of each step.
+    vector< vector<unsigned int> > lods(1);
+    lods[0].assign(faces.begin(), faces.end());
+    vector<float> lodErrors(1, 0.0f);
+    int maxLevels = std::min(options.lodLevels, (int)MeshCache::MAX_LODS - 1);
+    for( int l = 1; l <= maxLevels && ! lods[0].empty(); l++ ) {
+        const vector<unsigned int> & source = lods[l - 1];
+        vector<unsigned int> level(source.size());
+        float error = 0.0f;
+        size_t nIndices = MeshOptimizer::simplify(&level[0], &source[0], source.size(),
+                                                  &verts[0], stride, points.size(),
+                                                  source.size() / 6 * 3, &error);
+        if( nIndices == 0 || nIndices == source.size() ) break;
+        level.resize(nIndices);
+        lods.push_back(level);
+        lodErrors.push_back(lodErrors.back() + error);
+    }
+
+    vector<unsigned int> elements;
+    vector<unsigned int> lodIndexCounts;
+    for( size_t l = 0; l < lods.size(); l++ ) {
+        vector<unsigned int> & el = lods[l];
+        if( options.optimizeVertexCache && ! el.empty() ) {
+            MeshOptimizer::optimizeVertexCache(&el[0], el.size(), points.size());
+        }
+        if( options.optimizeOverdraw && ! el.empty() ) {
+            MeshOptimizer::optimizeOverdraw(&el[0], el.size(),
+                                            &verts[0], stride, points.size(),
+                                            options.overdrawThreshold);
+        }
+        elements.insert(elements.end(), el.begin(), el.end());
+        lodIndexCounts.push_back((unsigned int)el.size());
+    }
+
+    // Last, since it renumbers the vertices.  The full mesh comes first
+    // and uses every vertex, so its order decides the numbering.
+    if( options.optimizeVertexFetch && ! elements.empty() ) {
+        size_t nVerts = MeshOptimizer::optimizeVertexFetch(&verts[0], stride,
+                                                           &elements[0], elements.size(),
+                                                           points.size());
+        verts.resize(nVerts * stride);
+    }
+
+    data.assign(verts, elements, stride, attributes, sourceHash, sourceSize, flags,
+                (unsigned int)lods.size(), &lodIndexCounts[0], &lodErrors[0]);
+
+    if( options.useCache && ! data.write( cacheName.c_str() ) ) {
+        cerr << "Unable to write mesh cache: " << cacheName << endl;
+    }
+    return true;
+}
 
-    cout << "Loaded mesh from: " << fileName << endl;
-    cout << " " << points.size() << " points" << endl;
-    cout << " " << nFaces << " faces" << endl;
-    cout << " " << normals.size() << " normals" << endl;
-    cout << " " << texCoords.size() << " texture coordinates." << endl;
+bool VBOMesh::loadMeshData( const char * fileName, const Options & options,
+                            MeshData & data )
+{
+    MeshCache cache;
+    if( ! loadVertexData(fileName, options, cache) ) return false;
+
+    // Interleaved as position, normal, then optionally texture coordinate
+    // and tangent
+    size_t nVerts = cache.vertexCount();
+    unsigned int stride = cache.stride();
+    bool textured = (cache.attributes() & MeshCache::TEXCOORD) != 0;
+    data.resize(nVerts, cache.lodIndexCount(0), true, textured, textured);
+    const float * v = cache.vertices();
+    for( size_t i = 0; i < nVerts; i++, v += stride ) {
+        std::copy(v, v + 3, &data.positions[i * 3]);
+        std::copy(v + 3, v + 6, &data.normals[i * 3]);
+        if( textured ) {
+            std::copy(v + 6, v + 8, &data.texCoords[i * 2]);
+            std::copy(v + 8, v + 12, &data.tangents[i * 4]);
+        }
+    }
+    std::copy(cache.indices(), cache.indices() + cache.lodIndexCount(0), data.indices.begin());
+    data.boundsMin = cache.boundsMin();
+    data.boundsMax = cache.boundsMax();
+    return true;
 }
 
 void VBOMesh::center( vector<vec3> & points ) {
@@ -172,9 +495,7 @@ void VBOMesh::generateAveragedNormals(
         vector<vec3> & normals,
         const vector<int> & faces )
 {
-    for( size_t i = 0; i < points.size(); i++ ) {
-        normals.push_back(vec3(0.0f));
-    }
+    normals.assign(points.size(), vec3(0.0f));
 
     for( size_t i = 0; i < faces.size(); i += 3) {
         const vec3 & p1 = points[faces[i]];
@@ -183,7 +504,9 @@ void VBOMesh::generateAveragedNormals(
 
         vec3 a = p2 - p1;
         vec3 b = p3 - p1;
-        vec3 n = glm::normalize(glm::cross(a,b));
+        vec3 n = glm::cross(a,b);
+        if( glm::dot(n,n) == 0.0f ) continue;
+        n = glm::normalize(n);
 
         normals[faces[i]] += n;
         normals[faces[i+1]] += n;
@@ -202,14 +525,9 @@ void VBOMesh::generateTangents(
         const vector<vec2> & texCoords,
         vector<vec4> & tangents)
 {
-    vector<vec3> tan1Accum;
-    vector<vec3> tan2Accum;
-
-    for( size_t i = 0; i < points.size(); i++ ) {
-        tan1Accum.push_back(vec3(0.0f));
-        tan2Accum.push_back(vec3(0.0f));
-        tangents.push_back(vec4(0.0f));
-    }
+    vector<vec3> tan1Accum(points.size(), vec3(0.0f));
+    vector<vec3> tan2Accum(points.size(), vec3(0.0f));
+    tangents.assign(points.size(), vec4(0.0f));
 
     // Compute the tangent vector
     for( size_t i = 0; i < faces.size(); i += 3 )
@@ -226,7 +544,9 @@ void VBOMesh::generateTangents(
         vec3 q2 = p3 - p1;
         float s1 = tc2.x - tc1.x, s2 = tc3.x - tc1.x;
         float t1 = tc2.y - tc1.y, t2 = tc3.y - tc1.y;
-        float r = 1.0f / (s1 * t2 - s2 * t1);
+        float det = s1 * t2 - s2 * t1;
+        if( det == 0.0f ) continue;
+        float r = 1.0f / det;
         vec3 tan1( (t2*q1.x - t1*q2.x) * r,
                    (t2*q1.y - t1*q2.y) * r,
                    (t2*q1.z - t1*q2.z) * r);
@@ -252,109 +572,212 @@ void VBOMesh::generateTangents(
         // Store handedness in w
         tangents[i].w = (glm::dot( glm::cross(n,t1), t2 ) < 0.0f) ? -1.0f : 1.0f;
     }
-    tan1Accum.clear();
-    tan2Accum.clear();
 }
 
-void VBOMesh::storeVBO( const vector<vec3> & points,
-                        const vector<vec3> & normals,
-                        const vector<vec2> &texCoords,
-                        const vector<vec4> &tangents,
-                        const vector<int> &elements )
+void VBOMesh::generateAveragedNormalsParallel(
+        const vector<vec3> & points,
+        vector<vec3> & normals,
+        const vector<int> & faces,
+        int nThreads )
 {
-    size_t nVerts  = points.size();
-    faces = (unsigned int)elements.size() / 3;
-
-    float * v = new float[3 * nVerts];
-    float * n = new float[3 * nVerts];
-    float * tc = NULL;
-    float * tang = NULL;
+    size_t nVerts = points.size(), nFaces = faces.size() / 3;
+    nThreads = threadCount(nThreads, nFaces);
+    normals.resize(nVerts);
+
+    // Sums padded to four floats per vertex, so that adding a face's
+    // normal to a corner is one vector operation
+    vector< vector<float> > partial(nThreads);
+    parallelRun(nThreads, [&]( int t ) {
+        partial[t].assign(nVerts * 4, 0.0f);
+        float * accum = partial[t].empty() ? NULL : &partial[t][0];
+
+        size_t end = nFaces * (t + 1) / nThreads;
+        for( size_t f = nFaces * t / nThreads; f < end; f += 4 ) {
+            int lanes = (int)std::min<size_t>(4, end - f), padded[12];
+            const int * face = faceGroup(&faces[f * 3], lanes, padded);
+            Float4x3 n = faceNormals4(gatherCorner(&points[0], face),
+                                      gatherCorner(&points[0], face + 1),
+                                      gatherCorner(&points[0], face + 2));
+            scatterAdd(n, face, lanes, accum);
+        }
+    });
+
+    parallelRun(nThreads, [&]( int t ) {
+        size_t end = nVerts * (t + 1) / nThreads;
+        for( size_t v = nVerts * t / nThreads; v < end; v += 4 ) {
+            int lanes = (int)std::min<size_t>(4, end - v);
+            Float4x3 sum = gatherRun(&partial[0][v * 4], lanes);
+            for( size_t i = 1; i < partial.size(); i++ ) {
+                sum = sum + gatherRun(&partial[i][v * 4], lanes);
+            }
+            sum = normalize4(sum);
 
-    if(texCoords.size() > 0 && tangents.size() > 0) {
-        tc = new float[ 2 * nVerts];
-        tang = new float[4*nVerts];
-    }
+            float out[3][4];
+            store4(out[0], sum.x);
+            store4(out[1], sum.y);
+            store4(out[2], sum.z);
+            for( int l = 0; l < lanes; l++ ) normals[v + l] = vec3(out[0][l], out[1][l], out[2][l]);
+        }
+    });
+}
 
-    unsigned int *el = new unsigned int[elements.size()];
+void VBOMesh::generateTangentsParallel(
+        const vector<vec3> & points,
+        const vector<vec3> & normals,
+        const vector<int> & faces,
+        const vector<vec2> & texCoords,
+        vector<vec4> & tangents,
+        int nThreads )
+{
+    size_t nVerts = points.size(), nFaces = faces.size() / 3;
+    nThreads = threadCount(nThreads, nFaces);
+    tangents.resize(nVerts);
+
+    // Padded to four floats per vertex, as in generateAveragedNormalsParallel
+    vector< vector<float> > tan1Accum(nThreads), tan2Accum(nThreads);
+    parallelRun(nThreads, [&]( int t ) {
+        tan1Accum[t].assign(nVerts * 4, 0.0f);
+        tan2Accum[t].assign(nVerts * 4, 0.0f);
+        float * tan1Sum = tan1Accum[t].empty() ? NULL : &tan1Accum[t][0];
+        float * tan2Sum = tan2Accum[t].empty() ? NULL : &tan2Accum[t][0];
+
+        size_t end = nFaces * (t + 1) / nThreads;
+        for( size_t f = nFaces * t / nThreads; f < end; f += 4 ) {
+            int lanes = (int)std::min<size_t>(4, end - f), padded[12];
+            const int * face = faceGroup(&faces[f * 3], lanes, padded);
+            Float4 u1, v1, u2, v2, u3, v3;
+            gatherCorner(&texCoords[0], face, u1, v1);
+            gatherCorner(&texCoords[0], face + 1, u2, v2);
+            gatherCorner(&texCoords[0], face + 2, u3, v3);
+            Float4x3 tan1, tan2;
+            faceTangents4(gatherCorner(&points[0], face), gatherCorner(&points[0], face + 1),
+                          gatherCorner(&points[0], face + 2), u1, v1, u2, v2, u3, v3,
+                          tan1, tan2);
+            scatterAdd(tan1, face, lanes, tan1Sum);
+            scatterAdd(tan2, face, lanes, tan2Sum);
+        }
+    });
+
+    parallelRun(nThreads, [&]( int t ) {
+        size_t end = nVerts * (t + 1) / nThreads;
+        for( size_t v = nVerts * t / nThreads; v < end; v += 4 ) {
+            int lanes = (int)std::min<size_t>(4, end - v);
+            Float4x3 sum1 = gatherRun(&tan1Accum[0][v * 4], lanes);
+            Float4x3 sum2 = gatherRun(&tan2Accum[0][v * 4], lanes);
+            for( size_t i = 1; i < tan1Accum.size(); i++ ) {
+                sum1 = sum1 + gatherRun(&tan1Accum[i][v * 4], lanes);
+                sum2 = sum2 + gatherRun(&tan2Accum[i][v * 4], lanes);
+            }
 
-    int idx = 0, tcIdx = 0, tangIdx = 0;
-    for( int i = 0; i < nVerts; ++i )
-    {
-        v[idx] = points[i].x;
-        v[idx+1] = points[i].y;
-        v[idx+2] = points[i].z;
-        n[idx] = normals[i].x;
-        n[idx+1] = normals[i].y;
-        n[idx+2] = normals[i].z;
-        idx += 3;
-        if( tc != NULL ) {
-            tang[tangIdx] = tangents[i].x;
-            tang[tangIdx+1] = tangents[i].y;
-            tang[tangIdx+2] = tangents[i].z;
-            tang[tangIdx+3] = tangents[i].w;
-            tangIdx += 4;
-            tc[tcIdx] = texCoords[i].x;
-            tc[tcIdx+1] = texCoords[i].y;
-            tcIdx += 2;
+            // Gram-Schmidt orthogonalize, handedness in w
+            Float4x3 n = gatherRun(&normals[v], lanes);
+            Float4x3 tangent = normalize4(sum1 - n * dot4(n, sum1));
+            Float4 zero = splat4(0.0f);
+            Float4 w = select4(less4(dot4(cross4(n, sum1), sum2), zero), splat4(-1.0f),
+                               splat4(1.0f));
+
+            Float4 a = tangent.x, b = tangent.y, c = tangent.z, d = w;
+            transpose4(a, b, c, d);
+            store4(&tangents[v].x, a);
+            if( lanes > 1 ) store4(&tangents[v + 1].x, b);
+            if( lanes > 2 ) store4(&tangents[v + 2].x, c);
+            if( lanes > 3 ) store4(&tangents[v + 3].x, d);
         }
+    });
+}
+
+void VBOMesh::interleave( const vector<vec3> & points,
+                          const vector<vec3> & normals,
+                          const vector<vec2> & texCoords,
+                          const vector<vec4> & tangents,
+                          vector<float> & verts,
+                          unsigned int & stride,
+                          unsigned int & attributes )
+{
+    size_t nVerts = points.size();
+    bool hasTangents = texCoords.size() > 0 && tangents.size() > 0;
+
+    attributes = MeshCache::POSITION | MeshCache::NORMAL;
+    stride = 6;
+    if( hasTangents ) {
+        attributes |= MeshCache::TEXCOORD | MeshCache::TANGENT;
+        stride += 6;
     }
-    for( size_t i = 0; i < elements.size(); ++i )
+
+    verts.resize(stride * nVerts);
+    float * v = verts.empty() ? NULL : &verts[0];
+    for( size_t i = 0; i < nVerts; ++i )
     {
-        el[i] = elements[i];
+        v[0] = points[i].x;
+        v[1] = points[i].y;
+        v[2] = points[i].z;
+        v[3] = normals[i].x;
+        v[4] = normals[i].y;
+        v[5] = normals[i].z;
+        if( hasTangents ) {
+            v[6] = texCoords[i].x;
+            v[7] = texCoords[i].y;
+            v[8] = tangents[i].x;
+            v[9] = tangents[i].y;
+            v[10] = tangents[i].z;
+            v[11] = tangents[i].w;
+        }
+        v += stride;
     }
-    glGenVertexArrays( 1, &vaoHandle );
-    glBindVertexArray(vaoHandle);
+}
 
-    int nBuffers = 5;
-    GLuint elementBuffer = 4;
-    if( tc == NULL ) {
-        nBuffers = 3;
-        elementBuffer = 2;
+void VBOMesh::UploadData::clear()
+{
+    data.clear();
+    vertices = EncodedVertices();
+    indices = EncodedIndices();
+    Meshlets none;
+    meshlets.swap(none);
+}
+
+bool VBOMesh::loadVertexData( const char * fileName, const Options & options,
+                              UploadData & upload )
+{
+    upload.clear();
+    if( ! loadVertexData(fileName, options, upload.data) ) return false;
+
+    const MeshCache & data = upload.data;
+    VertexAttribute attributes[4];
+    int nAttributes = meshAttributes(data, attributes);
+    encodeVertexAttributes(attributes, nAttributes, data.vertexCount(),
+                           options.layout, options.compression, upload.vertices);
+    encodeIndices(data.indices(), data.indexCount(), data.vertexCount(), upload.indices);
+
+    if( options.buildMeshlets ) {
+        upload.meshlets.build(data.indices(), data.lodIndexCount(0), data.vertices(),
+                              data.stride(), data.vertexCount());
     }
+    return true;
+}
 
-    unsigned int handle[5];
-    glGenBuffers(nBuffers, handle);
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[0]);
-    glBufferData(GL_ARRAY_BUFFER, (3 * nVerts) * sizeof(float), v, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)0, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(0);  // Vertex position
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
-    glBufferData(GL_ARRAY_BUFFER, (3 * nVerts) * sizeof(float), n, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)1, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(1);  // Vertex normal
-
-    if( tc != NULL ) {
-        glBindBuffer(GL_ARRAY_BUFFER, handle[2]);
-        glBufferData(GL_ARRAY_BUFFER, (2 * nVerts) * sizeof(float), tc, GL_STATIC_DRAW);
-        glVertexAttribPointer( (GLuint)2, 2, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-        glEnableVertexAttribArray(2);  // Texture coords
-
-        glBindBuffer(GL_ARRAY_BUFFER, handle[3]);
-        glBufferData(GL_ARRAY_BUFFER, (4 * nVerts) * sizeof(float), tang, GL_STATIC_DRAW);
-        glVertexAttribPointer( (GLuint)3, 4, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-        glEnableVertexAttribArray(3);  // Tangent vector
+void VBOMesh::storeVBO( UploadData & upload )
+{
+    releaseStorage();
+    if( cullHandle != 0 ) glDeleteBuffers(1, &cullHandle);
+    cullHandle = 0;
+
+    const MeshCache & data = upload.data;
+    vertexCount = data.vertexCount();
+    nLods = data.lodCount();
+    for( unsigned int l = 0; l < nLods; l++ ) {
+        lodFirst[l] = data.lodIndexOffset(l);
+        lodCount[l] = data.lodIndexCount(l);
+        lodError[l] = data.lodError(l);
     }
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle[elementBuffer]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 3 * faces * sizeof(unsigned int), el, GL_STATIC_DRAW);
+    glGenVertexArrays( 1, &vaoHandle );
+    glBindVertexArray(vaoHandle);
+    storeVertexAttributes(upload.vertices);
+    indexType = storeIndices(upload.indices);
+    glBindVertexArray(0);
 
-    delete [] v;
-    delete [] n;
-    if( tc != NULL ) {
-        delete [] tc;
-        delete [] tang;
+    meshlets.swap(upload.meshlets);
+    if( meshlets.size() > 0 ) {
+        glGenBuffers(1, &cullHandle);
     }
-    delete [] el;
-}
-
-void VBOMesh::trimString( string & str ) {
-    const char * whiteSpace = " \t\n\r";
-    size_t location;
-    location = str.find_first_not_of(whiteSpace);
-    str.erase(0,location);
-    location = str.find_last_not_of(whiteSpace);
-    str.erase(location + 1);
 }
-
@@ -6,14 +6,25 @@
 #include <cstdio>
 #include <cmath>
 
-VBOPlane::VBOPlane(float xsize, float zsize, int xdivs, int zdivs)
+VBOPlane::VBOPlane(float xsize, float zsize, int xdivs, int zdivs, VertexLayout layout,
+                   VertexCompression compression, MeshData::Primitive primitive)
 {
-    glGenVertexArrays( 1, &vaoHandle );
-    glBindVertexArray(vaoHandle);
-    faces = xdivs * zdivs;
-    float * v = new float[3 * (xdivs + 1) * (zdivs + 1)];
-    float * tex = new float[2 * (xdivs + 1) * (zdivs + 1)];
-    unsigned int * el = new unsigned int[6 * xdivs * zdivs];
+    MeshData data;
+    generate(data, xsize, zsize, xdivs, zdivs, primitive);
+    upload(data, layout, compression);
+}
+
+void VBOPlane::generate(MeshData & data, float xsize, float zsize, int xdivs, int zdivs,
+                        MeshData::Primitive primitive)
+{
+    // The normal is constant, see render()
+    bool strips = (primitive == MeshData::TRIANGLE_STRIPS);
+    size_t nIndices = strips ? zdivs * (2 * xdivs + 4) - 1 : 6 * xdivs * zdivs;
+    data.resize((xdivs + 1) * (zdivs + 1), nIndices, false);
+    data.primitive = primitive;
+    float * v = &data.positions[0];
+    float * tex = &data.texCoords[0];
+    unsigned int * el = &data.indices[0];
 
     float x2 = xsize / 2.0f;
     float z2 = zsize / 2.0f;
@@ -42,6 +53,18 @@ VBOPlane::VBOPlane(float xsize, float zsize, int xdivs, int zdivs)
     for( int i = 0; i < zdivs; i++ ) {
         rowStart = i * (xdivs+1);
         nextRowStart = (i+1) * (xdivs+1);
+        if( strips ) {
+            // Starts on a repeated vertex to keep the list's winding and diagonals
+            if( i > 0 ) el[idx++] = MeshData::RESTART_INDEX;
+            el[idx++] = nextRowStart;
+            el[idx++] = nextRowStart;
+            for( int j = 0; j < xdivs; j++ ) {
+                el[idx++] = rowStart + j;
+                el[idx++] = nextRowStart + j + 1;
+            }
+            el[idx++] = rowStart + xdivs;
+            continue;
+        }
         for( int j = 0; j < xdivs; j++ ) {
             el[idx] = rowStart + j;
             el[idx+1] = nextRowStart + j;
@@ -52,32 +75,17 @@ VBOPlane::VBOPlane(float xsize, float zsize, int xdivs, int zdivs)
             idx += 6;
         }
     }
-
-    unsigned int handle[3];
-    glGenBuffers(3, handle);
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[0]);
-    glBufferData(GL_ARRAY_BUFFER, 3 * (xdivs+1) * (zdivs+1) * sizeof(float), v, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)0, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(0);  // Vertex position
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
-    glBufferData(GL_ARRAY_BUFFER, 2 * (xdivs+1) * (zdivs+1) * sizeof(float), tex, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)2, 2, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(2);  // Texture coords
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle[2]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * xdivs * zdivs * sizeof(unsigned int), el, GL_STATIC_DRAW);
-
-    delete [] v;
-    delete [] tex;
-    delete [] el;
+    data.computeBounds();
 }
 
 void VBOPlane::render() const {
     GLUtils::checkForOpenGLError(__FILE__,__LINE__);
-    glBindVertexArray(vaoHandle);
     glVertexAttrib3f(1, 0.0f, 1.0f, 0.0f);  // Constant normal for all verts
-    glDrawElements(GL_TRIANGLES, 6 * faces, GL_UNSIGNED_INT, ((GLubyte *)NULL + (0)));
+    MeshDrawable::render();
     GLUtils::checkForOpenGLError(__FILE__,__LINE__);
 }
+
+void VBOPlane::renderInstanced( int count ) const {
+    glVertexAttrib3f(1, 0.0f, 1.0f, 0.0f);
+    MeshDrawable::renderInstanced(count);
+}
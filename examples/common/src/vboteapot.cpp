@@ -1,60 +1,158 @@
 #include "vboteapot.h"
 #include "teapotdata.h"
-//#include "glutils.h"
-#include <GL/glew.h>
-
-#ifdef Q_OS_MAC
-#include <OpenGL/gl.h>
-#endif
-
+#include "meshoptimizer.h"
+#include "float4.h"
 #include <cstdio>
+#include <cmath>
+#include <vector>
+using std::vector;
+#include <thread>
+#include <atomic>
 
 #include <glm/gtc/matrix_transform.hpp>
 using glm::mat4;
 using glm::vec4;
 
-VBOTeapot::VBOTeapot(int grid, mat4 lidTransform)
-{
-    int verts = 32 * (grid + 1) * (grid + 1);
-    faces = grid * grid * 32;
-    float * v = new float[ verts * 3 ];
-    float * n = new float[ verts * 3 ];
-    float * tc = new float[ verts * 2 ];
-    unsigned int * el = new unsigned int[faces * 6];
-
-    glGenVertexArrays( 1, &vaoHandle );
-    glBindVertexArray(vaoHandle);
+namespace {
 
-    unsigned int handle[4];
-    glGenBuffers(4, handle);
+const int nPatches = 32;
 
-    generatePatches( v, n, tc, el, grid );
-    moveLid(grid, v, lidTransform);
+// One of the 32 patches: which of the ten in the data, and how it is mirrored
+struct PatchInstance
+{
+    int patchNum;
+    bool reverseV;
+    float sx, sy;           // Reflection in x and y, 1 or -1
+    bool invertNormal;
+};
+
+// The patches in the order generatePatches builds them
+void listPatches( PatchInstance * list )
+{
+    int count = 0;
+    for( int patchNum = 0; patchNum < 10; patchNum++ ) {
+        bool reflectX = patchNum < 6;   // The handle and spout are only mirrored in y
+        PatchInstance original = { patchNum, false, 1.0f, 1.0f, true };
+        list[count++] = original;
+        if( reflectX ) {
+            PatchInstance inX = { patchNum, true, -1.0f, 1.0f, false };
+            list[count++] = inX;
+        }
+        PatchInstance inY = { patchNum, true, 1.0f, -1.0f, false };
+        list[count++] = inY;
+        if( reflectX ) {
+            PatchInstance inXY = { patchNum, false, -1.0f, -1.0f, true };
+            list[count++] = inXY;
+        }
+    }
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, handle[0]);
-    glBufferData(GL_ARRAY_BUFFER, (3 * verts) * sizeof(float), v, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)0, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(0);  // Vertex position
+// Evaluates count vertices of one patch row, four at a time.  C and dC
+// are the control points of the row's curve and of its u derivative.
+// Bt and dBt are the basis functions transposed, Bt[k * stride + j],
+// padded with zeros to a multiple of four.
+void evaluateRow( const vec3 * C, const vec3 * dC, const float * Bt, const float * dBt,
+                  int stride, int count, const PatchInstance & inst, float * v, float * n )
+{
+    float nSign = inst.invertNormal ? -1.0f : 1.0f;
+    Float4 sx = splat4(inst.sx), sy = splat4(inst.sy);
+    Float4 nsx = splat4(nSign * inst.sx), nsy = splat4(nSign * inst.sy), nsz = splat4(nSign);
+
+    for( int j0 = 0; j0 < count; j0 += 4 ) {
+        Float4 px = splat4(0.0f), py = px, pz = px;
+        Float4 dux = px, duy = px, duz = px;
+        Float4 dvx = px, dvy = px, dvz = px;
+        for( int k = 0; k < 4; k++ ) {
+            Float4 b = load4(Bt + k * stride + j0);
+            Float4 db = load4(dBt + k * stride + j0);
+            Float4 cx = splat4(C[k].x), cy = splat4(C[k].y), cz = splat4(C[k].z);
+            px = px + cx * b;
+            py = py + cy * b;
+            pz = pz + cz * b;
+            dux = dux + splat4(dC[k].x) * b;
+            duy = duy + splat4(dC[k].y) * b;
+            duz = duz + splat4(dC[k].z) * b;
+            dvx = dvx + cx * db;
+            dvy = dvy + cy * db;
+            dvz = dvz + cz * db;
+        }
 
-    glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
-    glBufferData(GL_ARRAY_BUFFER, (3 * verts) * sizeof(float), n, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)1, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(1);  // Vertex normal
+        Float4 nx = duy * dvz - duz * dvy;
+        Float4 ny = duz * dvx - dux * dvz;
+        Float4 nz = dux * dvy - duy * dvx;
+        Float4 length = sqrt4(nx * nx + ny * ny + nz * nz);
+
+        float out[6][4];
+        store4(out[0], px * sx);
+        store4(out[1], py * sy);
+        store4(out[2], pz);
+        store4(out[3], nx * nsx / length);
+        store4(out[4], ny * nsy / length);
+        store4(out[5], nz * nsz / length);
+
+        int lanes = (count - j0 < 4) ? count - j0 : 4;
+        for( int l = 0; l < lanes; l++ ) {
+            float * pv = v + (j0 + l) * 3, * pn = n + (j0 + l) * 3;
+            pv[0] = out[0][l]; pv[1] = out[1][l]; pv[2] = out[2][l];
+            pn[0] = out[3][l]; pn[1] = out[4][l]; pn[2] = out[5][l];
+        }
+    }
+}
 
-    glBindBuffer(GL_ARRAY_BUFFER, handle[2]);
-    glBufferData(GL_ARRAY_BUFFER, (2 * verts) * sizeof(float), tc, GL_STATIC_DRAW);
-    glVertexAttribPointer( (GLuint)2, 2, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-    glEnableVertexAttribArray(2);  // texture coords
+}
 
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle[3]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * faces * sizeof(unsigned int), el, GL_STATIC_DRAW);
+VBOTeapot::VBOTeapot(int grid, mat4 lidTransform, bool optimizeVertexCache,
+                     VertexLayout layout, VertexCompression compression, bool weldSeams,
+                     MeshData::Primitive primitive, bool matchTexCoords)
+{
+    MeshData data;
+    generate(data, grid, lidTransform, optimizeVertexCache, weldSeams, primitive, matchTexCoords);
+    upload(data, layout, compression);
+}
 
-    delete [] v;
-    delete [] n;
-    delete [] el;
-    delete [] tc;
+void VBOTeapot::generate(MeshData & data, int grid, mat4 lidTransform, bool optimizeVertexCache,
+                         bool weldSeams, MeshData::Primitive primitive, bool matchTexCoords)
+{
+    int verts = 32 * (grid + 1) * (grid + 1);
+    int faces = grid * grid * 32;
+    data.resize(verts, faces * 6);
+    data.primitive = primitive;
+
+    generatePatchesParallel( &data.positions[0], &data.normals[0], &data.texCoords[0],
+                             &data.indices[0], grid );
+    moveLid(grid, &data.positions[0], lidTransform);
+
+    if( primitive == MeshData::TRIANGLE_STRIPS ) {
+        // One strip per row of each patch, taking row i + 1 and row i
+        // alternately, which gives the list's triangles
+        unsigned int * el = &data.indices[0];
+        int side = grid + 1;
+        for( int p = 0; p < 32; p++ ) {
+            for( int i = 0; i < grid; i++ ) {
+                unsigned int iStart = (p * side + i) * side;
+                if( p > 0 || i > 0 ) *el++ = MeshData::RESTART_INDEX;
+                for( int j = 0; j <= grid; j++ ) {
+                    *el++ = iStart + side + j;
+                    *el++ = iStart + j;
+                }
+            }
+        }
+        data.indices.resize(el - &data.indices[0]);
+    } else if( optimizeVertexCache ) {
+        // Two rows of a patch fit a 32 entry cache up to grid 14, and there
+        // the row order beats the pass, so keep whichever misses less
+        vector<unsigned int> reordered(data.indices);
+        MeshOptimizer::optimizeVertexCache(&reordered[0], 6 * faces, verts);
+        if( MeshOptimizer::analyzeVertexCache(&reordered[0], 6 * faces, verts, 32).acmr <
+            MeshOptimizer::analyzeVertexCache(&data.indices[0], 6 * faces, verts, 32).acmr ) {
+            data.indices.swap(reordered);
+        }
+    }
 
-    glBindVertexArray(0);
+    // Weld after the cache pass: welding keeps the triangle order, while
+    // the pass orders the separate patch grids better than the welded surface
+    if( weldSeams ) data.weld(1e-5f, 1e-3f, matchTexCoords);
+    data.computeBounds();
 }
 
 void VBOTeapot::generatePatches(float * v, float * n, float * tc, unsigned int* el, int grid) {
@@ -89,6 +187,118 @@ void VBOTeapot::generatePatches(float * v, float * n, float * tc, unsigned int*
     delete [] dB;
 }
 
+void VBOTeapot::generatePatchesParallel(float * v, float * n, float * tc, unsigned int * el,
+                                        int grid, int nThreads)
+{
+    int side = grid + 1;
+    int patchVerts = side * side, patchIndices = 6 * grid * grid;
+
+    // Small grids are not worth a thread
+    const int minVertsPerThread = 16 * 1024;
+    if( nThreads <= 0 ) nThreads = (int)std::thread::hardware_concurrency();
+    if( nThreads > nPatches * patchVerts / minVertsPerThread ) {
+        nThreads = nPatches * patchVerts / minVertsPerThread;
+    }
+    if( nThreads > nPatches ) nThreads = nPatches;
+    if( nThreads < 1 ) nThreads = 1;
+
+    vector<float> B(4 * side), dB(4 * side);
+    computeBasisFunctions(&B[0], &dB[0], grid);
+
+    int stride = (side + 3) & ~3;
+    vector<float> Bt(4 * stride, 0.0f), dBt(4 * stride, 0.0f);
+    for( int i = 0; i < side; i++ ) {
+        for( int k = 0; k < 4; k++ ) {
+            Bt[k * stride + i] = B[i * 4 + k];
+            dBt[k * stride + i] = dB[i * 4 + k];
+        }
+    }
+
+    PatchInstance patches[nPatches];
+    listPatches(patches);
+
+    // Every patch has a fixed place in the output, so threads just take
+    // the next patch until none are left
+    std::atomic<int> next(0);
+    auto work = [&]() {
+        for( int p = next++; p < nPatches; p = next++ ) {
+            const PatchInstance & inst = patches[p];
+            vec3 patch[4][4];
+            getPatch(inst.patchNum, patch, inst.reverseV);
+
+            int startIndex = p * patchVerts;
+            for( int i = 0; i < side; i++ ) {
+                // Collapse the patch along u to the curve through this row
+                vec3 C[4], dC[4];
+                for( int j = 0; j < 4; j++ ) {
+                    C[j] = dC[j] = vec3(0.0f);
+                    for( int k = 0; k < 4; k++ ) {
+                        C[j] += patch[k][j] * B[i * 4 + k];
+                        dC[j] += patch[k][j] * dB[i * 4 + k];
+                    }
+                }
+                int row = startIndex + i * side;
+                evaluateRow(C, dC, &Bt[0], &dBt[0], stride, side, inst, v + row * 3, n + row * 3);
+            }
+
+            float tcFactor = 1.0f / grid;
+            float * t = tc + startIndex * 2;
+            for( int i = 0; i < side; i++ ) {
+                for( int j = 0; j < side; j++ ) {
+                    *t++ = i * tcFactor;
+                    *t++ = j * tcFactor;
+                }
+            }
+
+            unsigned int * e = el + p * patchIndices;
+            for( int i = 0; i < grid; i++ ) {
+                unsigned int iStart = i * side + startIndex;
+                unsigned int nextiStart = (i + 1) * side + startIndex;
+                for( int j = 0; j < grid; j++ ) {
+                    e[0] = iStart + j;
+                    e[1] = nextiStart + j + 1;
+                    e[2] = nextiStart + j;
+
+                    e[3] = iStart + j;
+                    e[4] = iStart + j + 1;
+                    e[5] = nextiStart + j + 1;
+                    e += 6;
+                }
+            }
+        }
+    };
+
+    vector<std::thread> threads;
+    for( int t = 1; t < nThreads; t++ ) threads.push_back(std::thread(work));
+    work();
+    for( size_t t = 0; t < threads.size(); t++ ) threads[t].join();
+}
+
+void VBOTeapot::generateControlPoints(float * cp, mat4 lidTransform)
+{
+    PatchInstance patches[nPatches];
+    listPatches(patches);
+
+    for( int p = 0; p < nPatches; p++ ) {
+        const PatchInstance & inst = patches[p];
+        vec3 patch[4][4];
+        getPatch(inst.patchNum, patch, inst.reverseV);
+
+        // The lid is patches 12 to 19, as in moveLid
+        bool lid = p >= 12 && p < 20;
+        for( int u = 0; u < 4; u++ ) {
+            for( int v = 0; v < 4; v++ ) {
+                vec3 pt(inst.sx * patch[u][v].x, inst.sy * patch[u][v].y, patch[u][v].z);
+                if( lid ) pt = vec3(lidTransform * vec4(pt, 1.0f));
+                float * out = cp + ((p * 4 + u) * 4 + v) * 3;
+                out[0] = pt.x;
+                out[1] = pt.y;
+                out[2] = pt.z;
+            }
+        }
+    }
+}
+
 void VBOTeapot::moveLid(int grid, float *v, mat4 lidTransform) {
 
     int start = 3 * 12 * (grid+1) * (grid+1);
@@ -266,8 +476,3 @@ vec3 VBOTeapot::evaluateNormal( int gridU, int gridV, float *B, float *dB, vec3
     }
     return glm::normalize( glm::cross( du, dv ) );
 }
-
-void VBOTeapot::render() const {
-    glBindVertexArray(vaoHandle);
-    glDrawElements(GL_TRIANGLES, 6 * faces, GL_UNSIGNED_INT, ((GLubyte *)NULL + (0)));
-}
@@ -0,0 +1,87 @@
+#include "vboteapotpatches.h"
+#include "vboteapot.h"
+#include <GL/glew.h>
+
+using glm::vec4;
+
+namespace {
+
+// Whether control point i comes before j, comparing x, then y, then z
+bool before( const float * cp, int i, int j )
+{
+    const float * a = cp + i * 3, * b = cp + j * 3;
+    return a[0] < b[0] || (a[0] == b[0] && (a[1] < b[1] || (a[1] == b[1] && a[2] < b[2])));
+}
+
+}
+
+VBOTeapotPatches::VBOTeapotPatches(mat4 lidTransform)
+{
+    float cp[PATCHES * CONTROL_POINTS * 3];
+    VBOTeapot::generateControlPoints(cp, lidTransform);
+
+    glGenVertexArrays( 1, &vaoHandle );
+    glBindVertexArray(vaoHandle);
+
+    VertexAttribute position = { 0, 3, cp, 0, POSITION };
+    storeVertexAttributes(&position, 1, PATCHES * CONTROL_POINTS, SPLIT_BUFFERS);
+
+    glBindVertexArray(0);
+}
+
+void VBOTeapotPatches::render() const {
+    glBindVertexArray(vaoHandle);
+    glPatchParameteri(GL_PATCH_VERTICES, CONTROL_POINTS);
+    glDrawArrays(GL_PATCHES, 0, PATCHES * CONTROL_POINTS);
+}
+
+void VBOTeapotPatches::renderInstanced( int count ) const {
+    glBindVertexArray(vaoHandle);
+    glPatchParameteri(GL_PATCH_VERTICES, CONTROL_POINTS);
+    glDrawArraysInstanced(GL_PATCHES, 0, PATCHES * CONTROL_POINTS, count);
+}
+
+void VBOTeapotPatches::tessLevels( const float * cp, const mat4 & mvp, const vec2 & viewport,
+                                   float pixelsPerEdge, float maxLevel,
+                                   float outer[4], float inner[2] )
+{
+    vec2 screen[CONTROL_POINTS];
+    int outside[6] = { 0, 0, 0, 0, 0, 0 };
+    for( int i = 0; i < CONTROL_POINTS; i++ ) {
+        vec4 clip = mvp * vec4(cp[i * 3], cp[i * 3 + 1], cp[i * 3 + 2], 1.0f);
+        for( int c = 0; c < 3; c++ ) {
+            if( clip[c] < -clip.w ) outside[2 * c]++;
+            if( clip[c] > clip.w ) outside[2 * c + 1]++;
+        }
+        // Points behind the eye are pushed far out, which maxes the level
+        screen[i] = vec2(clip) / glm::max(clip.w, 1e-4f) * 0.5f * viewport;
+    }
+
+    // The patch lies inside the hull of its control points
+    for( int p = 0; p < 6; p++ ) {
+        if( outside[p] == CONTROL_POINTS ) {
+            outer[0] = outer[1] = outer[2] = outer[3] = 0.0f;
+            inner[0] = inner[1] = 0.0f;
+            return;
+        }
+    }
+
+    // Edges u = 0, v = 0, u = 1 and v = 1, in gl_TessLevelOuter order
+    static const int first[4] = { 0, 0, 12, 3 };
+    static const int step[4] = { 1, 4, 1, 4 };
+    for( int e = 0; e < 4; e++ ) {
+        // From the end that comes first, as the patch across the edge does
+        int f = first[e], s = step[e], last = f + 3 * s;
+        if( before(cp, last, f) || (! before(cp, f, last) && before(cp, last - s, f + s)) ) {
+            f = last;
+            s = -s;
+        }
+        float length = 0.0f;
+        for( int k = 0; k < 3; k++ ) {
+            length += glm::distance(screen[f + k * s], screen[f + (k + 1) * s]);
+        }
+        outer[e] = glm::clamp(length / pixelsPerEdge, 1.0f, maxLevel);
+    }
+    inner[0] = glm::max(outer[1], outer[3]);
+    inner[1] = glm::max(outer[0], outer[2]);
+}
@@ -1,77 +1,57 @@
 #include "vbotorus.h"
 #include "defines.h"
-#include <GL/glew.h>
+#include "meshoptimizer.h"
 #include <cstdio>
 #include <cmath>
 
-VBOTorus::VBOTorus(float outerRadius, float innerRadius, int nsides, int nrings) :
-        rings(nrings), sides(nsides)
+VBOTorus::VBOTorus(float outerRadius, float innerRadius, int nsides, int nrings,
+                   bool optimizeVertexCache, VertexLayout layout,
+                   VertexCompression compression, MeshData::Primitive primitive)
 {
-    faces = sides * rings;
-    int nVerts  = sides * (rings+1);   // One extra ring to duplicate first ring
-
-    // Verts
-    float * v = new float[3 * nVerts];
-    // Normals
-    float * n = new float[3 * nVerts];
-    // Tex coords
-    float * tex = new float[2 * nVerts];
-    // Elements
-    unsigned int * el = new unsigned int[6 * faces];
-
-    // Generate the vertex data
-    generateVerts(v, n, tex, el, outerRadius, innerRadius);
-
-    // Create and populate the buffer objects
-    unsigned int handle[4];
-    glGenBuffers(4, handle);
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[0]);
-    glBufferData(GL_ARRAY_BUFFER, (3 * nVerts) * sizeof(float), v, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
-    glBufferData(GL_ARRAY_BUFFER, (3 * nVerts) * sizeof(float), n, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[2]);
-    glBufferData(GL_ARRAY_BUFFER, (2 * nVerts) * sizeof(float), tex, GL_STATIC_DRAW);
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle[3]);
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, 6 * faces * sizeof(unsigned int), el, GL_STATIC_DRAW);
-
-    delete [] v;
-    delete [] n;
-    delete [] el;
-    delete [] tex;
-
-    // Create the VAO
-    glGenVertexArrays( 1, &vaoHandle );
-    glBindVertexArray(vaoHandle);
-
-    glEnableVertexAttribArray(0);  // Vertex position
-    glBindBuffer(GL_ARRAY_BUFFER, handle[0]);
-    glVertexAttribPointer( (GLuint)0, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-
-    glEnableVertexAttribArray(1);  // Vertex normal
-    glBindBuffer(GL_ARRAY_BUFFER, handle[1]);
-    glVertexAttribPointer( (GLuint)1, 3, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-
-    glBindBuffer(GL_ARRAY_BUFFER, handle[2]);
-    glEnableVertexAttribArray(2);  // Texture coords
-    glVertexAttribPointer( (GLuint)2, 2, GL_FLOAT, GL_FALSE, 0, ((GLubyte *)NULL + (0)) );
-
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, handle[3]);
-
-    glBindVertexArray(0);
+    MeshData data;
+    generate(data, outerRadius, innerRadius, nsides, nrings, optimizeVertexCache, primitive);
+    upload(data, layout, compression);
 }
 
-void VBOTorus::render() const {
-    glBindVertexArray(vaoHandle);
-    glDrawElements(GL_TRIANGLES, 6 * faces, GL_UNSIGNED_INT, ((GLubyte *)NULL + (0)));
+void VBOTorus::generate(MeshData & data, float outerRadius, float innerRadius,
+                        int sides, int rings, bool optimizeVertexCache,
+                        MeshData::Primitive primitive)
+{
+    int faces = sides * rings;
+    int nVerts  = sides * (rings+1);   // One extra ring to duplicate first ring
+    data.resize(nVerts, 6 * faces);
+    data.primitive = primitive;
+
+    generateVerts(&data.positions[0], &data.normals[0], &data.texCoords[0], &data.indices[0],
+                  outerRadius, innerRadius, rings, sides);
+
+    if( primitive == MeshData::TRIANGLE_STRIPS ) {
+        // Each strip starts on a repeated vertex so that it keeps the
+        // winding and diagonals of the list
+        unsigned int * el = &data.indices[0];
+        for( int ring = 0; ring < rings; ring++ ) {
+            unsigned int ringStart = ring * sides;
+            unsigned int nextRingStart = (ring + 1) * sides;
+            if( ring > 0 ) *el++ = MeshData::RESTART_INDEX;
+            *el++ = nextRingStart;
+            *el++ = nextRingStart;
+            for( int side = 0; side < sides; side++ ) {
+                *el++ = ringStart + side;
+                *el++ = nextRingStart + (side + 1) % sides;
+            }
+            *el++ = ringStart;
+        }
+        data.indices.resize(el - &data.indices[0]);
+    } else if( optimizeVertexCache ) {
+        MeshOptimizer::optimizeVertexCache(&data.indices[0], 6 * faces, nVerts);
+    }
+    data.computeBounds();
 }
 
 void VBOTorus::generateVerts(float * verts, float * norms, float * tex,
                              unsigned int * el,
-                             float outerRadius, float innerRadius)
+                             float outerRadius, float innerRadius,
+                             int rings, int sides)
 {
     float ringFactor  = (float)(TWOPI / rings);
     float sideFactor = (float)(TWOPI / sides);
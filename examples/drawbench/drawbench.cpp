@@ -0,0 +1,1072 @@
+// drawbench.cpp
+// GPU benchmarks for the Drawables in common.  Opens a window for the GL
+// context; run without arguments for a list of the available benchmarks.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <GL/glew.h>
+#include <GL/glfw.h>
+
+#include "StopWatch.h"
+#include "glslprogram.h"
+#include "vboplane.h"
+#include "vbotorus.h"
+#include "vboteapot.h"
+#include "vboteapotpatches.h"
+#include "vbomesh.h"
+#include "vbocube.h"
+#include "geometrycache.h"
+#include "instancebuffer.h"
+#include "drawbatch.h"
+#include "bufferallocator.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+using glm::mat4;
+using glm::vec2;
+using glm::vec3;
+
+static const char * defaultObj = "../normalmap/bs_ears.obj";
+
+static void compileAndLinkShader( GLSLProgram & prog, const char * vs, const char * fs,
+                                  const char * tcs = NULL, const char * tes = NULL )
+{
+    if( ! prog.compileShaderFromFile(vs,GLSLShader::VERTEX) )
+    {
+        printf("Vertex shader failed to compile!\n%s",
+               prog.log().c_str());
+        exit(1);
+    }
+    if( ! prog.compileShaderFromFile(fs,GLSLShader::FRAGMENT))
+    {
+        printf("Fragment shader failed to compile!\n%s",
+               prog.log().c_str());
+        exit(1);
+    }
+    if( tes && ! prog.compileShaderFromFile(tes,GLSLShader::TESS_EVALUATION))
+    {
+        printf("Tess evaluation shader failed to compile!\n%s",
+               prog.log().c_str());
+        exit(1);
+    }
+    if( tcs && ! prog.compileShaderFromFile(tcs,GLSLShader::TESS_CONTROL))
+    {
+        printf("Tess control shader failed to compile!\n%s",
+               prog.log().c_str());
+        exit(1);
+    }
+    if( ! prog.link() )
+    {
+        printf("Shader program failed to link!\n%s",
+               prog.log().c_str());
+        exit(1);
+    }
+
+    prog.use();
+}
+
+// Average seconds per call of drawable->render(), synchronized with
+// glFinish so that the GPU work is included
+static float timeDraws( const Drawable * drawable, int iterations )
+{
+    drawable->render();
+    glFinish();
+
+    CStopWatch timer;
+    for( int i = 0; i < iterations; i++ ) {
+        drawable->render();
+    }
+    glFinish();
+    return timer.GetElapsedSeconds() / iterations;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Vertex throughput of the split (one buffer per attribute) and
+// interleaved layouts.  Rasterization is switched off so that the time
+// is spent fetching and transforming vertices.
+
+static void reportLayout( const char * name, const Drawable * split,
+                          const Drawable * interleaved, unsigned int nIndices, int iterations )
+{
+    float splitTime = timeDraws(split, iterations);
+    float interleavedTime = timeDraws(interleaved, iterations);
+
+    printf(" %-16s %9u %10.3f %10.3f %10.1f %10.1f %7.2fx\n", name, nIndices,
+           splitTime * 1000.0f, interleavedTime * 1000.0f,
+           nIndices / splitTime * 1e-6f, nIndices / interleavedTime * 1e-6f,
+           splitTime / interleavedTime);
+}
+
+static int benchLayout( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int iterations = argc > 1 ? atoi(argv[1]) : 100;
+    if( iterations < 1 ) iterations = 1;
+
+    GLSLProgram prog;
+    compileAndLinkShader(prog, "drawbench.vs", "drawbench.fs");
+    prog.setUniform("MVP", mat4(1.0f));
+
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    printf("Vertex layout, %d draws each, rasterizer discard\n", iterations);
+    printf(" %-16s %9s %10s %10s %10s %10s %8s\n", "mesh", "indices",
+           "split ms", "inter ms", "split M/s", "inter M/s", "speedup");
+
+    {
+        int rings = 256, sides = 256;
+        VBOTorus split(0.7f, 0.3f, sides, rings, true, Drawable::SPLIT_BUFFERS);
+        VBOTorus interleaved(0.7f, 0.3f, sides, rings, true, Drawable::INTERLEAVED);
+        reportLayout("torus 256x256", &split, &interleaved, 6 * rings * sides, iterations);
+    }
+
+    {
+        int grid = 64;
+        VBOTeapot split(grid, mat4(1.0f), true, Drawable::SPLIT_BUFFERS);
+        VBOTeapot interleaved(grid, mat4(1.0f), true, Drawable::INTERLEAVED);
+        reportLayout("teapot 64", &split, &interleaved, 6 * 32 * grid * grid, iterations);
+    }
+
+    {
+        int divs = 256;
+        VBOPlane split(10.0f, 10.0f, divs, divs, Drawable::SPLIT_BUFFERS);
+        VBOPlane interleaved(10.0f, 10.0f, divs, divs, Drawable::INTERLEAVED);
+        reportLayout("plane 256x256", &split, &interleaved, 6 * divs * divs, iterations);
+    }
+
+    {
+        VBOMesh::Options options;
+        options.optimizeVertexCache = true;
+        MeshCache data;
+        if( ! VBOMesh::loadVertexData(fileName, options, data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+        options.layout = Drawable::SPLIT_BUFFERS;
+        VBOMesh split(fileName, options);
+        options.layout = Drawable::INTERLEAVED;
+        VBOMesh interleaved(fileName, options);
+        const char * base = strrchr(fileName, '/');
+        reportLayout(base ? base + 1 : fileName, &split, &interleaved, data.indexCount(), iterations);
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Vertex memory and throughput with 32 bit float attributes against the
+// packed formats (10:10:10:2 normals, half float texture coordinates and
+// 16 bit positions).  Both use the interleaved layout.
+
+static void reportCompression( const char * name, const Drawable * plain,
+                               const Drawable * packed, unsigned int nIndices, int iterations )
+{
+    float plainTime = timeDraws(plain, iterations);
+    float packedTime = timeDraws(packed, iterations);
+
+    printf(" %-16s %9u %9u %9u %10.3f %10.3f %7.2fx\n", name, nIndices,
+           plain->getVertexBytes() / 1024, packed->getVertexBytes() / 1024,
+           plainTime * 1000.0f, packedTime * 1000.0f, plainTime / packedTime);
+}
+
+static int benchCompression( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int iterations = argc > 1 ? atoi(argv[1]) : 100;
+    if( iterations < 1 ) iterations = 1;
+
+    GLSLProgram prog;
+    compileAndLinkShader(prog, "drawbench.vs", "drawbench.fs");
+    prog.setUniform("MVP", mat4(1.0f));
+
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    printf("Vertex compression, %d draws each, rasterizer discard\n", iterations);
+    printf(" %-16s %9s %9s %9s %10s %10s %8s\n", "mesh", "indices",
+           "float KB", "packed KB", "float ms", "packed ms", "speedup");
+
+    {
+        int rings = 256, sides = 256;
+        VBOTorus plain(0.7f, 0.3f, sides, rings, true, Drawable::INTERLEAVED);
+        VBOTorus packed(0.7f, 0.3f, sides, rings, true, Drawable::INTERLEAVED, Drawable::COMPRESS_ALL);
+        reportCompression("torus 256x256", &plain, &packed, 6 * rings * sides, iterations);
+    }
+
+    {
+        int grid = 64;
+        VBOTeapot plain(grid, mat4(1.0f), true, Drawable::INTERLEAVED);
+        VBOTeapot packed(grid, mat4(1.0f), true, Drawable::INTERLEAVED, Drawable::COMPRESS_ALL);
+        reportCompression("teapot 64", &plain, &packed, 6 * 32 * grid * grid, iterations);
+    }
+
+    {
+        VBOMesh::Options options;
+        options.optimizeVertexCache = true;
+        MeshCache data;
+        if( ! VBOMesh::loadVertexData(fileName, options, data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+        VBOMesh plain(fileName, options);
+        options.compression = Drawable::COMPRESS_ALL;
+        VBOMesh packed(fileName, options);
+        const char * base = strrchr(fileName, '/');
+        reportCompression(base ? base + 1 : fileName, &plain, &packed, data.indexCount(), iterations);
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The teapot tessellated on the GPU from its control points, with levels
+// chosen per patch from its size on screen, against the CPU tessellated
+// VBOTeapot at fixed grids.  The camera backs away from the teapot;
+// triangle counts come from a GL_PRIMITIVES_GENERATED query.
+
+static int benchTess( int argc, char * argv[] )
+{
+    float pixelsPerEdge = argc > 0 ? (float)atof(argv[0]) : 8.0f;
+    int iterations = argc > 1 ? atoi(argv[1]) : 100;
+    int maxLevel = argc > 2 ? atoi(argv[2]) : 64;
+    if( pixelsPerEdge <= 0.0f ) pixelsPerEdge = 8.0f;
+    if( iterations < 1 ) iterations = 1;
+
+    if( ! GLEW_VERSION_4_0 ) {
+        fprintf(stderr, "Tessellation shaders need OpenGL 4.0\n");
+        return EXIT_FAILURE;
+    }
+
+    GLint glMaxLevel;
+    glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &glMaxLevel);
+    if( maxLevel > glMaxLevel ) maxLevel = glMaxLevel;
+    if( maxLevel < 1 ) maxLevel = 1;
+
+    // Levels depend on the viewport, so use a fixed one rather than the window's
+    const int width = 1280, height = 720;
+
+    GLSLProgram gridProg, patchProg;
+    compileAndLinkShader(gridProg, "drawbench.vs", "drawbench.fs");
+    compileAndLinkShader(patchProg, "../phongTeapot/teapotpatch.vs",
+                         "../phongTeapot/teapotpatch.frag", "../phongTeapot/teapotpatch.tcs",
+                         "../phongTeapot/teapotpatch.tes");
+    patchProg.setUniform("ViewportSize", vec2((float)width, (float)height));
+    patchProg.setUniform("PixelsPerEdge", pixelsPerEdge);
+    patchProg.setUniform("MaxTessLevel", (float)maxLevel);
+
+    VBOTeapotPatches patches(mat4(1.0f));
+    VBOTeapot grid14(14, mat4(1.0f), true);
+    VBOTeapot grid64(64, mat4(1.0f), true);
+
+    GLuint query;
+    glGenQueries(1, &query);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    printf("Teapot, %dx%d viewport, %g pixels per edge, levels up to %d, %d draws each, "
+           "rasterizer discard\n", width, height, pixelsPerEdge, maxLevel, iterations);
+    printf(" vertex data: patches %u bytes, grid 14 %u bytes, grid 64 %u bytes\n",
+           patches.getVertexBytes(), grid14.getVertexBytes(), grid64.getVertexBytes());
+    printf(" %8s %10s %10s %10s %10s\n", "distance", "triangles", "tess ms", "grid14 ms", "grid64 ms");
+
+    mat4 projection = glm::perspective(60.0f, (float)width / height, 0.3f, 1000.0f);
+    mat4 model = glm::rotate(mat4(1.0f), -90.0f, vec3(1.0f, 0.0f, 0.0f));
+    for( float distance = 4.0f; distance <= 256.0f; distance *= 2.0f ) {
+        mat4 view = glm::lookAt(vec3(0.0f, 0.5f * distance, distance), vec3(0.0f, 0.75f, 0.0f),
+                                vec3(0.0f, 1.0f, 0.0f));
+        mat4 mv = view * model;
+        mat4 mvp = projection * mv;
+
+        patchProg.use();
+        patchProg.setUniform("ModelViewMatrix", mv);
+        patchProg.setUniform("NormalMatrix", mat3(vec3(mv[0]), vec3(mv[1]), vec3(mv[2])));
+        patchProg.setUniform("MVP", mvp);
+        glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+        patches.render();
+        glEndQuery(GL_PRIMITIVES_GENERATED);
+        GLuint triangles;
+        glGetQueryObjectuiv(query, GL_QUERY_RESULT, &triangles);
+        float tessTime = timeDraws(&patches, iterations);
+
+        gridProg.use();
+        gridProg.setUniform("MVP", mvp);
+        float grid14Time = timeDraws(&grid14, iterations);
+        float grid64Time = timeDraws(&grid64, iterations);
+
+        printf(" %8g %10u %10.3f %10.3f %10.3f\n", distance, triangles,
+               tessTime * 1000.0f, grid14Time * 1000.0f, grid64Time * 1000.0f);
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    glDeleteQueries(1, &query);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Switching between the geometry of several example scenes, each switch
+// building what the next scene needs and drawing it once: constructing
+// every shape again against taking it from a GeometryCache.  The second
+// cached run has a budget too small for all the scenes, so it evicts.
+
+// The shapes of edge, cartoon, rendertotex and normalmap, in that order
+static const int sceneCount = 4;
+
+static void buildScene( int scene, const char * fileName, vector<Drawable *> & shapes )
+{
+    VBOMesh::Options options;
+    options.lodLevels = 3;
+    switch( scene ) {
+    case 0:
+        shapes.push_back(new VBOPlane(50.0f, 50.0f, 1, 1));
+        shapes.push_back(new VBOTeapot(14, mat4(1.0f)));
+        shapes.push_back(new VBOTorus(0.7f * 1.5f, 0.3f * 1.5f, 50, 50));
+        break;
+    case 1:
+        shapes.push_back(new VBOPlane(50.0f, 50.0f, 1, 1));
+        shapes.push_back(new VBOTeapot(14, mat4(1.0f)));
+        shapes.push_back(new VBOTorus(1.75f * 0.75f, 0.75f * 0.75f, 50, 50));
+        break;
+    case 2:
+        shapes.push_back(new VBOPlane(50.0f, 50.0f, 1, 1));
+        shapes.push_back(new VBOCube());
+        shapes.push_back(new VBOTeapot(14, mat4(1.0f)));
+        break;
+    default:
+        shapes.push_back(new VBOCube());
+        shapes.push_back(new VBOMesh(fileName, options));
+        break;
+    }
+}
+
+static void acquireScene( int scene, const char * fileName, GeometryCache & cache,
+                          vector<Drawable *> & shapes )
+{
+    VBOMesh::Options options;
+    options.lodLevels = 3;
+    switch( scene ) {
+    case 0:
+        shapes.push_back(cache.plane(50.0f, 50.0f, 1, 1));
+        shapes.push_back(cache.teapot(14, mat4(1.0f)));
+        shapes.push_back(cache.torus(0.7f * 1.5f, 0.3f * 1.5f, 50, 50));
+        break;
+    case 1:
+        shapes.push_back(cache.plane(50.0f, 50.0f, 1, 1));
+        shapes.push_back(cache.teapot(14, mat4(1.0f)));
+        shapes.push_back(cache.torus(1.75f * 0.75f, 0.75f * 0.75f, 50, 50));
+        break;
+    case 2:
+        shapes.push_back(cache.plane(50.0f, 50.0f, 1, 1));
+        shapes.push_back(cache.cube());
+        shapes.push_back(cache.teapot(14, mat4(1.0f)));
+        break;
+    default:
+        shapes.push_back(cache.cube());
+        shapes.push_back(cache.mesh(fileName, options));
+        break;
+    }
+}
+
+static void drawScene( const vector<Drawable *> & shapes )
+{
+    for( size_t i = 0; i < shapes.size(); i++ ) shapes[i]->render();
+    glFinish();
+}
+
+static void timeCachedSwitches( GeometryCache & cache, const char * fileName, int cycles,
+                                float & seconds )
+{
+    // The next scene's shapes are taken before the last scene's are
+    // released, so that what they share is never evicted in between
+    vector<Drawable *> shapes, previous;
+    CStopWatch timer;
+    for( int i = 0; i < cycles * sceneCount; i++ ) {
+        shapes.swap(previous);
+        shapes.clear();
+        acquireScene(i % sceneCount, fileName, cache, shapes);
+        for( size_t s = 0; s < previous.size(); s++ ) cache.release(previous[s]);
+        drawScene(shapes);
+    }
+    for( size_t s = 0; s < shapes.size(); s++ ) cache.release(shapes[s]);
+    seconds = timer.GetElapsedSeconds();
+}
+
+static void reportGeometryCache( const char * name, float seconds, int switches,
+                                 const GeometryCache * cache )
+{
+    printf(" %-20s %10.3f", name, seconds * 1000.0f / switches);
+    if( cache ) {
+        GeometryCache::Stats stats = cache->stats();
+        printf(" %6u %6u %9u %8u %9.1f", stats.hits, stats.misses, stats.evictions,
+               stats.entries, stats.bytes / 1024.0f);
+    }
+    printf("\n");
+}
+
+static int benchGeometryCache( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int cycles = argc > 1 ? atoi(argv[1]) : 20;
+    if( cycles < 1 ) cycles = 1;
+    int switches = cycles * sceneCount;
+
+    {
+        MeshCache data;
+        if( ! VBOMesh::loadVertexData(fileName, VBOMesh::Options(), data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+    }
+
+    GLSLProgram prog;
+    compileAndLinkShader(prog, "drawbench.vs", "drawbench.fs");
+    prog.setUniform("MVP", mat4(1.0f));
+
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    printf("Scene switches through %d scenes, %d cycles, rasterizer discard\n", sceneCount, cycles);
+    printf(" %-20s %10s %6s %6s %9s %8s %9s\n", "geometry", "ms/switch", "hits", "misses",
+           "evictions", "entries", "KB");
+
+    CStopWatch timer;
+    for( int i = 0; i < switches; i++ ) {
+        vector<Drawable *> shapes;
+        buildScene(i % sceneCount, fileName, shapes);
+        drawScene(shapes);
+        for( size_t s = 0; s < shapes.size(); s++ ) delete shapes[s];
+    }
+    reportGeometryCache("rebuilt every switch", timer.GetElapsedSeconds(), switches, NULL);
+
+    float seconds = 0.0f;
+    size_t total;
+    {
+        GeometryCache cache;
+        timeCachedSwitches(cache, fileName, cycles, seconds);
+        reportGeometryCache("cached", seconds, switches, &cache);
+        total = cache.stats().bytes;
+    }
+
+    {
+        // Half of what the scenes use between them, so switches evict
+        GeometryCache cache(total / 2);
+        timeCachedSwitches(cache, fileName, cycles, seconds);
+        reportGeometryCache("cached, half budget", seconds, switches, &cache);
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A crowd of identical props drawn the way the example scenes draw each
+// object (matrix and material uniforms, then render()) against one
+// renderInstanced() call fed by an InstanceBuffer, with the edge and phong
+// shaders and their instanced variants.  The two frames are read back
+// and compared.
+
+static const int crowdMaterials = 4;
+
+static void setCrowdMaterial( GLSLProgram & prog, const char * prefix, int m )
+{
+    static const float kd[crowdMaterials][3] = {
+        { 0.9f, 0.9f, 0.9f }, { 0.4f, 0.4f, 0.4f }, { 0.9f, 0.5f, 0.2f }, { 0.2f, 0.5f, 0.9f }
+    };
+    char name[64];
+    sprintf(name, "%s.Kd", prefix);
+    prog.setUniform(name, kd[m][0], kd[m][1], kd[m][2]);
+    sprintf(name, "%s.Ks", prefix);
+    prog.setUniform(name, 0.95f, 0.95f, 0.95f);
+    sprintf(name, "%s.Ka", prefix);
+    prog.setUniform(name, 0.1f, 0.1f, 0.1f);
+    sprintf(name, "%s.Shininess", prefix);
+    prog.setUniform(name, 100.0f);
+}
+
+static vector<unsigned char> readFrame( int width, int height )
+{
+    vector<unsigned char> pixels(width * height * 3);
+    glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+    return pixels;
+}
+
+// One frame of the crowd, without clearing.  Per object draws use prog.
+static void drawCrowd( GLSLProgram & prog, const Drawable & prop,
+                       const vector<InstanceBuffer::Instance> & instances,
+                       const mat4 & view, const mat4 & projection, bool instanced )
+{
+    if( instanced ) {
+        prop.renderInstanced((int)instances.size());
+        return;
+    }
+    for( size_t i = 0; i < instances.size(); i++ ) {
+        mat4 mv = view * instances[i].model;
+        prog.setUniform("ModelViewMatrix", mv);
+        prog.setUniform("NormalMatrix", mat3(vec3(mv[0]), vec3(mv[1]), vec3(mv[2])));
+        prog.setUniform("MVP", projection * mv);
+        setCrowdMaterial(prog, "Material", instances[i].material);
+        prop.render();
+    }
+}
+
+static int benchInstanced( int argc, char * argv[] )
+{
+    int count = argc > 0 ? atoi(argv[0]) : 1000;
+    int frames = argc > 1 ? atoi(argv[1]) : 100;
+    if( count < 1 ) count = 1;
+    if( frames < 1 ) frames = 1;
+
+    const int width = 800, height = 600;
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // The props stand on a square grid, seen from above
+    int side = 1;
+    while( side * side < count ) side++;
+    mat4 view = glm::lookAt(vec3(0.0f, 1.2f * side, 0.8f * side), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    mat4 projection = glm::perspective(60.0f, (float)width / height, 0.3f, 4.0f * side);
+    vector<InstanceBuffer::Instance> instances(count);
+    for( int i = 0; i < count; i++ ) {
+        vec3 position(1.5f * (i % side - 0.5f * side), 0.0f, 1.5f * (i / side - 0.5f * side));
+        instances[i].model = glm::translate(mat4(1.0f), position) *
+                glm::rotate(mat4(1.0f), -90.0f, vec3(1.0f, 0.0f, 0.0f)) *
+                glm::rotate(mat4(1.0f), 37.0f * i, vec3(0.0f, 0.0f, 1.0f));
+        instances[i].material = i % crowdMaterials;
+    }
+
+    VBOTeapot prop(4, mat4(1.0f));
+    InstanceBuffer instanceBuffer;
+    instanceBuffer.update(&instances[0], count);
+    prop.attachInstances(instanceBuffer);
+
+    const char * shaders[2][4] = {
+        { "../edge/edge.vs", "../edge/edge.fs", "../edge/edgeinstanced.vs", "../edge/edgeinstanced.fs" },
+        { "../phongTeapot/phong.vert", "../phongTeapot/phong.frag",
+          "../phongTeapot/phonginstanced.vert", "../phongTeapot/phong.frag" }
+    };
+    const char * names[2] = { "edge", "phong" };
+
+    printf("%d teapot props (%u bytes of instance data), mean of %d frames, rasterizer discard\n",
+           count, (unsigned int)(count * sizeof(InstanceBuffer::Instance)), frames);
+    printf(" %-8s %10s %10s %8s %12s\n", "shaders", "draws ms", "inst ms", "speedup", "pixels diff");
+
+    for( int s = 0; s < 2; s++ ) {
+        GLSLProgram single, instanced;
+        compileAndLinkShader(single, shaders[s][0], shaders[s][1]);
+        compileAndLinkShader(instanced, shaders[s][2], shaders[s][3]);
+        GLSLProgram * progs[2] = { &single, &instanced };
+        for( int p = 0; p < 2; p++ ) {
+            progs[p]->use();
+            progs[p]->setUniform("Light.Position", view * vec4(0.0f, 10.0f, 0.0f, 1.0f));
+            progs[p]->setUniform("Light.Intensity", vec3(1.0f));
+            progs[p]->setUniform("Light.La", vec3(0.4f));
+            progs[p]->setUniform("Light.Ld", vec3(1.0f));
+            progs[p]->setUniform("Light.Ls", vec3(1.0f));
+        }
+        instanced.use();
+        instanced.setUniform("ViewMatrix", view);
+        instanced.setUniform("ProjectionMatrix", projection);
+        for( int m = 0; m < crowdMaterials; m++ ) {
+            char prefix[32];
+            sprintf(prefix, "Materials[%d]", m);
+            setCrowdMaterial(instanced, prefix, m);
+        }
+
+        // The edge fragment shader picks its pass with a subroutine, which
+        // is reset whenever the program is used
+        GLuint pass1[2];
+        for( int p = 0; p < 2; p++ ) {
+            pass1[p] = glGetSubroutineIndex(progs[p]->getHandle(), GL_FRAGMENT_SHADER, "pass1");
+        }
+
+        float seconds[2];
+        vector<unsigned char> frame[2];
+        for( int p = 0; p < 2; p++ ) {
+            progs[p]->use();
+            if( pass1[p] != GL_INVALID_INDEX ) glUniformSubroutinesuiv(GL_FRAGMENT_SHADER, 1, &pass1[p]);
+
+            // Timed with rasterization off, to measure submission and
+            // vertex work, then one frame drawn for the comparison
+            glEnable(GL_RASTERIZER_DISCARD);
+            drawCrowd(single, prop, instances, view, projection, p == 1);
+            glFinish();
+            CStopWatch timer;
+            for( int f = 0; f < frames; f++ ) {
+                drawCrowd(single, prop, instances, view, projection, p == 1);
+            }
+            glFinish();
+            seconds[p] = timer.GetElapsedSeconds() / frames;
+            glDisable(GL_RASTERIZER_DISCARD);
+
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawCrowd(single, prop, instances, view, projection, p == 1);
+            frame[p] = readFrame(width, height);
+        }
+
+        // Matrices multiplied on the GPU round differently, so a few edge
+        // pixels may differ
+        unsigned int different = 0;
+        for( size_t i = 0; i < frame[0].size(); i += 3 ) {
+            if( memcmp(&frame[0][i], &frame[1][i], 3) != 0 ) different++;
+        }
+        printf(" %-8s %10.3f %10.3f %7.2fx %12u\n", names[s], seconds[0] * 1000.0f,
+               seconds[1] * 1000.0f, seconds[0] / seconds[1], different);
+    }
+
+    glDisable(GL_DEPTH_TEST);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// A draw call bound scene: thousands of small objects of four shapes, each
+// with its own matrix and material.  Drawn the way the example scenes do
+// (uniforms, then render() binding the shape's VAO) against a DrawBatch
+// submitting the frame as one glMultiDrawElementsIndirect.  Submit is the
+// CPU time to issue a frame, frame includes waiting for the GPU.
+
+static int benchBatch( int argc, char * argv[] )
+{
+    int count = argc > 0 ? atoi(argv[0]) : 5000;
+    int frames = argc > 1 ? atoi(argv[1]) : 50;
+    if( count < 1 ) count = 1;
+    if( frames < 1 ) frames = 1;
+
+    if( ! GLEW_VERSION_4_3 ) {
+        fprintf(stderr, "glMultiDrawElementsIndirect and storage buffers need OpenGL 4.3\n");
+        return EXIT_FAILURE;
+    }
+
+    const int width = 800, height = 600;
+    glViewport(0, 0, width, height);
+    glEnable(GL_DEPTH_TEST);
+    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+
+    // The shapes, as Drawables and as meshes of one batch
+    const int nShapes = 4;
+    MeshData data;
+    DrawBatch batch;
+    VBOCube::generate(data);
+    batch.add(data);
+    VBOTorus::generate(data, 0.35f, 0.15f, 8, 8);
+    batch.add(data);
+    VBOTeapot::generate(data, 2, mat4(1.0f));
+    batch.add(data);
+    VBOPlane::generate(data, 0.8f, 0.8f, 1, 1);
+    batch.add(data);
+    VBOCube cube;
+    VBOTorus torus(0.35f, 0.15f, 8, 8);
+    VBOTeapot teapot(2, mat4(1.0f));
+    VBOPlane plane(0.8f, 0.8f, 1, 1);
+    const Drawable * shapes[nShapes] = { &cube, &torus, &teapot, &plane };
+
+    int side = 1;
+    while( side * side < count ) side++;
+    mat4 view = glm::lookAt(vec3(0.0f, 0.9f * side, 0.6f * side), vec3(0.0f), vec3(0.0f, 1.0f, 0.0f));
+    mat4 projection = glm::perspective(60.0f, (float)width / height, 0.3f, 4.0f * side);
+    vector<mat4> models(count);
+    for( int i = 0; i < count; i++ ) {
+        vec3 position(i % side - 0.5f * side, 0.0f, i / side - 0.5f * side);
+        float scale = (i % nShapes == 2) ? 0.3f : 1.0f;
+        models[i] = glm::translate(mat4(1.0f), position) *
+                glm::rotate(mat4(1.0f), 37.0f * i, vec3(0.0f, 1.0f, 0.0f)) *
+                glm::scale(mat4(1.0f), vec3(scale));
+    }
+
+    GLSLProgram single, batched;
+    compileAndLinkShader(single, "../phongTeapot/phong.vert", "../phongTeapot/phong.frag");
+    compileAndLinkShader(batched, "batch.vs", "../phongTeapot/phong.frag");
+    GLSLProgram * progs[2] = { &single, &batched };
+    for( int p = 0; p < 2; p++ ) {
+        progs[p]->use();
+        progs[p]->setUniform("Light.Position", view * vec4(0.0f, 10.0f, 0.0f, 1.0f));
+        progs[p]->setUniform("Light.La", vec3(0.4f));
+        progs[p]->setUniform("Light.Ld", vec3(1.0f));
+        progs[p]->setUniform("Light.Ls", vec3(1.0f));
+    }
+    batched.setUniform("ViewMatrix", view);
+    batched.setUniform("ProjectionMatrix", projection);
+    for( int m = 0; m < crowdMaterials; m++ ) {
+        char prefix[32];
+        sprintf(prefix, "Materials[%d]", m);
+        setCrowdMaterial(batched, prefix, m);
+    }
+
+    printf("%d objects of %d shapes (batch geometry %u KB), mean of %d frames, rasterizer discard\n",
+           count, nShapes, (unsigned int)(batch.geometryBytes() / 1024), frames);
+    printf(" %-12s %10s %10s %12s\n", "submission", "submit ms", "frame ms", "pixels diff");
+
+    const char * names[2] = { "per object", "multi draw" };
+    vector<unsigned char> frame[2];
+    for( int p = 0; p < 2; p++ ) {
+        progs[p]->use();
+        float submitTime = 0.0f, frameTime = 0.0f;
+        CStopWatch timer;
+        for( int f = -1; f < frames; f++ ) {
+            // Frame -1 warms up and f == frames - 1 is drawn for the comparison
+            bool timed = f >= 0 && f < frames - 1;
+            bool shown = f == frames - 1;
+            if( shown ) {
+                glDisable(GL_RASTERIZER_DISCARD);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            } else {
+                glEnable(GL_RASTERIZER_DISCARD);
+            }
+            glFinish();
+            timer.Reset();
+
+            for( int i = 0; i < count; i++ ) {
+                int shape = i % nShapes;
+                unsigned int material = (unsigned int)(i % crowdMaterials);
+                if( p == 1 ) {
+                    batch.draw(shape, models[i], material);
+                    continue;
+                }
+                mat4 mv = view * models[i];
+                single.setUniform("ModelViewMatrix", mv);
+                single.setUniform("NormalMatrix", mat3(vec3(mv[0]), vec3(mv[1]), vec3(mv[2])));
+                single.setUniform("MVP", projection * mv);
+                setCrowdMaterial(single, "Material", material);
+                shapes[shape]->render();
+            }
+            if( p == 1 ) batch.render();
+
+            float submitted = timer.GetElapsedSeconds();
+            glFinish();
+            if( timed ) {
+                submitTime += submitted;
+                frameTime += timer.GetElapsedSeconds();
+            }
+        }
+        frame[p] = readFrame(width, height);
+        int timedFrames = frames > 1 ? frames - 1 : 1;
+        submitTime /= timedFrames;
+        frameTime /= timedFrames;
+
+        unsigned int different = 0;
+        if( p == 1 ) {
+            for( size_t i = 0; i < frame[0].size(); i += 3 ) {
+                if( memcmp(&frame[0][i], &frame[1][i], 3) != 0 ) different++;
+            }
+        }
+        printf(" %-12s %10.3f %10.3f %12u\n", names[p], submitTime * 1000.0f,
+               frameTime * 1000.0f, different);
+    }
+
+    glDisable(GL_RASTERIZER_DISCARD);
+    glDisable(GL_DEPTH_TEST);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// What the Drawables leave in the shared BufferAllocator: the scenes of
+// the geometry cache benchmark rebuilt and deleted over and over, then a
+// pool of small shapes replaced one at a time in pseudo random order, so
+// that freed ranges land between live ones.  Stats are printed as they go;
+// the buffer count and the reserved storage should settle, not grow.
+
+static void reportAllocator( const char * label, int step )
+{
+    BufferAllocator::Stats stats = BufferAllocator::shared().stats();
+    printf(" %-10s %6d %7u %7u %9.1f %9.1f %6u %9.1f %6.1f%%\n", label, step, stats.buffers,
+           stats.allocations, stats.usedBytes / 1024.0f, stats.reservedBytes / 1024.0f,
+           stats.freeRanges, stats.largestFreeRange / 1024.0f, stats.fragmentation * 100.0f);
+}
+
+static Drawable * churnShape( unsigned int seed )
+{
+    int divisions = 4 + (int)(seed % 29);
+    switch( (seed / 29) % 3 ) {
+    case 0:  return new VBOTorus(0.7f, 0.3f, divisions, divisions);
+    case 1:  return new VBOPlane(1.0f, 1.0f, divisions, divisions);
+    default: return new VBOTeapot(1 + divisions / 4, mat4(1.0f));
+    }
+}
+
+static int benchBuffers( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int cycles = argc > 1 ? atoi(argv[1]) : 5;
+    if( cycles < 1 ) cycles = 1;
+    int poolSize = 64, replacements = 2000;
+
+    {
+        MeshCache data;
+        if( ! VBOMesh::loadVertexData(fileName, VBOMesh::Options(), data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+    }
+
+    GLSLProgram prog;
+    compileAndLinkShader(prog, "drawbench.vs", "drawbench.fs");
+    prog.setUniform("MVP", mat4(1.0f));
+    glEnable(GL_RASTERIZER_DISCARD);
+
+    printf("Shared buffer allocator, %u KB blocks\n",
+           (unsigned int)(BufferAllocator::shared().getBlockSize() / 1024));
+    printf(" %-10s %6s %7s %7s %9s %9s %6s %9s %7s\n", "", "step", "buffers", "ranges",
+           "used KB", "res. KB", "free", "max KB", "frag");
+
+    CStopWatch timer;
+    for( int c = 0; c < cycles; c++ ) {
+        for( int scene = 0; scene < sceneCount; scene++ ) {
+            vector<Drawable *> shapes;
+            buildScene(scene, fileName, shapes);
+            drawScene(shapes);
+            if( scene == sceneCount - 1 ) reportAllocator("scenes", c);
+            for( size_t s = 0; s < shapes.size(); s++ ) delete shapes[s];
+        }
+    }
+    float sceneSeconds = timer.GetElapsedSeconds();
+    reportAllocator("released", cycles);
+
+    vector<Drawable *> pool(poolSize);
+    unsigned int seed = 12345;
+    for( int i = 0; i < poolSize; i++ ) {
+        seed = seed * 1664525u + 1013904223u;
+        pool[i] = churnShape(seed >> 8);
+    }
+    reportAllocator("pool", 0);
+
+    timer.Reset();
+    for( int step = 1; step <= replacements; step++ ) {
+        seed = seed * 1664525u + 1013904223u;
+        int victim = (int)((seed >> 8) % poolSize);
+        delete pool[victim];
+        seed = seed * 1664525u + 1013904223u;
+        pool[victim] = churnShape(seed >> 8);
+        if( step % (replacements / 4) == 0 ) reportAllocator("churn", step);
+    }
+    glFinish();
+    float churnSeconds = timer.GetElapsedSeconds();
+
+    for( int i = 0; i < poolSize; i++ ) delete pool[i];
+    reportAllocator("released", replacements);
+
+    printf("%.3f ms per scene build, %.3f ms per replacement\n",
+           sceneSeconds * 1000.0f / (cycles * sceneCount), churnSeconds * 1000.0f / replacements);
+    glDisable(GL_RASTERIZER_DISCARD);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The CPU cost of the uniform updates the example scenes make for every
+// object (matrices, material, light) through the three ways of naming a
+// uniform: a glGetUniformLocation per call, as setUniform used to do; a
+// name looked up in the program's hash table; and a stored UniformHandle.
+// Then whole frames in which most of those calls repeat the value already
+// set, with and without the program's shadow values.  Nothing is drawn.
+
+static const int uniformsPerObject = 8;
+
+static const char * objectUniforms[uniformsPerObject] = {
+    "ModelViewMatrix", "NormalMatrix", "MVP", "Light.Position",
+    "Material.Kd", "Material.Ks", "Material.Ka", "Material.Shininess"
+};
+
+static void timeUniforms( GLSLProgram & prog, int objects, int mode, float & seconds )
+{
+    UniformHandle u[uniformsPerObject];
+    for( int n = 0; n < uniformsPerObject; n++ ) u[n] = prog.getUniformHandle(objectUniforms[n]);
+    GLuint programHandle = prog.getHandle();
+
+    CStopWatch timer;
+    for( int i = 0; i < objects; i++ ) {
+        float f = (float)(i % 97) * 0.01f;
+        mat4 mv = glm::translate(mat4(1.0f), vec3(f, 0.0f, -5.0f));
+        mat3 normal = mat3(vec3(mv[0]), vec3(mv[1]), vec3(mv[2]));
+        vec4 light(f, 5.0f, 2.0f, 1.0f);
+        if( mode == 0 ) {
+            glUniformMatrix4fv(glGetUniformLocation(programHandle, objectUniforms[0]), 1, GL_FALSE, &mv[0][0]);
+            glUniformMatrix3fv(glGetUniformLocation(programHandle, objectUniforms[1]), 1, GL_FALSE, &normal[0][0]);
+            glUniformMatrix4fv(glGetUniformLocation(programHandle, objectUniforms[2]), 1, GL_FALSE, &mv[0][0]);
+            glUniform4f(glGetUniformLocation(programHandle, objectUniforms[3]), light.x, light.y, light.z, light.w);
+            glUniform3f(glGetUniformLocation(programHandle, objectUniforms[4]), f, 0.9f, 0.9f);
+            glUniform3f(glGetUniformLocation(programHandle, objectUniforms[5]), 0.95f, f, 0.95f);
+            glUniform3f(glGetUniformLocation(programHandle, objectUniforms[6]), 0.1f, 0.1f, f);
+            glUniform1f(glGetUniformLocation(programHandle, objectUniforms[7]), 100.0f * f);
+        } else if( mode == 1 ) {
+            prog.setUniform(objectUniforms[0], mv);
+            prog.setUniform(objectUniforms[1], normal);
+            prog.setUniform(objectUniforms[2], mv);
+            prog.setUniform(objectUniforms[3], light);
+            prog.setUniform(objectUniforms[4], f, 0.9f, 0.9f);
+            prog.setUniform(objectUniforms[5], 0.95f, f, 0.95f);
+            prog.setUniform(objectUniforms[6], 0.1f, 0.1f, f);
+            prog.setUniform(objectUniforms[7], 100.0f * f);
+        } else {
+            prog.setUniform(u[0], mv);
+            prog.setUniform(u[1], normal);
+            prog.setUniform(u[2], mv);
+            prog.setUniform(u[3], light);
+            prog.setUniform(u[4], f, 0.9f, 0.9f);
+            prog.setUniform(u[5], 0.95f, f, 0.95f);
+            prog.setUniform(u[6], 0.1f, 0.1f, f);
+            prog.setUniform(u[7], 100.0f * f);
+        }
+    }
+    glFinish();
+    seconds = timer.GetElapsedSeconds();
+    if( mode == 0 ) prog.forgetUniformValues();
+}
+
+// Frames drawn the way the example scenes draw them: the light and the
+// material are sent again for every object, although the light never
+// moves and the objects come sorted by material.  Either raw glUniform
+// calls at locations looked up once, or setUniform, which skips the
+// repeats.
+static void timeUniformFrames( GLSLProgram & prog, int objects, int frames, bool shadowed,
+                               float & seconds, GLSLProgram::UniformStats & perFrame )
+{
+    static const float kd[crowdMaterials] = { 0.9f, 0.4f, 0.7f, 0.2f };
+    UniformHandle u[uniformsPerObject];
+    GLint loc[uniformsPerObject];
+    for( int n = 0; n < uniformsPerObject; n++ ) {
+        u[n] = prog.getUniformHandle(objectUniforms[n]);
+        loc[n] = glGetUniformLocation(prog.getHandle(), objectUniforms[n]);
+    }
+    vec4 light(0.0f, 5.0f, 2.0f, 1.0f);
+
+    perFrame.uploads = perFrame.skipped = 0;
+    CStopWatch timer;
+    for( int frame = 0; frame < frames; frame++ ) {
+        prog.resetUniformStats();
+        for( int i = 0; i < objects; i++ ) {
+            float f = (float)(i % 97) * 0.01f;
+            mat4 mv = glm::rotate(glm::translate(mat4(1.0f), vec3(f, 0.0f, -5.0f)),
+                                  (float)frame, vec3(0.0f, 1.0f, 0.0f));
+            mat3 normal = mat3(vec3(mv[0]), vec3(mv[1]), vec3(mv[2]));
+            float k = kd[i * crowdMaterials / objects];
+            if( shadowed ) {
+                prog.setUniform(u[0], mv);
+                prog.setUniform(u[1], normal);
+                prog.setUniform(u[2], mv);
+                prog.setUniform(u[3], light);
+                prog.setUniform(u[4], k, k, k);
+                prog.setUniform(u[5], 0.95f, 0.95f, 0.95f);
+                prog.setUniform(u[6], 0.1f, 0.1f, 0.1f);
+                prog.setUniform(u[7], 100.0f);
+            } else {
+                glUniformMatrix4fv(loc[0], 1, GL_FALSE, &mv[0][0]);
+                glUniformMatrix3fv(loc[1], 1, GL_FALSE, &normal[0][0]);
+                glUniformMatrix4fv(loc[2], 1, GL_FALSE, &mv[0][0]);
+                glUniform4f(loc[3], light.x, light.y, light.z, light.w);
+                glUniform3f(loc[4], k, k, k);
+                glUniform3f(loc[5], 0.95f, 0.95f, 0.95f);
+                glUniform3f(loc[6], 0.1f, 0.1f, 0.1f);
+                glUniform1f(loc[7], 100.0f);
+            }
+        }
+        GLSLProgram::UniformStats stats = prog.getUniformStats();
+        perFrame.uploads += stats.uploads;
+        perFrame.skipped += stats.skipped;
+    }
+    glFinish();
+    seconds = timer.GetElapsedSeconds();
+    if( shadowed ) {
+        perFrame.uploads /= frames;
+        perFrame.skipped /= frames;
+    } else {
+        perFrame.uploads = objects * uniformsPerObject;
+        prog.forgetUniformValues();
+    }
+}
+
+static int benchUniforms( int argc, char * argv[] )
+{
+    int objects = argc > 0 ? atoi(argv[0]) : 200000;
+    if( objects < 1 ) objects = 1;
+    int frames = argc > 1 ? atoi(argv[1]) : 20;
+    if( frames < 1 ) frames = 1;
+
+    GLSLProgram prog;
+    compileAndLinkShader(prog, "../phongTeapot/phong.vert", "../phongTeapot/phong.frag");
+
+    static const char * modes[] = { "glGetUniformLocation", "name, hash table", "UniformHandle" };
+    float seconds[3];
+    for( int mode = 0; mode < 3; mode++ ) timeUniforms(prog, objects, mode, seconds[mode]);
+
+    printf("%d objects, %d setUniform calls each\n", objects, uniformsPerObject);
+    printf(" %-22s %10s %8s\n", "uniform by", "ns/call", "speedup");
+    for( int mode = 0; mode < 3; mode++ ) {
+        printf(" %-22s %10.1f %7.2fx\n", modes[mode],
+               seconds[mode] * 1.0e9f / (objects * uniformsPerObject), seconds[0] / seconds[mode]);
+    }
+
+    int frameObjects = objects / frames > 0 ? objects / frames : 1;
+    printf("%d frames of %d objects, light and material re-sent per object\n", frames, frameObjects);
+    printf(" %-22s %10s %9s %9s %8s\n", "uniforms", "ms/frame", "uploads", "skipped", "speedup");
+    for( int shadowed = 0; shadowed < 2; shadowed++ ) {
+        GLSLProgram::UniformStats perFrame;
+        timeUniformFrames(prog, frameObjects, frames, shadowed != 0, seconds[shadowed], perFrame);
+        printf(" %-22s %10.3f %9u %9u %7.2fx\n", shadowed ? "setUniform, shadowed" : "glUniform",
+               seconds[shadowed] * 1000.0f / frames, perFrame.uploads, perFrame.skipped,
+               seconds[0] / seconds[shadowed]);
+    }
+    return EXIT_SUCCESS;
+}
+
+static void usage()
+{
+    printf("usage: drawbench <benchmark> [options]\n");
+    printf("  layout [file.obj] [iterations]  vertex throughput, split vs interleaved buffers\n");
+    printf("  compression [file.obj] [iterations]\n");
+    printf("                                  vertex memory and throughput, float vs packed\n");
+    printf("  tess [pixelsPerEdge] [iterations] [maxLevel]\n");
+    printf("                                  GPU tessellated teapot patches vs CPU grids\n");
+    printf("  geocache [file.obj] [cycles]    scene switches, rebuilt vs shared geometry cache\n");
+    printf("  instanced [count] [frames]      per object draws vs one instanced draw\n");
+    printf("  batch [count] [frames]          per object draws vs multi draw indirect batch\n");
+    printf("  buffers [file.obj] [cycles]     buffer allocator use as shapes come and go\n");
+    printf("  uniforms [objects] [frames]     setUniform cost by name lookup vs handle,\n");
+    printf("                                  and with repeated values skipped\n");
+}
+
+int main( int argc, char * argv[] )
+{
+    if( argc < 2 ) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    // Initialize GLFW
+    if( !glfwInit() )
+        exit( EXIT_FAILURE );
+
+    glfwOpenWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwOpenWindowHint(GLFW_OPENGL_VERSION_MAJOR, 3);
+    glfwOpenWindowHint(GLFW_OPENGL_VERSION_MINOR, 2);
+    glfwOpenWindowHint(GLFW_WINDOW_NO_RESIZE, GL_TRUE);
+
+    // Open an OpenGL window
+    if( !glfwOpenWindow( 800,600, 0,0,0,0,0,0, GLFW_WINDOW ) )
+    {
+        glfwTerminate();
+        exit( EXIT_FAILURE );
+    }
+
+    glewExperimental = GL_TRUE; //stops glew crashing on OSX :-/
+    GLenum err = glewInit();
+    if ( GLEW_OK != err) {
+        fprintf(stderr , "GLEW Error: %s\n" , glewGetErrorString (err));
+        exit( EXIT_FAILURE );
+    }
+
+    // No swap interval limit, the benchmarks synchronize with glFinish
+    glfwSwapInterval(0);
+
+    int result = EXIT_FAILURE;
+    if( strcmp(argv[1], "layout") == 0 ) result = benchLayout(argc - 2, argv + 2);
+    else if( strcmp(argv[1], "compression") == 0 ) result = benchCompression(argc - 2, argv + 2);
+    else if( strcmp(argv[1], "tess") == 0 ) result = benchTess(argc - 2, argv + 2);
+    else if( strcmp(argv[1], "geocache") == 0 ) result = benchGeometryCache(argc - 2, argv + 2);
+    else if( strcmp(argv[1], "instanced") == 0 ) result = benchInstanced(argc - 2, argv + 2);
+    else if( strcmp(argv[1], "batch") == 0 ) result = benchBatch(argc - 2, argv + 2);
+    else if( strcmp(argv[1], "buffers") == 0 ) result = benchBuffers(argc - 2, argv + 2);
+    else if( strcmp(argv[1], "uniforms") == 0 ) result = benchUniforms(argc - 2, argv + 2);
+    else usage();
+
+    glfwTerminate();
+    return result;
+}
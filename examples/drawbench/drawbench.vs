@@ -0,0 +1,17 @@
+#version 400
+
+layout (location = 0) in vec3 VertexPosition;
+layout (location = 1) in vec3 VertexNormal;
+layout (location = 2) in vec2 VertexTexCoord;
+
+out vec3 Color;
+
+uniform mat4 MVP;
+
+void main()
+{
+    // Use every attribute so that none of the fetches can be skipped
+    Color = VertexNormal * 0.5 + 0.5 + vec3(VertexTexCoord, 0.0);
+
+    gl_Position = MVP * vec4(VertexPosition,1.0);
+}
@@ -0,0 +1,31 @@
+#version 400
+
+// edge.vs for InstanceBuffer: the model matrix and material index come
+// from per instance attributes.  Drawing without an instance buffer (the
+// full-screen quad of pass 2) uses the current generic values of
+// attributes 4 to 7, which should then be set to the identity.
+
+layout (location = 0) in vec3 VertexPosition;
+layout (location = 1) in vec3 VertexNormal;
+layout (location = 2) in vec2 VertexTexCoord;
+layout (location = 4) in mat4 InstanceModel;
+layout (location = 8) in uint InstanceMaterial;
+
+out vec3 Position;
+out vec3 Normal;
+out vec2 TexCoord;
+flat out uint MaterialIndex;
+
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+
+void main()
+{
+    // Two matrix-vector products are cheaper than forming the model-view matrix
+    TexCoord = VertexTexCoord;
+    Normal = normalize( mat3(ViewMatrix) * (mat3(InstanceModel) * VertexNormal));
+    Position = vec3( ViewMatrix * (InstanceModel * vec4(VertexPosition,1.0)) );
+    MaterialIndex = InstanceMaterial;
+
+    gl_Position = ProjectionMatrix * vec4(Position,1.0);
+}
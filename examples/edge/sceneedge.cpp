@@ -19,7 +19,10 @@ void SceneEdge::initScene()
     glEnable(GL_DEPTH_TEST);
 
     plane = new VBOPlane(50.0f, 50.0f, 1, 1);
-    teapot = new VBOTeapot(14, mat4(1.0f));
+    // Untextured, so the seams can be welded whatever their texture
+    // coordinates
+    teapot = new VBOTeapot(14, mat4(1.0f), false, Drawable::SPLIT_BUFFERS,
+                           Drawable::NO_COMPRESSION, true, MeshData::TRIANGLES, false);
     float c = 1.5f;
     torus = new VBOTorus(0.7f * c, 0.3f * c, 50,50);
 
@@ -186,10 +189,10 @@ void SceneEdge::pass2()
 void SceneEdge::setMatrices()
 {
     mat4 mv = view * model;
-    prog.setUniform("ModelViewMatrix", mv);
-    prog.setUniform("NormalMatrix",
+    prog.setUniform(modelViewMatrix, mv);
+    prog.setUniform(normalMatrix,
                     mat3( vec3(mv[0]), vec3(mv[1]), vec3(mv[2]) ));
-    prog.setUniform("MVP", projection * mv);
+    prog.setUniform(mvpMatrix, projection * mv);
 }
 
 void SceneEdge::resize(int w, int h)
@@ -222,4 +225,8 @@ void SceneEdge::compileAndLinkShader()
     }
 
     prog.use();
+
+    modelViewMatrix = prog.getUniformHandle("ModelViewMatrix");
+    normalMatrix = prog.getUniformHandle("NormalMatrix");
+    mvpMatrix = prog.getUniformHandle("MVP");
 }
@@ -33,6 +33,9 @@ private:
     mat4 projection;
     float angle;
 
+    // Set for every object drawn, so looked up once at link time
+    UniformHandle modelViewMatrix, normalMatrix, mvpMatrix;
+
     void setMatrices();
     void compileAndLinkShader();
     void setupFBO();
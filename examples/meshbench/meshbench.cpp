@@ -0,0 +1,1123 @@
+// meshbench.cpp
+// Command line benchmarks for the CPU side of the mesh code in common.
+// Run without arguments for a list of the available benchmarks.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <thread>
+
+#include "StopWatch.h"
+#include "mappedfile.h"
+#include "objparser.h"
+#include "meshcache.h"
+#include "vbomesh.h"
+#include "vbotorus.h"
+#include "vboteapot.h"
+#include "vboteapotpatches.h"
+#include "vbocube.h"
+#include "vboplane.h"
+#include "meshoptimizer.h"
+#include "meshlets.h"
+#include "bvh.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+static const char * defaultObj = "../normalmap/bs_ears.obj";
+
+static double fileMegabytes( const char * fileName )
+{
+    MappedFile file;
+    if( ! file.open(fileName) ) return 0.0;
+    return file.size() / (1024.0 * 1024.0);
+}
+
+// Largest absolute difference between two attribute streams
+template <typename T>
+static float maxDifference( const vector<T> & a, const vector<T> & b )
+{
+    float diff = 0.0f;
+    for( size_t i = 0; i < a.size() && i < b.size(); i++ ) {
+        T d = glm::abs(a[i] - b[i]);
+        for( int c = 0; c < (int)sizeof(T) / (int)sizeof(float); c++ ) {
+            if( d[c] > diff ) diff = d[c];
+        }
+    }
+    return diff;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// OBJ parsing throughput: the original stream reader against the mapped one
+static int benchObj( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    if( iterations < 1 ) iterations = 1;
+
+    double mb = fileMegabytes(fileName);
+    if( mb <= 0.0 ) {
+        fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+
+    ObjData streamObj, mappedObj;
+    CStopWatch timer;
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) {
+        streamObj.clear();
+        ObjParser::parseStream(fileName, streamObj);
+    }
+    float streamTime = timer.GetElapsedSeconds() / iterations;
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) {
+        mappedObj.clear();
+        ObjParser::parseFile(fileName, mappedObj);
+    }
+    float mappedTime = timer.GetElapsedSeconds() / iterations;
+
+    printf("%s: %.2f MB, %d iterations\n", fileName, mb, iterations);
+    printf(" %-8s %10s %10s\n", "parser", "ms", "MB/s");
+    printf(" %-8s %10.2f %10.1f\n", "stream", streamTime * 1000.0f, mb / streamTime);
+    printf(" %-8s %10.2f %10.1f\n", "mapped", mappedTime * 1000.0f, mb / mappedTime);
+    printf(" speedup  %.2fx\n", streamTime / mappedTime);
+
+    bool sameCounts = streamObj.points.size() == mappedObj.points.size() &&
+                      streamObj.normals.size() == mappedObj.normals.size() &&
+                      streamObj.texCoords.size() == mappedObj.texCoords.size() &&
+                      streamObj.faces == mappedObj.faces;
+    printf(" results %s, max attribute difference %g\n",
+           sameCounts ? "match" : "DIFFER",
+           glm::max( maxDifference(streamObj.points, mappedObj.points),
+           glm::max( maxDifference(streamObj.normals, mappedObj.normals),
+                     maxDifference(streamObj.texCoords, mappedObj.texCoords) ) ) );
+
+    return sameCounts ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static bool sameData( const ObjData & a, const ObjData & b )
+{
+    return a.nFaces == b.nFaces && a.faces == b.faces &&
+           a.faceTexCoords == b.faceTexCoords && a.faceNormals == b.faceNormals &&
+           a.points.size() == b.points.size() &&
+           a.normals.size() == b.normals.size() &&
+           a.texCoords.size() == b.texCoords.size() &&
+           (a.points.empty() ||
+            memcmp(&a.points[0], &b.points[0], a.points.size() * sizeof(vec3)) == 0) &&
+           (a.normals.empty() ||
+            memcmp(&a.normals[0], &b.normals[0], a.normals.size() * sizeof(vec3)) == 0) &&
+           (a.texCoords.empty() ||
+            memcmp(&a.texCoords[0], &b.texCoords[0], a.texCoords.size() * sizeof(vec2)) == 0);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Chunked parallel parsing.  The file is repeated 'scale' times in memory
+// to stand in for larger assets (face indices still point at the first
+// copy, which is all the parser cares about).
+static int benchObjThreads( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int scale = argc > 1 ? atoi(argv[1]) : 10;
+    int iterations = argc > 2 ? atoi(argv[2]) : 3;
+    if( scale < 1 ) scale = 1;
+    if( iterations < 1 ) iterations = 1;
+
+    MappedFile file;
+    if( ! file.open(fileName) || file.size() == 0 ) {
+        fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+
+    vector<char> buffer;
+    buffer.reserve(file.size() * scale + scale);
+    for( int i = 0; i < scale; i++ ) {
+        buffer.insert(buffer.end(), file.data(), file.data() + file.size());
+        if( buffer.back() != '\n' ) buffer.push_back('\n');
+    }
+    const char * begin = &buffer[0];
+    const char * end = begin + buffer.size();
+    double mb = buffer.size() / (1024.0 * 1024.0);
+
+    int maxThreads = argc > 3 ? atoi(argv[3]) : (int)std::thread::hardware_concurrency();
+    if( maxThreads < 1 ) maxThreads = 1;
+
+    printf("%s x %d: %.1f MB, %d iterations, up to %d threads\n",
+           fileName, scale, mb, iterations, maxThreads);
+    printf(" %-8s %10s %10s %9s %s\n", "threads", "ms", "MB/s", "speedup", "output");
+
+    ObjData serial;
+    CStopWatch timer;
+    float serialTime = 0.0f;
+    bool allSame = true;
+
+    for( int threads = 1; ; threads = (threads * 2 < maxThreads) ? threads * 2 : maxThreads ) {
+        ObjData obj;
+        timer.Reset();
+        for( int i = 0; i < iterations; i++ ) {
+            obj.clear();
+            if( threads == 1 ) ObjParser::parseBuffer(begin, end, obj);
+            else ObjParser::parseBufferParallel(begin, end, obj, threads);
+        }
+        float t = timer.GetElapsedSeconds() / iterations;
+
+        bool same = true;
+        if( threads == 1 ) {
+            serial = obj;
+            serialTime = t;
+        } else {
+            same = sameData(serial, obj);
+            allSame = allSame && same;
+        }
+        printf(" %-8d %10.2f %10.1f %8.2fx %s\n", threads, t * 1000.0f, mb / t,
+               serialTime / t, threads == 1 ? "reference" : (same ? "identical" : "DIFFERS"));
+
+        if( threads == maxThreads ) break;
+    }
+
+    return allSame ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// VBOMesh start-up CPU cost: parsing and generating everything from the OBJ
+// file (no cache), a cache miss (same work plus writing the sidecar) and a
+// cache hit (hash the source, map and validate the sidecar).
+static int benchMeshCache( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    if( iterations < 1 ) iterations = 1;
+
+    string cacheName = string(fileName) + ".vbocache";
+    VBOMesh::Options plain, cached;
+    cached.useCache = true;
+
+    CStopWatch timer;
+    MeshCache data;
+    float coldTime = 0.0f, missTime = 0.0f, hitTime = 0.0f;
+    unsigned long long coldHash = 0, hitHash = 0;
+
+    for( int i = 0; i < iterations; i++ ) {
+        timer.Reset();
+        if( ! VBOMesh::loadVertexData(fileName, plain, data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+        coldTime += timer.GetElapsedSeconds();
+        coldHash = MeshCache::hash(data.vertices(), data.vertexCount() * data.stride() * sizeof(float));
+
+        remove(cacheName.c_str());
+        timer.Reset();
+        VBOMesh::loadVertexData(fileName, cached, data);
+        missTime += timer.GetElapsedSeconds();
+
+        timer.Reset();
+        VBOMesh::loadVertexData(fileName, cached, data);
+        hitTime += timer.GetElapsedSeconds();
+        if( ! data.isMapped() ) {
+            fprintf(stderr, "Cache was not used: %s\n", cacheName.c_str());
+            return EXIT_FAILURE;
+        }
+        hitHash = MeshCache::hash(data.vertices(), data.vertexCount() * data.stride() * sizeof(float));
+    }
+
+    printf("%s: %u vertices, %u triangles, %d iterations\n", fileName,
+           data.vertexCount(), data.indexCount() / 3, iterations);
+    printf(" %-12s %10s\n", "path", "ms");
+    printf(" %-12s %10.2f\n", "no cache", coldTime * 1000.0f / iterations);
+    printf(" %-12s %10.2f\n", "cache miss", missTime * 1000.0f / iterations);
+    printf(" %-12s %10.2f\n", "cache hit", hitTime * 1000.0f / iterations);
+    printf(" speedup      %.1fx, cached data %s\n", coldTime / hitTime,
+           coldHash == hitHash ? "identical" : "DIFFERS");
+
+    return coldHash == hitHash ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Post-transform cache efficiency of each index buffer before and after
+// MeshOptimizer::optimizeVertexCache
+
+static void reportVertexCache( const char * name, vector<unsigned int> & el, size_t nVerts )
+{
+    MeshOptimizer::VertexCacheStats before16 =
+            MeshOptimizer::analyzeVertexCache(&el[0], el.size(), nVerts, 16);
+    MeshOptimizer::VertexCacheStats before32 =
+            MeshOptimizer::analyzeVertexCache(&el[0], el.size(), nVerts, 32);
+
+    CStopWatch timer;
+    MeshOptimizer::optimizeVertexCache(&el[0], el.size(), nVerts);
+    float t = timer.GetElapsedSeconds();
+
+    MeshOptimizer::VertexCacheStats after16 =
+            MeshOptimizer::analyzeVertexCache(&el[0], el.size(), nVerts, 16);
+    MeshOptimizer::VertexCacheStats after32 =
+            MeshOptimizer::analyzeVertexCache(&el[0], el.size(), nVerts, 32);
+
+    printf(" %-16s %8u %6.3f %6.3f %6.3f %6.3f %6.3f %6.3f %6.3f %6.3f %8.2f\n",
+           name, (unsigned int)(el.size() / 3),
+           before16.acmr, after16.acmr, before16.atvr, after16.atvr,
+           before32.acmr, after32.acmr, before32.atvr, after32.atvr, t * 1000.0f);
+}
+
+static int benchVertexCache( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int grid = argc > 1 ? atoi(argv[1]) : 14;
+    if( grid < 1 ) grid = 1;
+
+    printf("FIFO post-transform cache, before -> after optimizeVertexCache\n");
+    printf(" %-16s %8s %13s %13s %13s %13s %8s\n", "mesh", "tris",
+           "ACMR(16)", "ATVR(16)", "ACMR(32)", "ATVR(32)", "opt ms");
+
+    // Torus as in SceneEdge
+    {
+        int rings = 50, sides = 50;
+        int nVerts = sides * (rings + 1);
+        vector<float> v(3 * nVerts), n(3 * nVerts), tc(2 * nVerts);
+        vector<unsigned int> el(6 * sides * rings);
+        VBOTorus::generateVerts(&v[0], &n[0], &tc[0], &el[0], 1.05f, 0.45f, rings, sides);
+        reportVertexCache("torus 50x50", el, nVerts);
+    }
+
+    // Teapot
+    {
+        int nVerts = 32 * (grid + 1) * (grid + 1);
+        vector<float> v(3 * nVerts), n(3 * nVerts), tc(2 * nVerts);
+        vector<unsigned int> el(6 * 32 * grid * grid);
+        VBOTeapot::generatePatches(&v[0], &n[0], &tc[0], &el[0], grid);
+        char name[32];
+        sprintf(name, "teapot %d", grid);
+        reportVertexCache(name, el, nVerts);
+    }
+
+    // OBJ mesh in file order
+    {
+        VBOMesh::Options options;
+        MeshCache data;
+        if( ! VBOMesh::loadVertexData(fileName, options, data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+        vector<unsigned int> el(data.indices(), data.indices() + data.indexCount());
+        const char * base = strrchr(fileName, '/');
+        reportVertexCache(base ? base + 1 : fileName, el, data.vertexCount());
+    }
+
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Serial against parallel normal and tangent generation, on a finely
+// tessellated torus
+
+static int benchNormals( int argc, char * argv[] )
+{
+    int rings = argc > 0 ? atoi(argv[0]) : 1024;
+    int iterations = argc > 1 ? atoi(argv[1]) : 3;
+    int maxThreads = argc > 2 ? atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+    if( rings < 3 ) rings = 3;
+    if( iterations < 1 ) iterations = 1;
+    if( maxThreads < 1 ) maxThreads = 1;
+
+    const float tolerance = 1e-5f;
+
+    int sides = rings;
+    int nVerts = sides * (rings + 1);
+    vector<float> v(3 * nVerts), n(3 * nVerts), tc(2 * nVerts);
+    vector<unsigned int> el(6 * sides * rings);
+    VBOTorus::generateVerts(&v[0], &n[0], &tc[0], &el[0], 0.7f, 0.3f, rings, sides);
+
+    vector<vec3> points(nVerts);
+    vector<vec2> texCoords(nVerts);
+    for( int i = 0; i < nVerts; i++ ) {
+        points[i] = vec3(v[i * 3], v[i * 3 + 1], v[i * 3 + 2]);
+        texCoords[i] = vec2(tc[i * 2], tc[i * 2 + 1]);
+    }
+    vector<int> faces(el.begin(), el.end());
+
+    printf("torus %dx%d: %d vertices, %u triangles, %d iterations, up to %d threads\n",
+           rings, sides, nVerts, (unsigned int)(faces.size() / 3), iterations, maxThreads);
+    printf(" %-10s %10s %10s %9s %12s %12s\n", "threads", "normal ms", "tangent ms",
+           "speedup", "normal diff", "tangent diff");
+
+    CStopWatch timer;
+    vector<vec3> serialNormals;
+    vector<vec4> serialTangents;
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) VBOMesh::generateAveragedNormals(points, serialNormals, faces);
+    float normalTime = timer.GetElapsedSeconds() / iterations;
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) {
+        VBOMesh::generateTangents(points, serialNormals, faces, texCoords, serialTangents);
+    }
+    float tangentTime = timer.GetElapsedSeconds() / iterations;
+    float serialTime = normalTime + tangentTime;
+    printf(" %-10s %10.2f %10.2f %8.2fx %12s %12s\n", "serial",
+           normalTime * 1000.0f, tangentTime * 1000.0f, 1.0f, "reference", "reference");
+
+    bool allWithin = true;
+    for( int threads = 1; ; threads = (threads * 2 < maxThreads) ? threads * 2 : maxThreads ) {
+        vector<vec3> normals;
+        vector<vec4> tangents;
+
+        timer.Reset();
+        for( int i = 0; i < iterations; i++ ) {
+            VBOMesh::generateAveragedNormalsParallel(points, normals, faces, threads);
+        }
+        normalTime = timer.GetElapsedSeconds() / iterations;
+        timer.Reset();
+        for( int i = 0; i < iterations; i++ ) {
+            VBOMesh::generateTangentsParallel(points, normals, faces, texCoords, tangents, threads);
+        }
+        tangentTime = timer.GetElapsedSeconds() / iterations;
+
+        float normalDiff = maxDifference(serialNormals, normals);
+        float tangentDiff = maxDifference(serialTangents, tangents);
+        allWithin = allWithin && normalDiff <= tolerance && tangentDiff <= tolerance;
+
+        printf(" %-10d %10.2f %10.2f %8.2fx %12.2g %12.2g\n", threads,
+               normalTime * 1000.0f, tangentTime * 1000.0f,
+               serialTime / (normalTime + tangentTime), normalDiff, tangentDiff);
+
+        if( threads == maxThreads ) break;
+    }
+
+    printf(" %s (tolerance %g)\n", allWithin ? "within tolerance" : "OUTSIDE TOLERANCE", tolerance);
+    return allWithin ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The VBOMesh optimization passes applied one after another, in the order
+// loadVertexData runs them, with the cost and effect of each
+
+static void reportPasses( const char * step, const vector<unsigned int> & el,
+                          const vector<float> & verts, unsigned int stride, float ms )
+{
+    size_t nVerts = verts.size() / stride;
+    MeshOptimizer::VertexCacheStats cache =
+            MeshOptimizer::analyzeVertexCache(&el[0], el.size(), nVerts, 16);
+    MeshOptimizer::VertexFetchStats fetch =
+            MeshOptimizer::analyzeVertexFetch(&el[0], el.size(), nVerts, stride * sizeof(float));
+    MeshOptimizer::OverdrawStats overdraw =
+            MeshOptimizer::analyzeOverdraw(&el[0], el.size(), &verts[0], stride, nVerts);
+
+    printf(" %-16s %8.3f %10u %9.3f %9.3f %8.2f\n", step, cache.acmr,
+           fetch.bytesFetched / 1024, fetch.overfetch, overdraw.overdraw, ms);
+}
+
+static int benchOptimize( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    float threshold = argc > 1 ? (float)atof(argv[1]) : 1.05f;
+
+    VBOMesh::Options options;
+    MeshCache data;
+    if( ! VBOMesh::loadVertexData(fileName, options, data) ) {
+        fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+    unsigned int stride = data.stride();
+    vector<float> verts(data.vertices(), data.vertices() + data.vertexCount() * stride);
+    vector<unsigned int> el(data.indices(), data.indices() + data.indexCount());
+    size_t nVerts = data.vertexCount();
+
+    printf("%s: %u vertices, %u triangles, %u bytes per vertex, overdraw threshold %.2f\n",
+           fileName, (unsigned int)nVerts, (unsigned int)(el.size() / 3),
+           (unsigned int)(stride * sizeof(float)), threshold);
+    printf(" %-16s %8s %10s %9s %9s %8s\n", "pass", "ACMR(16)", "fetch KB",
+           "overfetch", "overdraw", "opt ms");
+
+    CStopWatch timer;
+    reportPasses("file order", el, verts, stride, 0.0f);
+
+    timer.Reset();
+    MeshOptimizer::optimizeVertexCache(&el[0], el.size(), nVerts);
+    reportPasses("+ vertex cache", el, verts, stride, timer.GetElapsedSeconds() * 1000.0f);
+
+    timer.Reset();
+    MeshOptimizer::optimizeOverdraw(&el[0], el.size(), &verts[0], stride, nVerts, threshold);
+    reportPasses("+ overdraw", el, verts, stride, timer.GetElapsedSeconds() * 1000.0f);
+
+    timer.Reset();
+    nVerts = MeshOptimizer::optimizeVertexFetch(&verts[0], stride, &el[0], el.size(), nVerts);
+    verts.resize(nVerts * stride);
+    reportPasses("+ vertex fetch", el, verts, stride, timer.GetElapsedSeconds() * 1000.0f);
+
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Level of detail chain as VBOMesh builds it: each level simplified to half
+// the triangles of the one before, over the shared vertex buffer
+
+static int benchSimplify( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int levels = argc > 1 ? atoi(argv[1]) : 3;
+
+    VBOMesh::Options options;
+    MeshCache data;
+    if( ! VBOMesh::loadVertexData(fileName, options, data) ) {
+        fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+    unsigned int stride = data.stride();
+    size_t nVerts = data.vertexCount();
+    vec3 extent = data.boundsMax() - data.boundsMin();
+    float diagonal = glm::length(extent);
+
+    printf("%s: %u vertices, bounding box diagonal %g\n", fileName,
+           (unsigned int)nVerts, diagonal);
+    printf(" %-5s %9s %9s %11s %11s %9s\n", "level", "triangles", "vertices",
+           "error", "error/diag", "ms");
+
+    vector<unsigned int> el(data.indices(), data.indices() + data.indexCount());
+    float error = 0.0f;
+    CStopWatch timer;
+    for( int level = 0; level <= levels; level++ ) {
+        float ms = 0.0f;
+        if( level > 0 ) {
+            float stepError = 0.0f;
+            vector<unsigned int> simplified(el.size());
+            timer.Reset();
+            size_t n = MeshOptimizer::simplify(&simplified[0], &el[0], el.size(),
+                                               data.vertices(), stride, nVerts,
+                                               el.size() / 6 * 3, &stepError);
+            ms = timer.GetElapsedSeconds() * 1000.0f;
+            if( n == el.size() ) break;
+            simplified.resize(n);
+            el.swap(simplified);
+            error += stepError;
+        }
+
+        vector<bool> used(nVerts, false);
+        unsigned int usedVerts = 0;
+        for( size_t i = 0; i < el.size(); i++ ) {
+            if( ! used[el[i]] ) usedVerts++;
+            used[el[i]] = true;
+        }
+        printf(" %-5d %9u %9u %11.3g %11.3g %9.2f\n", level, (unsigned int)(el.size() / 3),
+               usedVerts, error, diagonal > 0.0f ? error / diagonal : 0.0f, ms);
+    }
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Meshlet clustering and per frame culling, from cameras around the mesh.
+// Also checks that no culled meshlet had a triangle facing the camera.
+
+static int benchMeshlets( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int views = argc > 1 ? atoi(argv[1]) : 64;
+
+    VBOMesh::Options options;
+    options.optimizeVertexCache = true;
+    MeshCache data;
+    if( ! VBOMesh::loadVertexData(fileName, options, data) ) {
+        fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+        return EXIT_FAILURE;
+    }
+    unsigned int stride = data.stride();
+    const float * verts = data.vertices();
+
+    CStopWatch timer;
+    Meshlets meshlets;
+    meshlets.build(data.indices(), data.indexCount(), verts, stride, data.vertexCount());
+    float buildMs = timer.GetElapsedSeconds() * 1000.0f;
+
+    unsigned int totalVerts = 0, cones = 0;
+    for( size_t i = 0; i < meshlets.size(); i++ ) {
+        totalVerts += meshlets[i].vertexCount;
+        if( meshlets[i].coneCutoff <= 1.0f ) cones++;
+    }
+    size_t nTris = data.indexCount() / 3;
+    printf("%s: %u triangles in %u meshlets (%.1f triangles, %.1f vertices each), %.2f ms\n",
+           fileName, (unsigned int)nTris, (unsigned int)meshlets.size(),
+           (float)nTris / meshlets.size(), (float)totalVerts / meshlets.size(), buildMs);
+    printf(" %u meshlets (%.0f%%) have a usable normal cone\n", cones, 100.0f * cones / meshlets.size());
+
+    vec3 center = 0.5f * (data.boundsMin() + data.boundsMax());
+    float radius = 0.5f * glm::length(data.boundsMax() - data.boundsMin());
+    mat4 projection = glm::perspective(50.0f, 4.0f / 3.0f, 0.1f, 100.0f);
+
+    vector<unsigned int> visible;
+    double cullSeconds = 0.0;
+    unsigned long long drawn = 0, backfacing = 0;
+    bool conservative = true;
+    for( int i = 0; i < views; i++ ) {
+        // Spiral of cameras over the sphere, close enough that some of the
+        // mesh leaves the frustum
+        float y = 1.0f - 2.0f * (i + 0.5f) / views;
+        float r = sqrt(1.0f - y * y);
+        float phi = i * 2.39996f;
+        vec3 eye = center + 1.5f * radius * vec3(r * cos(phi), y, r * sin(phi));
+        mat4 mvp = projection * glm::lookAt(eye, center, vec3(0.0f, 1.0f, 0.0f));
+
+        timer.Reset();
+        meshlets.cull(mvp, vec4(eye, 1.0f), visible);
+        cullSeconds += timer.GetElapsedSeconds();
+        drawn += visible.size() / 3;
+
+        // Every triangle facing the camera must have survived
+        vector<bool> kept(meshlets.size(), false);
+        for( size_t m = 0, next = 0; m < meshlets.size(); m++ ) {
+            const unsigned int * el = meshlets.clusterIndices() + meshlets[m].firstIndex;
+            if( next < visible.size() && visible[next] == el[0] &&
+                    memcmp(&visible[next], el, meshlets[m].indexCount * sizeof(unsigned int)) == 0 ) {
+                kept[m] = true;
+                next += meshlets[m].indexCount;
+            }
+            for( unsigned int t = 0; t < meshlets[m].indexCount; t += 3 ) {
+                vec3 p0 = glm::make_vec3(verts + el[t] * stride);
+                vec3 p1 = glm::make_vec3(verts + el[t + 1] * stride);
+                vec3 p2 = glm::make_vec3(verts + el[t + 2] * stride);
+                bool facing = glm::dot(glm::cross(p1 - p0, p2 - p0), eye - p0) > 0.0f;
+                if( ! facing ) backfacing++;
+                if( facing && ! kept[m] ) {
+                    vec4 clip = mvp * vec4(p0, 1.0f);
+                    bool inside = clip.w > 0.0f && fabs(clip.x) <= clip.w && fabs(clip.y) <= clip.w;
+                    if( inside ) conservative = false;
+                }
+            }
+        }
+    }
+
+    printf(" %d views: %.1f%% of triangles drawn (%.1f%% face away), %.3f ms per cull\n", views,
+           100.0 * drawn / ((double)nTris * views), 100.0 * backfacing / ((double)nTris * views),
+           cullSeconds * 1000.0 / views);
+    printf(" %s\n", conservative ? "no visible triangle culled" : "VISIBLE TRIANGLES CULLED");
+    return conservative ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// BVH build time and ray throughput, closest hit and any hit, checked
+// against testing every triangle
+
+static bool bruteForceHit( const float * verts, unsigned int stride, const vector<unsigned int> & el,
+                           const vec3 & origin, const vec3 & dir, float & tHit )
+{
+    bool found = false;
+    tHit = FLT_MAX;
+    for( size_t i = 0; i < el.size(); i += 3 ) {
+        vec3 v0 = glm::make_vec3(verts + el[i] * stride);
+        vec3 e1 = glm::make_vec3(verts + el[i + 1] * stride) - v0;
+        vec3 e2 = glm::make_vec3(verts + el[i + 2] * stride) - v0;
+        vec3 p = glm::cross(dir, e2);
+        float det = glm::dot(e1, p);
+        if( det == 0.0f ) continue;
+        vec3 s = origin - v0;
+        float u = glm::dot(s, p) / det;
+        if( u < 0.0f || u > 1.0f ) continue;
+        vec3 q = glm::cross(s, e1);
+        float v = glm::dot(dir, q) / det;
+        if( v < 0.0f || u + v > 1.0f ) continue;
+        float t = glm::dot(e2, q) / det;
+        if( t >= 0.0f && t < tHit ) {
+            tHit = t;
+            found = true;
+        }
+    }
+    return found;
+}
+
+static bool reportBVH( const char * name, const float * verts, unsigned int stride,
+                       size_t nVerts, const vector<unsigned int> & el, int nRays )
+{
+    CStopWatch timer;
+    BVH bvh;
+    bvh.build(verts, stride, nVerts, &el[0], el.size());
+    float buildMs = timer.GetElapsedSeconds() * 1000.0f;
+    BVH::Stats stats = bvh.stats();
+
+    // Rays from a sphere around the mesh towards random points in its box
+    vec3 minPoint(FLT_MAX), maxPoint(-FLT_MAX);
+    for( size_t v = 0; v < nVerts; v++ ) {
+        minPoint = glm::min(minPoint, glm::make_vec3(verts + v * stride));
+        maxPoint = glm::max(maxPoint, glm::make_vec3(verts + v * stride));
+    }
+    vec3 center = 0.5f * (minPoint + maxPoint);
+    float radius = glm::length(maxPoint - center);
+    vector<vec3> origins(nRays), directions(nRays);
+    srand(1);
+    for( int i = 0; i < nRays; i++ ) {
+        vec3 r;
+        do {
+            r = vec3(rand(), rand(), rand()) / (float)RAND_MAX * 2.0f - 1.0f;
+        } while( glm::length(r) > 1.0f || glm::length(r) < 0.01f );
+        origins[i] = center + 2.0f * radius * glm::normalize(r);
+        vec3 target = minPoint + (maxPoint - minPoint) * vec3(rand(), rand(), rand()) / (float)RAND_MAX;
+        directions[i] = target - origins[i];
+    }
+
+    timer.Reset();
+    unsigned int hits = 0;
+    BVH::Hit hit;
+    for( int i = 0; i < nRays; i++ ) {
+        if( bvh.intersect(origins[i], directions[i], hit) ) hits++;
+    }
+    double closestSeconds = timer.GetElapsedSeconds();
+
+    // Any hit along the segment to the target
+    timer.Reset();
+    unsigned int occluded = 0;
+    for( int i = 0; i < nRays; i++ ) {
+        if( bvh.occluded(origins[i], directions[i], 1.0f) ) occluded++;
+    }
+    double anySeconds = timer.GetElapsedSeconds();
+
+    // Same answers as brute force on a subset
+    int nChecked = std::min(nRays, 200);
+    bool agree = true;
+    timer.Reset();
+    for( int i = 0; i < nChecked; i++ ) {
+        float t;
+        bool found = bruteForceHit(verts, stride, el, origins[i], directions[i], t);
+        bool bvhFound = bvh.intersect(origins[i], directions[i], hit);
+        if( found != bvhFound || (found && fabs(t - hit.t) > 1e-5f * std::max(1.0f, t)) ) agree = false;
+    }
+    double bruteSeconds = timer.GetElapsedSeconds();
+
+    printf(" %-14s %8u %8.1f %7u %5u %6.1f %7.2f %9.2f %9.2f %9.4f %s\n", name,
+           (unsigned int)(el.size() / 3), buildMs, stats.nodes, stats.maxDepth, stats.sahCost,
+           bvh.memoryBytes() / (1024.0f * 1024.0f),
+           nRays / closestSeconds / 1e6, nRays / anySeconds / 1e6, nChecked / bruteSeconds / 1e6,
+           agree ? "ok" : "MISMATCH");
+    return agree;
+}
+
+static int benchBVH( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int nRays = argc > 1 ? atoi(argv[1]) : 200000;
+    bool ok = true;
+
+    printf("%d rays per mesh, from a sphere around it to points in its bounding box\n", nRays);
+    printf(" %-14s %8s %8s %7s %5s %6s %7s %9s %9s %9s\n", "mesh", "tris", "build ms",
+           "nodes", "depth", "SAH", "MB", "Mray/s", "any Mray/s", "brute");
+
+    {
+        int rings = 256, sides = 256;
+        int nVerts = sides * (rings + 1);
+        vector<float> v(3 * nVerts), n(3 * nVerts), tc(2 * nVerts);
+        vector<unsigned int> el(6 * sides * rings);
+        VBOTorus::generateVerts(&v[0], &n[0], &tc[0], &el[0], 1.05f, 0.45f, rings, sides);
+        ok = reportBVH("torus 256x256", &v[0], 3, nVerts, el, nRays) && ok;
+    }
+    {
+        int grid = 32;
+        int nVerts = 32 * (grid + 1) * (grid + 1);
+        vector<float> v(3 * nVerts), n(3 * nVerts), tc(2 * nVerts);
+        vector<unsigned int> el(6 * 32 * grid * grid);
+        VBOTeapot::generatePatches(&v[0], &n[0], &tc[0], &el[0], grid);
+        ok = reportBVH("teapot 32", &v[0], 3, nVerts, el, nRays) && ok;
+    }
+    {
+        VBOMesh::Options options;
+        MeshCache data;
+        if( ! VBOMesh::loadVertexData(fileName, options, data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+        vector<unsigned int> el(data.indices(), data.indices() + data.indexCount());
+        ok = reportBVH("obj", data.vertices(), data.stride(), data.vertexCount(), el, nRays) && ok;
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Every generator producing MeshData, without a GL context
+
+static void reportGenerate( const char * name, const MeshData & data, double seconds, int iterations )
+{
+    printf(" %-20s %9u %9u %9.1f %9.3f   (%.2f, %.2f, %.2f) - (%.2f, %.2f, %.2f)\n", name,
+           (unsigned int)data.vertexCount(), (unsigned int)data.triangleCount(),
+           data.memoryBytes() / 1024.0f, seconds * 1000.0 / iterations,
+           data.boundsMin.x, data.boundsMin.y, data.boundsMin.z,
+           data.boundsMax.x, data.boundsMax.y, data.boundsMax.z);
+}
+
+static int benchGenerate( int argc, char * argv[] )
+{
+    const char * fileName = argc > 0 ? argv[0] : defaultObj;
+    int iterations = argc > 1 ? atoi(argv[1]) : 10;
+    if( iterations < 1 ) iterations = 1;
+
+    printf("MeshData generation, mean of %d runs\n", iterations);
+    printf(" %-20s %9s %9s %9s %9s   %s\n", "generator", "vertices", "triangles", "KB", "ms", "bounds");
+
+    CStopWatch timer;
+    MeshData data;
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) VBOCube::generate(data);
+    reportGenerate("cube", data, timer.GetElapsedSeconds(), iterations);
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) VBOPlane::generate(data, 50.0f, 50.0f, 256, 256);
+    reportGenerate("plane 256x256", data, timer.GetElapsedSeconds(), iterations);
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) VBOTorus::generate(data, 0.7f, 0.3f, 256, 256);
+    reportGenerate("torus 256x256", data, timer.GetElapsedSeconds(), iterations);
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) VBOTorus::generate(data, 0.7f, 0.3f, 256, 256, true);
+    reportGenerate("torus + vcache", data, timer.GetElapsedSeconds(), iterations);
+
+    timer.Reset();
+    for( int i = 0; i < iterations; i++ ) VBOTeapot::generate(data, 64, mat4(1.0f));
+    reportGenerate("teapot 64", data, timer.GetElapsedSeconds(), iterations);
+
+    timer.Reset();
+    VBOMesh::Options options;
+    for( int i = 0; i < iterations; i++ ) {
+        if( ! VBOMesh::loadMeshData(fileName, options, data) ) {
+            fprintf(stderr, "Unable to open OBJ file: %s\n", fileName);
+            return EXIT_FAILURE;
+        }
+    }
+    reportGenerate("obj", data, timer.GetElapsedSeconds(), iterations);
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Teapot patch evaluation: the serial scalar code against the parallel SIMD
+// version, for growing grid sizes
+
+// Largest difference between two float arrays, and how many entries are
+// NaN in one but not the other
+static float maxDifference( const vector<float> & a, const vector<float> & b, int & nanMismatches )
+{
+    float diff = 0.0f;
+    nanMismatches = 0;
+    for( size_t i = 0; i < a.size() && i < b.size(); i++ ) {
+        bool aNan = a[i] != a[i], bNan = b[i] != b[i];
+        if( aNan || bNan ) {
+            if( aNan != bNan ) nanMismatches++;
+            continue;
+        }
+        float d = fabs(a[i] - b[i]);
+        if( d > diff ) diff = d;
+    }
+    return diff;
+}
+
+static int benchTeapot( int argc, char * argv[] )
+{
+    int maxGrid = argc > 0 ? atoi(argv[0]) : 256;
+    int maxThreads = argc > 1 ? atoi(argv[1]) : (int)std::thread::hardware_concurrency();
+    if( maxGrid < 1 ) maxGrid = 1;
+    if( maxThreads < 1 ) maxThreads = 1;
+
+    const float tolerance = 1e-4f;
+
+    printf("teapot patch evaluation, up to %d threads\n", maxThreads);
+    printf(" %5s %9s %10s %10s %10s %9s %10s %10s\n", "grid", "vertices", "serial ms",
+           "simd ms", "threads ms", "speedup", "pos diff", "norm diff");
+
+    bool allWithin = true;
+    CStopWatch timer;
+    for( int grid = 4; grid <= maxGrid; grid *= 2 ) {
+        int nVerts = 32 * (grid + 1) * (grid + 1);
+        int nIndices = 6 * 32 * grid * grid;
+        vector<float> v(3 * nVerts), n(3 * nVerts), tc(2 * nVerts);
+        vector<float> pv(3 * nVerts), pn(3 * nVerts), ptc(2 * nVerts);
+        vector<unsigned int> el(nIndices), pel(nIndices);
+
+        // Repeat small grids so that each timing covers a similar amount of work
+        int iterations = 1 + (256 * 256) / ((grid + 1) * (grid + 1));
+
+        timer.Reset();
+        for( int i = 0; i < iterations; i++ ) VBOTeapot::generatePatches(&v[0], &n[0], &tc[0], &el[0], grid);
+        float serialTime = timer.GetElapsedSeconds() / iterations;
+
+        timer.Reset();
+        for( int i = 0; i < iterations; i++ ) {
+            VBOTeapot::generatePatchesParallel(&pv[0], &pn[0], &ptc[0], &pel[0], grid, 1);
+        }
+        float simdTime = timer.GetElapsedSeconds() / iterations;
+
+        timer.Reset();
+        for( int i = 0; i < iterations; i++ ) {
+            VBOTeapot::generatePatchesParallel(&pv[0], &pn[0], &ptc[0], &pel[0], grid, maxThreads);
+        }
+        float threadTime = timer.GetElapsedSeconds() / iterations;
+
+        int posNan, normNan, tcNan;
+        float posDiff = maxDifference(v, pv, posNan);
+        float normDiff = maxDifference(n, pn, normNan);
+        float tcDiff = maxDifference(tc, ptc, tcNan);
+        bool same = el == pel && posNan == 0 && normNan == 0 && tcNan == 0 && tcDiff == 0.0f;
+        allWithin = allWithin && same && posDiff <= tolerance && normDiff <= tolerance;
+
+        printf(" %5d %9d %10.3f %10.3f %10.3f %8.2fx %10.2g %10.2g%s\n", grid, nVerts,
+               serialTime * 1000.0f, simdTime * 1000.0f, threadTime * 1000.0f,
+               serialTime / threadTime, posDiff, normDiff, same ? "" : "  (layout differs)");
+    }
+
+    printf(" %s (tolerance %g)\n", allWithin ? "within tolerance" : "OUTSIDE TOLERANCE", tolerance);
+    return allWithin ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// The per patch tessellation levels VBOTeapotPatches' control shader picks
+// as the camera backs away, computed on the CPU, against the vertex memory
+// of the CPU tessellated teapot
+
+static int benchTessLevels( int argc, char * argv[] )
+{
+    float pixelsPerEdge = argc > 0 ? (float)atof(argv[0]) : 8.0f;
+    float maxLevel = argc > 1 ? (float)atof(argv[1]) : 64.0f;
+    if( pixelsPerEdge <= 0.0f ) pixelsPerEdge = 8.0f;
+    if( maxLevel < 1.0f ) maxLevel = 1.0f;
+
+    const int nPatches = VBOTeapotPatches::PATCHES, nCP = VBOTeapotPatches::CONTROL_POINTS;
+    vector<float> cp(nPatches * nCP * 3);
+    VBOTeapot::generateControlPoints(&cp[0], mat4(1.0f));
+
+    // Same view as drawbench tess
+    const vec2 viewport(1280.0f, 720.0f);
+    mat4 projection = glm::perspective(60.0f, viewport.x / viewport.y, 0.3f, 1000.0f);
+    mat4 model = glm::rotate(mat4(1.0f), -90.0f, vec3(1.0f, 0.0f, 0.0f));
+
+    printf("Teapot patches, %gx%g viewport, %g pixels per edge, levels up to %g\n",
+           viewport.x, viewport.y, pixelsPerEdge, maxLevel);
+    printf(" control points: %u bytes; grid 14: %u bytes; grid 64: %u bytes (positions, normals, tex coords)\n",
+           (unsigned int)(cp.size() * sizeof(float)),
+           32 * 15 * 15 * 8 * (unsigned int)sizeof(float), 32 * 65 * 65 * 8 * (unsigned int)sizeof(float));
+    // Edges that two patches share, listed either way round: they must get
+    // identical outer levels or the surface cracks between them
+    static const int first[4] = { 0, 0, 12, 3 };
+    static const int step[4] = { 1, 4, 1, 4 };
+    vector<int> shared;     // Pairs of patch * 4 + edge
+    for( int a = 0; a < nPatches * 4; a++ ) {
+        for( int b = a + 1; b < nPatches * 4; b++ ) {
+            bool forward = true, backward = true;
+            for( int k = 0; k < 4; k++ ) {
+                const float * pa = &cp[((a / 4) * nCP + first[a % 4] + k * step[a % 4]) * 3];
+                const float * pb = &cp[((b / 4) * nCP + first[b % 4] + k * step[b % 4]) * 3];
+                const float * pr = &cp[((b / 4) * nCP + first[b % 4] + (3 - k) * step[b % 4]) * 3];
+                forward = forward && pa[0] == pb[0] && pa[1] == pb[1] && pa[2] == pb[2];
+                backward = backward && pa[0] == pr[0] && pa[1] == pr[1] && pa[2] == pr[2];
+            }
+            if( (forward || backward) && a / 4 != b / 4 ) {
+                shared.push_back(a);
+                shared.push_back(b);
+            }
+        }
+    }
+    printf(" %d shared patch edges\n", (int)shared.size() / 2);
+    printf(" %8s %7s %10s %10s %10s %10s %10s\n", "distance", "culled", "min level", "mean level",
+           "max level", "~triangles", "mismatched");
+
+    for( float distance = 4.0f; distance <= 256.0f; distance *= 2.0f ) {
+        mat4 view = glm::lookAt(vec3(0.0f, 0.5f * distance, distance), vec3(0.0f, 0.75f, 0.0f),
+                                vec3(0.0f, 1.0f, 0.0f));
+        mat4 mvp = projection * view * model;
+
+        int culled = 0, drawn = 0;
+        float minLevel = maxLevel, maxSeen = 0.0f, sum = 0.0f, triangles = 0.0f;
+        vector<float> outers(nPatches * 4);
+        for( int p = 0; p < nPatches; p++ ) {
+            float * outer = &outers[p * 4];
+            float inner[2];
+            VBOTeapotPatches::tessLevels(&cp[p * nCP * 3], mvp, viewport, pixelsPerEdge, maxLevel,
+                                         outer, inner);
+            if( inner[0] == 0.0f ) {
+                culled++;
+                continue;
+            }
+            drawn++;
+            for( int e = 0; e < 2; e++ ) {
+                minLevel = glm::min(minLevel, inner[e]);
+                maxSeen = glm::max(maxSeen, inner[e]);
+                sum += inner[e];
+            }
+            // fractional_even_spacing rounds up to the next even level
+            triangles += 2.0f * (2.0f * ceil(inner[0] * 0.5f)) * (2.0f * ceil(inner[1] * 0.5f));
+        }
+
+        // A culled patch is wholly outside the frustum, so its edges can't crack
+        int mismatched = 0;
+        for( size_t s = 0; s < shared.size(); s += 2 ) {
+            float la = outers[shared[s]], lb = outers[shared[s + 1]];
+            if( la != 0.0f && lb != 0.0f && la != lb ) mismatched++;
+        }
+
+        printf(" %8g %7d %10.1f %10.1f %10.1f %10.0f %10d\n", distance, culled,
+               drawn ? minLevel : 0.0f, drawn ? sum / (2 * drawn) : 0.0f, maxSeen, triangles,
+               mismatched);
+    }
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Teapot vertices shared between patches by the seam weld, with the
+// post-transform cache behaviour once the indices are optimized
+
+static int benchWeld( int argc, char * argv[] )
+{
+    int maxGrid = argc > 0 ? atoi(argv[0]) : 64;
+    if( maxGrid < 1 ) maxGrid = 1;
+
+    printf("teapot seam weld (untextured: texture coordinates ignored, as in edge and phongTeapot)\n");
+    printf(" %5s %9s %9s %7s %10s %7s %9s %8s %8s %8s\n", "grid", "vertices", "uv kept", "saved",
+           "untextured", "saved", "KB saved", "ACMR", "welded", "weld ms");
+
+    const int grids[] = { 4, 8, 10, 14, 16, 32, 64, 128 };
+    CStopWatch timer;
+    for( int g = 0; g < (int)(sizeof(grids) / sizeof(grids[0])) && grids[g] <= maxGrid; g++ ) {
+        int grid = grids[g];
+        MeshData plain, weldedUV, welded;
+        VBOTeapot::generate(plain, grid, mat4(1.0f), true);
+        weldedUV = welded = plain;
+
+        weldedUV.weld();
+        timer.Reset();
+        welded.weld(1e-5f, 1e-3f, false);
+        float weldTime = timer.GetElapsedSeconds();
+
+        size_t before = plain.vertexCount(), after = welded.vertexCount();
+        size_t afterUV = weldedUV.vertexCount();
+        MeshOptimizer::VertexCacheStats plainCache =
+                MeshOptimizer::analyzeVertexCache(&plain.indices[0], plain.indices.size(), before);
+        MeshOptimizer::VertexCacheStats weldedCache =
+                MeshOptimizer::analyzeVertexCache(&welded.indices[0], welded.indices.size(), after);
+
+        printf(" %5d %9u %9u %6.1f%% %10u %6.1f%% %9.1f %8.3f %8.3f %8.2f\n", grid,
+               (unsigned int)before, (unsigned int)afterUV, 100.0f * (before - afterUV) / before,
+               (unsigned int)after, 100.0f * (before - after) / before,
+               (plain.memoryBytes() - welded.memoryBytes()) / 1024.0f,
+               plainCache.acmr, weldedCache.acmr, weldTime * 1000.0f);
+    }
+    return EXIT_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+// Index buffer size of the generators' triangle strips against their lists,
+// checking that the strips unroll to the same triangles
+
+// Rotates each triangle so that it starts on its smallest index, which keeps
+// the winding but not which vertex comes first
+static void canonicalTriangles( vector<unsigned int> & el )
+{
+    for( size_t i = 0; i + 2 < el.size(); i += 3 ) {
+        while( el[i] > el[i + 1] || el[i] > el[i + 2] ) {
+            unsigned int first = el[i];
+            el[i] = el[i + 1];
+            el[i + 1] = el[i + 2];
+            el[i + 2] = first;
+        }
+    }
+}
+
+static bool reportStrips( const char * name, const MeshData & list, const MeshData & strips )
+{
+    vector<unsigned int> a, b;
+    list.triangleList(a);
+    strips.triangleList(b);
+    canonicalTriangles(a);
+    canonicalTriangles(b);
+    bool same = (a == b);
+
+    // 16 bit indices when the vertices fit below the restart index 0xffff
+    size_t indexSize = list.vertexCount() < 0xffff ? 2 : 4;
+    printf(" %-16s %9u %9u %9u %7.2fx %9.1f %9.1f  %s\n", name,
+           (unsigned int)list.triangleCount(), (unsigned int)list.indices.size(),
+           (unsigned int)strips.indices.size(),
+           (float)list.indices.size() / strips.indices.size(),
+           list.indices.size() * indexSize / 1024.0f, strips.indices.size() * indexSize / 1024.0f,
+           same ? "same" : "TRIANGLES DIFFER");
+    return same;
+}
+
+static int benchStrips( int argc, char * argv[] )
+{
+    int divisions = argc > 0 ? atoi(argv[0]) : 64;
+    if( divisions < 1 ) divisions = 1;
+    int teapotGrid = divisions < 64 ? divisions : 64;
+
+    printf("triangle strips with primitive restart against triangle lists\n");
+    printf(" %-16s %9s %9s %9s %8s %9s %9s  %s\n", "shape", "triangles", "list", "strips",
+           "ratio", "list KB", "strips KB", "triangles");
+
+    bool ok = true;
+    MeshData list, strips;
+    char name[64];
+
+    VBOPlane::generate(list, 50.0f, 50.0f, divisions, divisions);
+    VBOPlane::generate(strips, 50.0f, 50.0f, divisions, divisions, MeshData::TRIANGLE_STRIPS);
+    sprintf(name, "plane %d", divisions);
+    ok = reportStrips(name, list, strips) && ok;
+
+    VBOTorus::generate(list, 0.7f, 0.3f, divisions, divisions);
+    VBOTorus::generate(strips, 0.7f, 0.3f, divisions, divisions, false, MeshData::TRIANGLE_STRIPS);
+    sprintf(name, "torus %d", divisions);
+    ok = reportStrips(name, list, strips) && ok;
+
+    VBOTeapot::generate(list, teapotGrid, mat4(1.0f));
+    VBOTeapot::generate(strips, teapotGrid, mat4(1.0f), false, false, MeshData::TRIANGLE_STRIPS);
+    sprintf(name, "teapot %d", teapotGrid);
+    ok = reportStrips(name, list, strips) && ok;
+
+    VBOTeapot::generate(list, teapotGrid, mat4(1.0f), false, true);
+    VBOTeapot::generate(strips, teapotGrid, mat4(1.0f), false, true, MeshData::TRIANGLE_STRIPS);
+    sprintf(name, "teapot %d welded", teapotGrid);
+    ok = reportStrips(name, list, strips) && ok;
+
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+static void usage()
+{
+    printf("usage: meshbench <benchmark> [options]\n");
+    printf("  obj [file.obj] [iterations]     OBJ parse throughput, stream vs mapped\n");
+    printf("  objthreads [file.obj] [scale] [iterations] [maxThreads]\n");
+    printf("                                  chunked parallel OBJ parse scaling\n");
+    printf("  meshcache [file.obj] [iterations]\n");
+    printf("                                  VBOMesh load: no cache, cache miss, cache hit\n");
+    printf("  vcache [file.obj] [teapotGrid]  ACMR/ATVR before and after cache optimization\n");
+    printf("  optimize [file.obj] [threshold] vertex cache, overdraw and vertex fetch passes\n");
+    printf("  normals [rings] [iterations] [maxThreads]\n");
+    printf("                                  serial vs parallel normal and tangent generation\n");
+    printf("  simplify [file.obj] [levels]    quadric simplification LOD chain\n");
+    printf("  meshlets [file.obj] [views]     meshlet build and frustum/backface culling\n");
+    printf("  bvh [file.obj] [rays]           BVH build time and closest/any hit rays per second\n");
+    printf("  teapot [maxGrid] [maxThreads]   serial vs parallel SIMD Bezier patch evaluation\n");
+    printf("  tesslevels [pixelsPerEdge] [maxLevel]\n");
+    printf("                                  per patch GPU tessellation levels vs distance\n");
+    printf("  weld [maxGrid]                  teapot seam weld vertex savings\n");
+    printf("  strips [divisions]              strip vs list index buffer size per shape\n");
+    printf("  generate [file.obj] [iterations]\n");
+    printf("                                  MeshData generation for every shape, no GL needed\n");
+}
+
+int main( int argc, char * argv[] )
+{
+    if( argc < 2 ) {
+        usage();
+        return EXIT_FAILURE;
+    }
+
+    if( strcmp(argv[1], "obj") == 0 ) return benchObj(argc - 2, argv + 2);
+    if( strcmp(argv[1], "objthreads") == 0 ) return benchObjThreads(argc - 2, argv + 2);
+    if( strcmp(argv[1], "meshcache") == 0 ) return benchMeshCache(argc - 2, argv + 2);
+    if( strcmp(argv[1], "vcache") == 0 ) return benchVertexCache(argc - 2, argv + 2);
+    if( strcmp(argv[1], "optimize") == 0 ) return benchOptimize(argc - 2, argv + 2);
+    if( strcmp(argv[1], "normals") == 0 ) return benchNormals(argc - 2, argv + 2);
+    if( strcmp(argv[1], "simplify") == 0 ) return benchSimplify(argc - 2, argv + 2);
+    if( strcmp(argv[1], "meshlets") == 0 ) return benchMeshlets(argc - 2, argv + 2);
+    if( strcmp(argv[1], "bvh") == 0 ) return benchBVH(argc - 2, argv + 2);
+    if( strcmp(argv[1], "teapot") == 0 ) return benchTeapot(argc - 2, argv + 2);
+    if( strcmp(argv[1], "tesslevels") == 0 ) return benchTessLevels(argc - 2, argv + 2);
+    if( strcmp(argv[1], "weld") == 0 ) return benchWeld(argc - 2, argv + 2);
+    if( strcmp(argv[1], "strips") == 0 ) return benchStrips(argc - 2, argv + 2);
+    if( strcmp(argv[1], "generate") == 0 ) return benchGenerate(argc - 2, argv + 2);
+
+    usage();
+    return EXIT_FAILURE;
+}
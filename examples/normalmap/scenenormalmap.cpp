@@ -5,7 +5,7 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtx/transform2.hpp>
 
-SceneNormalMap::SceneNormalMap()
+SceneNormalMap::SceneNormalMap() : cube(NULL), ogre(NULL), pendingOgre(NULL), loadFrames(0)
 {
 }
 
@@ -15,7 +15,21 @@ void SceneNormalMap::initScene()
 
     glEnable(GL_DEPTH_TEST);
 
-    ogre = new VBOMesh("bs_ears.obj");
+    VBOMesh::Options meshOptions;
+    meshOptions.useCache = true;
+    meshOptions.optimizeVertexCache = true;
+    // No overdraw pass: on bs_ears it cuts overdraw by under 1% at any
+    // threshold (meshbench optimize) and no benefit was measured here, while
+    // it costs ACMR and vertex fetch
+    meshOptions.optimizeVertexFetch = true;
+    meshOptions.compression = Drawable::COMPRESS_ALL;
+    meshOptions.lodLevels = 3;
+    meshOptions.buildMeshlets = true;
+    // Parse and process the mesh on a worker thread; a cube stands in for
+    // it until the data is ready to upload
+    pendingOgre = new PendingMesh("bs_ears.obj", meshOptions);
+    cube = new VBOCube();
+    loadTimer.Reset();
 
     view = glm::lookAt(vec3(-1.0f,0.25f,2.0f), vec3(0.0f,0.0f,0.0f), vec3(0.0f,1.0f,0.0f));
     projection = mat4(1.0f);
@@ -54,14 +68,46 @@ void SceneNormalMap::render()
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    if( pendingOgre && pendingOgre->ready() ) {
+        ogre = pendingOgre->upload();
+        if( ogre == NULL ) {
+            printf("Unable to load mesh: %s\n", pendingOgre->name());
+            exit(1);
+        }
+        printf("Loaded %s in the background: %.0f ms, %u frames drawn meanwhile\n",
+               pendingOgre->name(), loadTimer.GetElapsedSeconds() * 1000.0f, loadFrames);
+        delete pendingOgre;
+        pendingOgre = NULL;
+    }
+
     prog.setUniform("Light.Position", view * vec4(10.0f * cos(angle),1.0f,10.0f * sin(angle),1.0f) );
     prog.setUniform("Material.Ks", 0.2f, 0.2f, 0.2f);
     prog.setUniform("Material.Ka", 0.1f, 0.1f, 0.1f);
     prog.setUniform("Material.Shininess", 1.0f);
 
-    model = mat4(1.0f);
+    if( ogre == NULL ) {
+        loadFrames++;
+        model = glm::rotate(mat4(1.0f), 2.0f * loadFrames, vec3(0.0f, 1.0f, 0.0f));
+        model = glm::scale(model, vec3(0.4f));
+        setMatrices();
+        cube->render();
+        return;
+    }
+
+    // Undo the position quantization
+    model = ogre->getPositionTransform();
     setMatrices();
-    ogre->render();
+    // The orthographic view volume is 1.2 units high, so a unit covers
+    // height / 1.2 pixels.  Use the coarsest level within a pixel.
+    int lod = ogre->selectLod(height / 1.2f, 1.0f);
+    if( lod == 0 ) {
+        // Cull meshlets in the mesh's own coordinates; the camera looks
+        // along -z in eye space
+        vec4 viewDir = glm::inverse(view) * vec4(0.0f, 0.0f, -1.0f, 0.0f);
+        ogre->renderCulled(projection * view, viewDir);
+    } else {
+        ogre->render(lod);
+    }
 }
 
 void SceneNormalMap::setMatrices()
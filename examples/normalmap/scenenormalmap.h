@@ -6,6 +6,8 @@
 #include "vboplane.h"
 #include "vbocube.h"
 #include "vbomesh.h"
+#include "pendingmesh.h"
+#include "StopWatch.h"
 
 #include <GL/glew.h>
 #include <GL/gl.h>
@@ -23,6 +25,9 @@ private:
     VBOPlane *plane;
     VBOCube *cube;
     VBOMesh *ogre;
+    PendingMesh *pendingOgre;   // Until the mesh is uploaded
+    CStopWatch loadTimer;
+    unsigned int loadFrames;    // Frames drawn while loading
 
     mat4 model;
     mat4 view;
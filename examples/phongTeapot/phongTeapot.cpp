@@ -11,11 +11,15 @@
     
 #include "vboplane.h"
 #include "vboteapot.h"
+#include "vboteapotpatches.h"
 #include "glslprogram.h"
 
 GLSLProgram prog;
+GLSLProgram patchProg;      // Tessellated teapot, when GL 4.0 is available
 VBOPlane *   plane = NULL;
 VBOTeapot * teapot = NULL;
+VBOTeapotPatches * patches = NULL;
+bool tessellate = false;    // 'T' toggles
 
 mat4 model;
 mat4 view;
@@ -28,6 +32,18 @@ void ChangeSize(int w, int h)
 {
     glViewport(0,0,w,h);
     projection = glm::perspective(70.0f, (float)w/h, 0.3f, 100.0f);
+    if( patches ) {
+        patchProg.use();
+        patchProg.setUniform("ViewportSize", vec2((float)w, (float)h));
+    }
+}
+
+void KeyPressed(int key, int action)
+{
+    if( key == 'T' && action == GLFW_PRESS && patches ) {
+        tessellate = ! tessellate;
+        printf("%s teapot\n", tessellate ? "Tessellated" : "Triangle");
+    }
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -45,7 +61,10 @@ void SetupRC()
     glEnable(GL_DEPTH_TEST);
 
     plane  = new VBOPlane(50.0f, 50.0f, 1, 1);
-    teapot = new VBOTeapot(14, mat4(1.0f));
+    // Untextured, so the seams can be welded whatever their texture
+    // coordinates
+    teapot = new VBOTeapot(14, mat4(1.0f), false, Drawable::SPLIT_BUFFERS,
+                           Drawable::NO_COMPRESSION, true, MeshData::TRIANGLES, false);
 
     view = glm::lookAt(vec3(0.0f,3.0f,5.0f), vec3(0.0f,0.75f,0.0f), vec3(0.0f,1.0f,0.0f));
     vec4 worldLight = vec4(5.0f,5.0f,2.0f,1.0f);
@@ -54,15 +73,39 @@ void SetupRC()
     prog.setUniform("Light.La", 0.4f, 0.4f, 0.4f);
     prog.setUniform("Light.Ld", 1.0f, 1.0f, 1.0f);
     prog.setUniform("Light.Ls", 1.0f, 1.0f, 1.0f);
+
+    // The same teapot as Bezier patches, tessellated on the GPU to about
+    // 8 pixels per edge
+    if( GLEW_VERSION_4_0 ) {
+        patchProg.compileShaderFromFile("teapotpatch.vs", GLSLShader::VERTEX);
+        patchProg.compileShaderFromFile("teapotpatch.tcs", GLSLShader::TESS_CONTROL);
+        patchProg.compileShaderFromFile("teapotpatch.tes", GLSLShader::TESS_EVALUATION);
+        patchProg.compileShaderFromFile("teapotpatch.frag", GLSLShader::FRAGMENT);
+        patchProg.link();
+        patchProg.use();
+
+        GLint maxLevel;
+        glGetIntegerv(GL_MAX_TESS_GEN_LEVEL, &maxLevel);
+        if( maxLevel > 64 ) maxLevel = 64;
+        patchProg.setUniform("PixelsPerEdge", 8.0f);
+        patchProg.setUniform("MaxTessLevel", (float)maxLevel);
+        patchProg.setUniform("Light.Position", view * worldLight );
+        patchProg.setUniform("Light.La", 0.4f, 0.4f, 0.4f);
+        patchProg.setUniform("Light.Ld", 1.0f, 1.0f, 1.0f);
+        patchProg.setUniform("Light.Ls", 1.0f, 1.0f, 1.0f);
+
+        patches = new VBOTeapotPatches(mat4(1.0f));
+        tessellate = true;
+    }
 }
 
-void setMatrices()
+void setMatrices( GLSLProgram & p )
 {
     mat4 mv = view * model;
-    prog.setUniform("ModelViewMatrix", mv);
-    prog.setUniform("NormalMatrix",
-                    mat3( vec3(mv[0]), vec3(mv[1]), vec3(mv[2]) ));
-    prog.setUniform("MVP", projection * mv);
+    p.setUniform("ModelViewMatrix", mv);
+    p.setUniform("NormalMatrix",
+                 mat3( vec3(mv[0]), vec3(mv[1]), vec3(mv[2]) ));
+    p.setUniform("MVP", projection * mv);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -71,23 +114,27 @@ void RenderScene(void)
 {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-    prog.setUniform("Material.Kd", 0.9f, 0.5f, 0.3f);
-    prog.setUniform("Material.Ka", 0.9f, 0.5f, 0.3f);
-    prog.setUniform("Material.Ks", 0.8f, 0.8f, 0.8f);
-    prog.setUniform("Material.Shininess", 100.0f);
+    GLSLProgram & teapotProg = tessellate ? patchProg : prog;
+    teapotProg.use();
+    teapotProg.setUniform("Material.Kd", 0.9f, 0.5f, 0.3f);
+    teapotProg.setUniform("Material.Ka", 0.9f, 0.5f, 0.3f);
+    teapotProg.setUniform("Material.Ks", 0.8f, 0.8f, 0.8f);
+    teapotProg.setUniform("Material.Shininess", 100.0f);
     model = mat4(1.0f);
     model *= glm::translate(vec3(0.0f,0.0f,0.0f));
     model *= glm::rotate(-90.0f, vec3(1.0f,0.0f,0.0f));
-    setMatrices();
-    teapot->render();
+    setMatrices(teapotProg);
+    if( tessellate ) patches->render();
+    else teapot->render();
 
+    prog.use();
     prog.setUniform("Material.Kd", 0.7f, 0.7f, 0.7f);
     prog.setUniform("Material.Ka", 0.1f, 0.1f, 0.1f);
     prog.setUniform("Material.Ks", 0.8f, 0.8f, 0.8f);
     prog.setUniform("Material.Shininess", 180.0f);
     model = mat4(1.0f);
     model *= glm::translate(vec3(0.0f,-0.45f, 0.0f));
-    setMatrices();
+    setMatrices(prog);
     plane->render();
 }
 
@@ -114,9 +161,12 @@ void AppMain()
     if(!GLEW_VERSION_3_2)
         throw std::runtime_error("OpenGL 3.2 API is not available.");
     
-    glfwSetWindowSizeCallback(ChangeSize);
-    
     SetupRC();
+
+    // Registered after SetupRC so the first call also sets the patch
+    // program's viewport
+    glfwSetWindowSizeCallback(ChangeSize);
+    glfwSetKeyCallback(KeyPressed);
     
     while(glfwGetWindowParam(GLFW_OPENED) && !glfwGetKey( GLFW_KEY_ESC ))
     {
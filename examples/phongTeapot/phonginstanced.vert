@@ -0,0 +1,52 @@
+#version 400
+
+// phong.vert for InstanceBuffer: the model matrix and material index
+// come from per instance attributes
+
+layout (location = 0) in vec3 VertexPosition;
+layout (location = 1) in vec3 VertexNormal;
+layout (location = 4) in mat4 InstanceModel;
+layout (location = 8) in uint InstanceMaterial;
+
+out vec3 LightIntensity;
+
+struct LightInfo {
+  vec4 Position; // Light position in eye coords.
+  vec3 La;       // Ambient light intensity
+  vec3 Ld;       // Diffuse light intensity
+  vec3 Ls;       // Specular light intensity
+};
+uniform LightInfo Light;
+
+struct MaterialInfo {
+  vec3 Ka;            // Ambient reflectivity
+  vec3 Kd;            // Diffuse reflectivity
+  vec3 Ks;            // Specular reflectivity
+  float Shininess;    // Specular shininess factor
+};
+uniform MaterialInfo Materials[8];
+
+uniform mat4 ViewMatrix;
+uniform mat4 ProjectionMatrix;
+
+void main()
+{
+    MaterialInfo Material = Materials[InstanceMaterial];
+
+    // Two matrix-vector products are cheaper than forming the model-view matrix
+    vec3 tnorm = normalize( mat3(ViewMatrix) * (mat3(InstanceModel) * VertexNormal));
+    vec4 eyeCoords = ViewMatrix * (InstanceModel * vec4(VertexPosition,1.0));
+    vec3 s = normalize(vec3(Light.Position - eyeCoords));
+    vec3 v = normalize(-eyeCoords.xyz);
+    vec3 r = reflect( -s, tnorm );
+    float sDotN = max( dot(s,tnorm), 0.0 );
+    vec3 ambient = Light.La * Material.Ka;
+    vec3 diffuse = Light.Ld * Material.Kd * sDotN;
+    vec3 spec = vec3(0.0);
+    if( sDotN > 0.0 )
+       spec = Light.Ls * Material.Ks *
+              pow( max( dot(r,v), 0.0 ), Material.Shininess );
+
+    LightIntensity = ambient + diffuse + spec;
+    gl_Position = ProjectionMatrix * eyeCoords;
+}
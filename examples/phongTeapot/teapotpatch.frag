@@ -0,0 +1,45 @@
+#version 400
+
+in vec3 Position;
+in vec3 Normal;
+
+struct LightInfo {
+  vec4 Position; // Light position in eye coords.
+  vec3 La;       // Ambient light intensity
+  vec3 Ld;       // Diffuse light intensity
+  vec3 Ls;       // Specular light intensity
+};
+uniform LightInfo Light;
+
+struct MaterialInfo {
+  vec3 Ka;            // Ambient reflectivity
+  vec3 Kd;            // Diffuse reflectivity
+  vec3 Ks;            // Specular reflectivity
+  float Shininess;    // Specular shininess factor
+};
+uniform MaterialInfo Material;
+
+layout( location = 0 ) out vec4 FragColor;
+
+// The same model as phong.vert, per fragment
+vec3 ads( )
+{
+    vec3 n = normalize(Normal);
+    vec3 s = normalize( vec3(Light.Position) - Position );
+    vec3 v = normalize(vec3(-Position));
+    vec3 r = reflect( -s, n );
+    float sDotN = max( dot(s,n), 0.0 );
+
+    vec3 ambient = Light.La * Material.Ka;
+    vec3 diffuse = Light.Ld * Material.Kd * sDotN;
+    vec3 spec = vec3(0.0);
+    if( sDotN > 0.0 )
+       spec = Light.Ls * Material.Ks *
+              pow( max( dot(r,v), 0.0 ), Material.Shininess );
+
+    return ambient + diffuse + spec;
+}
+
+void main() {
+    FragColor = vec4(ads(), 1.0);
+}
@@ -0,0 +1,9 @@
+#version 400
+
+layout (location = 0) in vec3 VertexPosition;
+
+void main()
+{
+    // Control points stay in model coordinates for the TCS and TES
+    gl_Position = vec4(VertexPosition, 1.0);
+}